@@ -117,7 +117,7 @@ Instruction::Instruction( int32_t num ) {
     objectCode = num;
 }
 
-uint32_t Instruction::getObjectCode( void ) {
+uint32_t Instruction::getObjectCode( void ) const {
     // the cpu is big endian. This assembler may not be running on a big endian machine
     return htobe32(objectCode);
 }
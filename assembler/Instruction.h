@@ -45,7 +45,7 @@ class Instruction {
             // constructor for just a constant number
             Instruction( int32_t num );
 
-            uint32_t getObjectCode( void );
+            uint32_t getObjectCode( void ) const;
 
 };
 
@@ -0,0 +1,61 @@
+// reading and writing program images. See header file
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "ProgramImage.h"
+#include "../emulator/debug.h"
+#include <stdio.h>
+#include <string.h>
+#include <endian.h>
+
+static const char magic[] = "CPUIMG01";
+static const size_t magicBytes = 8;
+
+void writeProgramImage( const std::string &path, const std::vector<int32_t> &words ) {
+    FILE* file = fopen( path.c_str(), "wb" );
+    if ( file == NULL )
+        errExit( "Could not open " + path + " to write a program image" );
+
+    uint32_t numWords = htobe32( words.size() );
+
+    bool ok = fwrite( magic, 1, magicBytes, file ) == magicBytes;
+    ok = ok && ( fwrite( &numWords, sizeof(numWords), 1, file ) == 1 );
+    // the words are already in RAM byte order so they are written without swapping
+    if ( words.size() > 0 )
+        ok = ok && ( fwrite( &words[0], sizeof(int32_t), words.size(), file ) == words.size() );
+
+    if ( (fclose( file ) != 0) || !ok )
+        errExit( "Could not write the program image " + path );
+}
+
+std::vector<int32_t> readProgramImage( const std::string &path ) {
+    FILE* file = fopen( path.c_str(), "rb" );
+    if ( file == NULL )
+        errExit( "Could not open the program image " + path );
+
+    char fileMagic[magicBytes];
+    uint32_t numWords;
+    if ( (fread( fileMagic, 1, magicBytes, file ) != magicBytes) || (memcmp( fileMagic, magic, magicBytes ) != 0) )
+        errExit( path + " is not a program image" );
+
+    if ( fread( &numWords, sizeof(numWords), 1, file ) != 1 )
+        errExit( path + " is too short to be a program image" );
+    numWords = be32toh( numWords );
+
+    std::vector<int32_t> words( numWords );
+    if ( (numWords > 0) && (fread( &words[0], sizeof(int32_t), numWords, file ) != numWords) )
+        errExit( path + " has fewer words than it says it has" );
+
+    fclose( file );
+    return words;
+}
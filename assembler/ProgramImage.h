@@ -0,0 +1,36 @@
+// saving machine code to a file so that other tools (like aotTranslate) can use it
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef PROGRAM_IMAGE_H
+#define PROGRAM_IMAGE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/* File format:
+    8 bytes     "CPUIMG01"
+    4 bytes     number of words (big endian)
+    4n bytes    the words in the same byte order they have in RAM (so each instruction is big endian)
+
+    The words are the same as the vector<int32_t> given to CPU (from Instruction::getObjectCode)
+*/
+
+// errExit's if the file cannot be written
+void writeProgramImage( const std::string &path, const std::vector<int32_t> &words );
+
+// errExit's if the file cannot be read or is not a program image
+std::vector<int32_t> readProgramImage( const std::string &path );
+
+#endif
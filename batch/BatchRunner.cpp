@@ -0,0 +1,261 @@
+// runs lots of independent program images at once, each on its own CPU instance
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "BatchRunner.h"
+#include "WorkStealingDeque.h"
+#include "../assembler/ProgramImage.h"
+#include "../cpu/CPU.h"
+#include "../cpu/CPUPool.h"
+#include "../cpu/FastCPU.h"
+#include "../cpu/MemoryMap.h"
+#include "../cpu/Video.h"
+#include "../emulator/Hash.h"
+#include "../emulator/debug.h"
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <string.h>
+
+using namespace std;
+
+namespace {
+
+// thrown by the error handler so that a job which fails does not stop the others
+struct JobError {
+    ErrorKind kind;
+    string message;
+};
+
+void throwJobError( ErrorKind kind, const string &message, void* context ) {
+    (void) context;
+    JobError error = { kind, message };
+    throw error;
+}
+
+// all of memory the way debugRamRead sees it. Memory which was never written is copied too (as the
+//      zeros it starts as) because the hashes cover all of it
+template <typename Checking>
+void copyMemory( BasicCPU<Checking> &cpu, int8_t* memory ) {
+    cpu.copyRamOut( memory );
+}
+
+void copyMemory( FastCPU &cpu, int8_t* memory ) {
+    for ( unsigned int addr = 0; addr < ramBytes; addr += sizeof(int32_t) ) {
+        int32_t word = cpu.debugRamRead( addr );
+        memcpy( memory + addr, &word, sizeof(word) );
+    }
+}
+
+template <typename CPUType>
+void finishJob( CPUType &cpu, BatchResult &result ) {
+    int8_t memory[ ramBytes ];
+    copyMemory( cpu, memory );
+
+    result.cycles = cpu.getCycleCount();
+    result.ramDigest = fnv1a( memory, mainMemoryBytes );
+    result.frameHash = fnv1a( memory + mainMemoryBytes, ramBytes - mainMemoryBytes );
+}
+
+// false if the program faulted
+template <typename CPUType>
+bool runCPU( CPUType &cpu, uint64_t maxCycles, NullVideo &video, BatchResult &result ) {
+    cpu.setVideoOutput( video );
+
+    RunStatus status = cpu.run( maxCycles );
+    if ( status == RunStatus::faulted ) {
+        const CPUFault &fault = cpu.getFault();
+        result.error = fault.message;
+        result.errorKind = fault.kind;
+        result.faultPC = fault.pc;
+        result.cycles = fault.cycle;
+        return false;
+    }
+
+    result.halted = ( status == RunStatus::halted );
+    finishJob( cpu, result );
+    return true;
+}
+
+// the CPUs are too big to want on the stack of every worker thread
+template <typename Checking>
+bool runOnCPU( const vector<int32_t> &image, uint64_t maxCycles, NullVideo &video, BatchResult &result,
+        BasicCPUPool<Checking>* pool ) {
+    if ( pool ) {
+        BasicPooledCPU<Checking> cpu( *pool, image );
+        return runCPU( *cpu, maxCycles, video, result );
+    }
+
+    unique_ptr< BasicCPU<Checking> > cpu( new BasicCPU<Checking>( image ) );
+    return runCPU( *cpu, maxCycles, video, result );
+}
+
+bool runOnFastCPU( const vector<int32_t> &image, uint64_t maxCycles, NullVideo &video, BatchResult &result ) {
+    unique_ptr<FastCPU> cpu( new FastCPU( image ) );
+    return runCPU( *cpu, maxCycles, video, result );
+}
+
+} // namespace
+
+BatchResult runJob( const BatchJob &job, BatchEngine engine, uint64_t maxCycles, BasicCPUPool<Checked>* pool,
+        BasicCPUPool<Unchecked>* uncheckedPool ) {
+    BatchResult result;
+    result.ok = false;
+    result.errorKind = ErrorKind::general;
+    result.faultPC = -1;
+    result.halted = false;
+    result.cycles = 0;
+    result.frames = 0;
+    result.ramDigest = 0;
+    result.frameHash = 0;
+
+    ScopedErrorHandler handler( throwJobError, NULL );
+    ScopedDebugStream quiet( NULL );
+    NullVideo video;
+
+    try {
+        // only copied if it has to be read from a file
+        vector<int32_t> loaded;
+        if ( job.image.empty() )
+            loaded = readProgramImage( job.path );
+        const vector<int32_t> &image = job.image.empty() ? loaded : job.image;
+
+        if ( engine == BatchEngine::fast )
+            result.ok = runOnFastCPU( image, maxCycles, video, result );
+        else if ( engine == BatchEngine::cpuUnchecked )
+            result.ok = runOnCPU( image, maxCycles, video, result, uncheckedPool );
+        else
+            result.ok = runOnCPU( image, maxCycles, video, result, pool );
+    } catch ( const JobError &error ) {
+        result.error = error.message;
+        result.errorKind = error.kind;
+    } catch ( const exception &error ) {
+        result.error = error.what();
+    }
+
+    result.frames = video.getFrames();
+    return result;
+}
+
+namespace {
+
+// what the worker threads share
+struct Batch {
+    const vector<BatchJob> &jobs;
+    const BatchOptions &options;
+    vector<BatchResult> &results;
+    vector< unique_ptr< WorkStealingDeque<unsigned int> > > queues; // job indexes, one deque per thread
+    atomic<uint64_t> steals;
+    // one CPU for each thread, so jobs never wait for one. Only the pool for the engine in use has any
+    BasicCPUPool<Checked> cpus;
+    BasicCPUPool<Unchecked> uncheckedCpus;
+
+    Batch( const vector<BatchJob> &Jobs, const BatchOptions &Options, vector<BatchResult> &Results,
+            unsigned int threads )
+        : jobs( Jobs ), options( Options ), results( Results ), steals( 0 ),
+          cpus( Options.engine == BatchEngine::cpu ? threads : 0 ),
+          uncheckedCpus( Options.engine == BatchEngine::cpuUnchecked ? threads : 0 ) {}
+};
+
+void worker( Batch &batch, unsigned int self ) {
+    unsigned int numQueues = batch.queues.size();
+
+    while ( true ) {
+        unsigned int job;
+
+        if ( !batch.queues[self]->pop( job ) ) {
+            // our own jobs have run out so look for one to steal, starting with the next thread along
+            bool stolen = false;
+            for ( unsigned int i = 1; (i < numQueues) && !stolen; i++ )
+                stolen = batch.queues[ (self + i) % numQueues ]->steal( job );
+
+            // jobs are never added once we have started so there is nothing left anywhere
+            if ( !stolen )
+                return;
+
+            batch.steals++;
+        }
+
+        batch.results[job] = runJob( batch.jobs[job], batch.options.engine, batch.options.maxCycles, &batch.cpus,
+                &batch.uncheckedCpus );
+    }
+}
+
+} // namespace
+
+vector<BatchResult> runBatch( const vector<BatchJob> &jobs, const BatchOptions &options, BatchStats &stats ) {
+    unsigned int threads = options.threads;
+    if ( threads == 0 )
+        threads = thread::hardware_concurrency();
+    if ( threads == 0 ) // not known
+        threads = 1;
+
+    vector<BatchResult> results( jobs.size() );
+    Batch batch( jobs, options, results, threads );
+
+    // deal the jobs out like cards. Stealing evens things out when some jobs take longer than others
+    for ( unsigned int i = 0; i < threads; i++ )
+        batch.queues.push_back( unique_ptr< WorkStealingDeque<unsigned int> >( new WorkStealingDeque<unsigned int>() ) );
+    for ( unsigned int i = 0; i < jobs.size(); i++ )
+        batch.queues[ i % threads ]->push( i );
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    vector<thread> workers;
+    for ( unsigned int i = 0; i < threads; i++ )
+        workers.push_back( thread( worker, ref( batch ), i ) );
+    for ( unsigned int i = 0; i < threads; i++ )
+        workers[i].join();
+
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+    stats.threads = threads;
+    stats.seconds = chrono::duration<double>( end - start ).count();
+    stats.steals = batch.steals;
+
+    return results;
+}
+
+vector<BatchJob> readManifest( const string &path ) {
+    ifstream file( path.c_str() );
+    if ( !file )
+        errExit( "Could not open the manifest " + path );
+
+    string directory;
+    size_t slash = path.rfind( '/' );
+    if ( slash != string::npos )
+        directory = path.substr( 0, slash + 1 );
+
+    vector<BatchJob> jobs;
+    string line;
+    while ( getline( file, line ) ) {
+        // trailing whitespace (including the \r from files written on Windows)
+        size_t last = line.find_last_not_of( " \t\r" );
+        if ( last == string::npos )
+            continue;
+        line = line.substr( 0, last + 1 );
+
+        if ( line[0] == '#' )
+            continue;
+
+        BatchJob job;
+        job.name = line;
+        job.path = ( line[0] == '/' ) ? line : directory + line;
+        jobs.push_back( job );
+    }
+
+    return jobs;
+}
@@ -0,0 +1,82 @@
+// runs lots of independent program images at once, each on its own CPU instance
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+#include "../emulator/debug.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct Checked;
+struct Unchecked;
+template <typename Checking> class BasicCPUPool;
+
+// what runs the jobs
+enum class BatchEngine {
+    cpu,          // the cycle accurate CPU. Reading an undefined register or memory fails the job
+    cpuUnchecked, // the same without checking for undefined signals, which is faster
+    fast          // FastCPU. Registers and memory start as zero, so reading one which was never
+                  //      written is not a fault. The other faults are the same as for cpu
+};
+
+struct BatchJob {
+    std::string name; // for reports. Usually the path of the image
+    std::string path; // the program image is read from here by the worker if image is empty
+    std::vector<int32_t> image;
+};
+
+struct BatchOptions {
+    unsigned int threads; // 0 for one for each core
+    BatchEngine engine;
+    uint64_t maxCycles;   // jobs which have not halted by then are stopped
+};
+
+struct BatchResult {
+    bool ok;           // false if the job hit an error (anything which would have called errExit)
+    std::string error; // the message if it did
+    ErrorKind errorKind;
+    int32_t faultPC;   // address of the instruction which faulted, or -1 if it is not known
+    bool halted;       // false if the job was stopped at maxCycles
+    uint64_t cycles;   // when the job stopped, including the cycle which faulted
+    uint64_t frames;    // printBuffer instructions run. Nothing is printed
+    uint64_t ramDigest; // fnv1a of main memory when the job stopped
+    uint64_t frameHash; // fnv1a of video memory when the job stopped
+};
+
+struct BatchStats {
+    unsigned int threads;
+    double seconds;
+    uint64_t steals; // jobs run by a thread other than the one they were given to
+};
+
+// run one job in this thread. Errors and debug messages are kept to the job: errors are put in
+//      the result and debug messages are thrown away
+// if pool is given, BatchEngine::cpu jobs take a CPU from it (see cpu/CPUPool.h) instead of making one.
+//      uncheckedPool is the same for BatchEngine::cpuUnchecked
+BatchResult runJob( const BatchJob &job, BatchEngine engine, uint64_t maxCycles,
+        BasicCPUPool<Checked>* pool = NULL, BasicCPUPool<Unchecked>* uncheckedPool = NULL );
+
+// run every job, sharing them out between threads. A thread which runs out of jobs steals from
+//      the others. results[i] is for jobs[i]
+std::vector<BatchResult> runBatch( const std::vector<BatchJob> &jobs, const BatchOptions &options,
+        BatchStats &stats );
+
+// one program image path per line. Blank lines and lines starting with # are ignored
+// relative paths are relative to the directory the manifest is in
+// the images are not read until the job is run
+std::vector<BatchJob> readManifest( const std::string &path );
+
+#endif
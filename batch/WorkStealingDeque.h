@@ -0,0 +1,66 @@
+// a double ended queue of jobs for one worker thread, which the other workers can steal from
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef WORK_STEALING_DEQUE_H
+#define WORK_STEALING_DEQUE_H
+
+#include <deque>
+#include <mutex>
+
+// each worker thread owns one of these. The owner pushes and pops at the back and other threads
+//      steal from the front, so a thief takes the work the owner would have got to last
+// a job is a whole program run (at least thousands of cycles) so a lock per deque costs nothing
+//      we could measure and is a lot easier to get right than a lock free deque
+template <typename Type>
+class WorkStealingDeque {
+    private:
+        std::deque<Type> items;
+        std::mutex lock;
+
+        WorkStealingDeque( const WorkStealingDeque& );
+        WorkStealingDeque& operator=( const WorkStealingDeque& );
+
+    public:
+        WorkStealingDeque( void ) {}
+
+        // owner only
+        void push( const Type &item ) {
+            std::lock_guard<std::mutex> guard( lock );
+            items.push_back( item );
+        }
+
+        // owner only. Returns false if there was nothing to pop
+        bool pop( Type &item ) {
+            std::lock_guard<std::mutex> guard( lock );
+            if ( items.empty() )
+                return false;
+
+            item = items.back();
+            items.pop_back();
+            return true;
+        }
+
+        // any thread. Returns false if there was nothing to steal
+        bool steal( Type &item ) {
+            std::lock_guard<std::mutex> guard( lock );
+            if ( items.empty() )
+                return false;
+
+            item = items.front();
+            items.pop_front();
+            return true;
+        }
+};
+
+#endif
@@ -0,0 +1,228 @@
+// benchmark of the cycle accurate cpu running the demo program
+// printBuffer is replaced with a nop so that we are timing the emulator and not the terminal
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../cpu/CPU.h"
+#include "../cpu/FastCPU.h"
+#include "../cpu/JitCPU.h"
+#include "../cpu/AotCPU.h"
+#include "../cpu/LevelizedCPU.h"
+#include "../cpu/LockstepCPU.h"
+#include "../test/demoProgram.h"
+#include <vector>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <memory>
+
+using namespace std;
+
+// the demo program translated by aotTranslate (see the Makefile)
+extern const AotProgram demoNoFramesAot;
+
+// number of times the whole demo program is run
+const unsigned int repeats = 5;
+
+// the faster engines run the program this many more times so that there is something to time
+const unsigned int fastRepeatsMultiplier = 100;
+
+// time CPU::clockTick over the whole demo program
+template <typename CPUType>
+void benchCPU( const vector<int32_t> &machineCode, const char* name ) {
+    uint64_t cycles = 0;
+    double seconds = 0;
+
+    for ( unsigned int i = 0; i < repeats; i++ ) {
+        CPUType DUT( machineCode ); // construction is not timed
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        do {
+            cycles++;
+        } while ( !DUT.clockTick() );
+        chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+        seconds += chrono::duration<double>( end - start ).count();
+    }
+
+    printf( "%s on the demo program: %llu cycles in %.3fs = %.0f cycles/sec\n",
+            name, (unsigned long long) cycles, seconds, cycles / seconds );
+}
+
+// long enough for the demo program to have written to a page of its memory
+const unsigned int cyclesBeforeRestore = 2000;
+
+// getting a CPU ready to run the demo program: by constructing a new one, by restoring a snapshot
+//      taken just after construction over the top of one which has already run, or by resetting it
+// the CPU runs for a while before each restore and reset. Only the restore or reset is timed
+template <typename Checking>
+void benchRestore( const vector<int32_t> &machineCode, const char* name ) {
+    const unsigned int count = 10000;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for ( unsigned int i = 0; i < count; i++ ) {
+        BasicCPU<Checking> DUT( machineCode );
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+    double constructSeconds = chrono::duration<double>( end - start ).count();
+
+    BasicCPU<Checking> DUT( machineCode );
+    unique_ptr<CPUState> state( new CPUState );
+    DUT.snapshot( *state );
+
+    double restoreSeconds = 0;
+    for ( unsigned int i = 0; i < count; i++ ) {
+        for ( unsigned int j = 0; j < cyclesBeforeRestore; j++ )
+            DUT.clockTick();
+
+        start = chrono::steady_clock::now();
+        DUT.restore( *state );
+        end = chrono::steady_clock::now();
+        restoreSeconds += chrono::duration<double>( end - start ).count();
+    }
+
+    // reset loads the program again, reusing the pages the last run wrote to
+    double resetSeconds = 0;
+    for ( unsigned int i = 0; i < count; i++ ) {
+        for ( unsigned int j = 0; j < cyclesBeforeRestore; j++ )
+            DUT.clockTick();
+
+        start = chrono::steady_clock::now();
+        DUT.reset( machineCode );
+        end = chrono::steady_clock::now();
+        resetSeconds += chrono::duration<double>( end - start ).count();
+    }
+
+    printf( "%s: construction %.2fus, restore %.2fus (%.1fx faster), reset %.2fus (%.1fx faster)\n", name,
+            constructSeconds * 1e6 / count, restoreSeconds * 1e6 / count, constructSeconds / restoreSeconds,
+            resetSeconds * 1e6 / count, constructSeconds / resetSeconds );
+}
+
+// numLanes copies of the demo program at once. The cycles are added up over all of the lanes
+template <unsigned int numLanes>
+void benchLockstep( const vector<int32_t> &machineCode, bool useSimd ) {
+    uint64_t cycles = 0;
+    double seconds = 0;
+    bool simd = false;
+    vector< vector<int32_t> > images( numLanes, machineCode );
+
+    for ( unsigned int i = 0; i < repeats * fastRepeatsMultiplier / numLanes; i++ ) {
+        unique_ptr< LockstepCPU<numLanes> > DUT( new LockstepCPU<numLanes>( images, useSimd ) );
+        simd = DUT->usingSimd();
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        DUT->run();
+        chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+        for ( unsigned int lane = 0; lane < numLanes; lane++ )
+            cycles += DUT->getCycleCount( lane );
+        seconds += chrono::duration<double>( end - start ).count();
+    }
+
+    printf( "LockstepCPU<%u>::run (%s) on copies of the demo program: %llu cycles in %.3fs = %.0f cycles/sec\n",
+            numLanes, simd ? "AVX2" : "portable", (unsigned long long) cycles, seconds, cycles / seconds );
+}
+
+int main( void ) {
+    vector<int32_t> machineCode = demoProgram( false );
+
+    // the same datapath with and without checking for undefined signals
+    benchCPU< BasicCPU<Checked> >( machineCode, "CPU::clockTick (Checked)" );
+    benchCPU< BasicCPU<Unchecked> >( machineCode, "CPU::clockTick (Unchecked)" );
+
+    benchRestore<Checked>( machineCode, "CPU (Checked)" );
+    benchRestore<Unchecked>( machineCode, "CPU (Unchecked)" );
+
+    // still cycle by cycle but as the functions written by tools/levelize
+    benchCPU< LevelizedCPU >( machineCode, "LevelizedCPU::clockTick" );
+
+    uint64_t cycles;
+    double seconds;
+
+    // the functional model runs whole instructions. Cycles are still the cycles CPU would have taken
+    cycles = 0;
+    seconds = 0;
+    FusionStats stats;
+    for ( unsigned int i = 0; i < repeats * fastRepeatsMultiplier; i++ ) {
+        FastCPU DUT( machineCode );
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        DUT.run();
+        chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+        cycles += DUT.getCycleCount();
+        seconds += chrono::duration<double>( end - start ).count();
+        stats = DUT.getFusionStats();
+    }
+
+    printf( "FastCPU::run on the demo program: %llu cycles in %.3fs = %.0f cycles/sec\n",
+            (unsigned long long) cycles, seconds, cycles / seconds );
+
+    const char* fusionNames[] = { "none", "addImmediate+copy", "addImmediate+load", "addImmediate+store" };
+    for ( unsigned int i = 1; i < static_cast<unsigned int>(Fusion::numFusions); i++ ) {
+        printf( "    %s fused: %.1f%% of instructions\n", fusionNames[i],
+                100.0 * 2 * stats.fused[i] / stats.instructions );
+    }
+
+    // many instances running together
+    benchLockstep<8>( machineCode, false );
+    benchLockstep<8>( machineCode, true );
+    benchLockstep<16>( machineCode, true );
+
+    // translated ahead of time so there is nothing to do at run time apart from run it
+    cycles = 0;
+    seconds = 0;
+    for ( unsigned int i = 0; i < repeats * fastRepeatsMultiplier; i++ ) {
+        AotCPU DUT( demoNoFramesAot );
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        DUT.run();
+        chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+        cycles += DUT.getCycleCount();
+        seconds += chrono::duration<double>( end - start ).count();
+    }
+
+    printf( "AotCPU::run on the demo program: %llu cycles in %.3fs = %.0f cycles/sec\n",
+            (unsigned long long) cycles, seconds, cycles / seconds );
+
+    if ( !JitCPU::isSupported() ) {
+        printf( "JitCPU is not supported on this host\n" );
+        return EXIT_SUCCESS;
+    }
+
+    // translating the blocks is part of the time because it happens inside run()
+    cycles = 0;
+    seconds = 0;
+    JitStats jitStats;
+    for ( unsigned int i = 0; i < repeats * fastRepeatsMultiplier; i++ ) {
+        JitCPU DUT( machineCode );
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        DUT.run();
+        chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+        cycles += DUT.getCycleCount();
+        seconds += chrono::duration<double>( end - start ).count();
+        jitStats = DUT.getStats();
+    }
+
+    printf( "JitCPU::run on the demo program: %llu cycles in %.3fs = %.0f cycles/sec\n",
+            (unsigned long long) cycles, seconds, cycles / seconds );
+    printf( "    %llu blocks translated, %llu chains patched, %llu exits to the dispatcher\n",
+            (unsigned long long) jitStats.blocksTranslated, (unsigned long long) jitStats.chainsPatched,
+            (unsigned long long) jitStats.exits );
+
+    return EXIT_SUCCESS;
+}
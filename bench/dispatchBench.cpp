@@ -0,0 +1,197 @@
+// benchmark of the execute stage dispatching on the opcode with a switch against the microcode ROM
+// the datapath is cut down to plain integers so that the dispatch is most of what is timed
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../cpu/Microcode.h"
+#include "../cpu/Opcodes.h"
+#include "../test/demoProgram.h"
+#include <vector>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <endian.h>
+#include <chrono>
+
+using namespace std;
+
+// number of instructions executed for each way of dispatching
+const unsigned int numInstructions = 50000000;
+
+// the registers execute works on
+struct ExecuteState {
+    int32_t out1;
+    int32_t out2;
+    int32_t immediate;
+    int32_t aluResult;
+    int32_t programCounter;
+    int32_t PCplus4;
+    bool zero;
+    bool positive;
+    bool halted;
+    uint32_t memoryOps; // stands in for the RAM
+    uint32_t prints;
+};
+
+static int32_t aluOp( AluOps op, int32_t a, int32_t b ) {
+    switch ( op ) {
+        case ( AluOps::add ): return static_cast<int32_t>( static_cast<uint32_t>(a) + static_cast<uint32_t>(b) );
+        case ( AluOps::sub ): return static_cast<int32_t>( static_cast<uint32_t>(a) - static_cast<uint32_t>(b) );
+        case ( AluOps::nand ): return ~( a & b );
+        case ( AluOps::lshift ): return static_cast<int32_t>( static_cast<uint32_t>(a) << (b & 31) );
+        default: return 0;
+    }
+}
+
+static void setResult( ExecuteState &s, int32_t result ) {
+    s.aluResult = result;
+    s.zero = ( result == 0 );
+    s.positive = ( result >= 0 );
+}
+
+// a case for every opcode, the way CPU::execute was written before the microcode ROM
+static void executeSwitch( ExecuteState &s, Opcode op ) {
+    switch ( op ) {
+        case ( Opcode::add ):
+            setResult( s, aluOp( AluOps::add, s.out1, s.out2 ) );
+            s.programCounter = s.PCplus4;
+            break;
+
+        case ( Opcode::sub ):
+            setResult( s, aluOp( AluOps::sub, s.out1, s.out2 ) );
+            s.programCounter = s.PCplus4;
+            break;
+
+        case ( Opcode::nand ):
+            setResult( s, aluOp( AluOps::nand, s.out1, s.out2 ) );
+            s.programCounter = s.PCplus4;
+            break;
+
+        case ( Opcode::lshift ):
+            setResult( s, aluOp( AluOps::lshift, s.out1, s.out2 ) );
+            s.programCounter = s.PCplus4;
+            break;
+
+        case ( Opcode::addImmediate ):
+            setResult( s, aluOp( AluOps::add, s.out1, s.immediate ) );
+            s.programCounter = s.PCplus4;
+            break;
+
+        case ( Opcode::subImmediate ):
+            setResult( s, aluOp( AluOps::sub, s.out1, s.immediate ) );
+            s.programCounter = s.PCplus4;
+            break;
+
+        case ( Opcode::jumpToReg ):
+            s.programCounter = s.out1;
+            break;
+
+        case ( Opcode::branchIfZero ):
+            s.programCounter = s.zero ? s.out1 : s.PCplus4;
+            break;
+
+        case ( Opcode::branchIfPositive ):
+            s.programCounter = s.positive ? s.out1 : s.PCplus4;
+            break;
+
+        case ( Opcode::load ):
+        case ( Opcode::store ):
+            s.memoryOps += s.out1;
+            s.programCounter = s.PCplus4;
+            break;
+
+        case ( Opcode::nop ):
+            s.programCounter = s.PCplus4;
+            break;
+
+        case ( Opcode::printBuffer ):
+            s.prints++;
+            s.programCounter = s.PCplus4;
+            break;
+
+        case ( Opcode::halt ):
+            s.halted = true;
+            break;
+
+        default:
+            break;
+    }
+}
+
+// the same thing driven by the microcode ROM, the way CPU::execute is written now
+static void executeMicrocode( ExecuteState &s, Opcode op ) {
+    const MicroInstruction &micro = microcodeFor( op );
+
+    if ( micro.useAlu )
+        setResult( s, aluOp( micro.aluOp, s.out1, (micro.aluB == AluBSource::immediate) ? s.immediate : s.out2 ) );
+
+    if ( micro.memory != MemoryOp::none )
+        s.memoryOps += s.out1;
+
+    switch ( micro.pc ) {
+        case ( PCSource::PCplus4 ): s.programCounter = s.PCplus4; break;
+        case ( PCSource::out1 ): s.programCounter = s.out1; break;
+        case ( PCSource::ifZero ): s.programCounter = s.zero ? s.out1 : s.PCplus4; break;
+        case ( PCSource::ifPositive ): s.programCounter = s.positive ? s.out1 : s.PCplus4; break;
+        case ( PCSource::none ): break;
+    }
+
+    if ( micro.system == SystemOp::printBuffer )
+        s.prints++;
+    else if ( micro.system == SystemOp::halt )
+        s.halted = true;
+}
+
+template <void (*execute)( ExecuteState&, Opcode )>
+static void benchDispatch( const vector<Opcode> &trace, const char* name ) {
+    ExecuteState s = ExecuteState();
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for ( unsigned int i = 0; i < numInstructions; i++ ) {
+        s.out1 = i;
+        s.out2 = s.aluResult;
+        s.immediate = 3;
+        s.PCplus4 = s.programCounter + 4;
+        execute( s, trace[ i % trace.size() ] );
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+    double seconds = chrono::duration<double>( end - start ).count();
+    printf( "%s: %u instructions in %.3fs = %.2fns each (checksum %u)\n", name, numInstructions, seconds,
+            1e9 * seconds / numInstructions,
+            static_cast<uint32_t>(s.programCounter) + static_cast<uint32_t>(s.aluResult) + s.memoryOps + s.prints );
+}
+
+int main( void ) {
+    // a random order of the instructions in the demo program, so that the branch predictor
+    //      cannot learn the sequence
+    vector<int32_t> machineCode = demoProgram( false );
+    vector<Opcode> opcodes;
+    for ( unsigned int i = 0; i < machineCode.size(); i++ ) {
+        Opcode op = static_cast<Opcode>( be32toh( machineCode[i] ) & 0x1F );
+        if ( microcodeFor( op ).valid && (op != Opcode::halt) )
+            opcodes.push_back( op );
+    }
+
+    vector<Opcode> trace;
+    uint32_t random = 12345;
+    for ( unsigned int i = 0; i < 4096; i++ ) {
+        random = random * 1103515245 + 12345;
+        trace.push_back( opcodes[ (random >> 16) % opcodes.size() ] );
+    }
+
+    benchDispatch<executeSwitch>( trace, "switch on the opcode" );
+    benchDispatch<executeMicrocode>( trace, "microcode ROM" );
+
+    return EXIT_SUCCESS;
+}
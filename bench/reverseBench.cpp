@@ -0,0 +1,116 @@
+// how long it takes ReverseDebugger to go backwards in a run of a few million cycles, and how much
+//     memory the snapshots take, for different intervals between snapshots
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../debugger/ReverseDebugger.h"
+#include "../cpu/CPU.h"
+#include "../assembler/Instruction.h"
+#include "../cpu/Opcodes.h"
+#include "../test/demoProgram.h"
+#include <vector>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+
+using namespace std;
+
+// counts down from iterations, storing the count each time round. The stores go through 4KB of
+//      memory so a few pages are written in between snapshots
+static vector<int32_t> longProgram( int32_t iterations ) {
+    vector<Instruction> program;
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, iterations ) );
+    program.push_back( Instruction( Opcode::add, 1, 0, 2 ) );                       // r2 = iterations
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 0xFFC ) );
+    program.push_back( Instruction( Opcode::add, 1, 0, 4 ) );                       // r4 = mask
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 2 ) );
+    program.push_back( Instruction( Opcode::add, 1, 0, 7 ) );                       // r7 = 2
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 2048 ) );
+    program.push_back( Instruction( Opcode::add, 1, 0, 5 ) );                       // r5 = base address
+    // loop (word 8):
+    program.push_back( Instruction( Opcode::subImmediate, (uint8_t) 2, (int32_t) 1 ) );
+    program.push_back( Instruction( Opcode::add, 1, 0, 2 ) );                       // r2--
+    program.push_back( Instruction( Opcode::lshift, 2, 7, 6 ) );
+    program.push_back( Instruction( Opcode::nand, 6, 4, 6 ) );
+    program.push_back( Instruction( Opcode::nand, 6, 6, 6 ) );                      // r6 = (r2 * 4) & mask
+    program.push_back( Instruction( Opcode::add, 6, 5, 8 ) );
+    program.push_back( Instruction( Opcode::store, (uint8_t) 8, (uint8_t) 2 ) );
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 20 * 4 ) );
+    program.push_back( Instruction( Opcode::add, 2, 0, 10 ) );                      // flags from r2
+    program.push_back( Instruction( Opcode::branchIfZero, 1 ) );
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 8 * 4 ) );
+    program.push_back( Instruction( Opcode::jumpToReg, 1 ) );
+    program.push_back( Instruction( Opcode::halt ) );
+
+    return assemble( program );
+}
+
+static double secondsSince( chrono::steady_clock::time_point start ) {
+    return chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+}
+
+// run the whole program forwards taking snapshots and then go backwards in a few different ways
+static void benchInterval( const vector<int32_t> &machineCode, uint64_t interval, size_t maxBytes ) {
+    const unsigned int reverseSteps = 100;
+
+    BasicCPU<Unchecked> DUT( machineCode );
+    BasicReverseDebugger<Unchecked> debugger( DUT, interval, maxBytes );
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    while ( !debugger.run( 1000000 ) );
+    double forwardSeconds = secondsSince( start );
+    uint64_t cycles = DUT.getCycleCount();
+    ReverseStats stats = debugger.getStats();
+
+    start = chrono::steady_clock::now();
+    for ( unsigned int i = 0; i < reverseSteps; i++ )
+        debugger.reverseStep();
+    double stepSeconds = secondsSince( start ) / reverseSteps;
+
+    // the top of the loop was a few hundred instructions ago
+    start = chrono::steady_clock::now();
+    debugger.reverseContinue( 8 * 4 );
+    double continueSeconds = secondsSince( start );
+
+    // as far back as the snapshots go
+    start = chrono::steady_clock::now();
+    debugger.reverseStepCycles( DUT.getCycleCount() - stats.oldestCycle );
+    double oldestSeconds = secondsSince( start );
+
+    printf( "interval %7llu: %llu cycles forwards at %.1fM cycles/sec, %u snapshots (%llu pages) in %.0fKB, can go back %llu cycles\n",
+            (unsigned long long) interval, (unsigned long long) cycles, cycles / forwardSeconds / 1e6,
+            stats.snapshots, (unsigned long long) stats.pagesSaved, stats.bytes / 1024.0,
+            (unsigned long long) (cycles - stats.oldestCycle) );
+    printf( "    reverseStep %.1fus, reverseContinue %.1fus, back to the oldest snapshot %.1fus\n",
+            stepSeconds * 1e6, continueSeconds * 1e6, oldestSeconds * 1e6 );
+}
+
+int main( void ) {
+    vector<int32_t> machineCode = longProgram( 100000 );
+
+    // the same run without a debugger, to compare with
+    BasicCPU<Unchecked> plain( machineCode );
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    while ( !plain.clockTick() );
+    double seconds = secondsSince( start );
+    printf( "CPU (Unchecked) without ReverseDebugger: %llu cycles at %.1fM cycles/sec\n",
+            (unsigned long long) plain.getCycleCount(), plain.getCycleCount() / seconds / 1e6 );
+
+    const size_t maxBytes = 4 * 1024 * 1024;
+    benchInterval( machineCode, 1000, maxBytes );
+    benchInterval( machineCode, 10000, maxBytes );
+    benchInterval( machineCode, 100000, maxBytes );
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+// resident memory used by each CPU instance when lots of them run the same program
+// each instance runs the demo program for a while first so that it has written to some of its memory
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../cpu/CPU.h"
+#include "../test/demoProgram.h"
+#include "../emulator/debug.h"
+#include <vector>
+#include <memory>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+// cycles each instance is run for. This gets the demo program into the loop which writes the frames
+const unsigned int cyclesEach = 5000;
+
+// resident set size of this process in bytes
+static size_t residentBytes( void ) {
+    FILE* statm = fopen( "/proc/self/statm", "r" );
+    if ( !statm )
+        errExit( "rssBench: could not open /proc/self/statm" );
+
+    unsigned long size, resident;
+    if ( fscanf( statm, "%lu %lu", &size, &resident ) != 2 )
+        errExit( "rssBench: could not read /proc/self/statm" );
+    fclose( statm );
+
+    return resident * sysconf( _SC_PAGESIZE );
+}
+
+// each measurement is done in a new process so that memory freed by the one before does not count
+template <typename Checking>
+void benchInstances( const vector<int32_t> &machineCode, unsigned int count, bool shareImage, const char* name ) {
+    fflush( stdout );
+    pid_t child = fork();
+    if ( child < 0 )
+        errExit( "rssBench: fork failed" );
+
+    if ( child > 0 ) {
+        int status;
+        waitpid( child, &status, 0 );
+        if ( !WIFEXITED( status ) || (WEXITSTATUS( status ) != EXIT_SUCCESS) )
+            errExit( "rssBench: measurement failed" );
+        return;
+    }
+
+    vector< unique_ptr< BasicCPU<Checking> > > instances;
+    instances.reserve( count );
+    shared_ptr<const MainMemoryImage> image = make_shared<const MainMemoryImage>( machineCode );
+    uint64_t privatePages = 0;
+
+    // the first CPU sets up things which are shared by all of them, such as the video memory image,
+    //      and grows the heap. It is kept until the end so that the others don't just reuse its memory
+    unique_ptr< BasicCPU<Checking> > first( new BasicCPU<Checking>( image ) );
+    for ( unsigned int cycle = 0; cycle < cyclesEach; cycle++ )
+        first->clockTick();
+
+    // the first time stdio reads a file it allocates buffers of its own
+    residentBytes();
+
+    size_t before = residentBytes();
+
+    for ( unsigned int i = 0; i < count; i++ ) {
+        if ( shareImage )
+            instances.push_back( unique_ptr< BasicCPU<Checking> >( new BasicCPU<Checking>( image ) ) );
+        else
+            instances.push_back( unique_ptr< BasicCPU<Checking> >( new BasicCPU<Checking>( machineCode ) ) );
+
+        for ( unsigned int cycle = 0; cycle < cyclesEach; cycle++ )
+            instances.back()->clockTick();
+
+        privatePages += instances.back()->privateRamPages();
+    }
+
+    size_t after = residentBytes();
+
+    printf( "%s, %s: %5u instances, %5.1fKB resident each, %.1f RAM pages written each\n", name,
+            shareImage ? "shared image" : "own image   ", count, (after - before) / 1024.0 / count,
+            (double) privatePages / count );
+
+    fflush( stdout );
+    _exit( EXIT_SUCCESS );
+}
+
+int main( void ) {
+    vector<int32_t> machineCode = demoProgram( false );
+
+    printf( "sizeof(CPU) is %.1fKB (Checked) and %.1fKB (Unchecked). Main memory is %uKB and video memory is %uKB\n",
+            sizeof(BasicCPU<Checked>) / 1024.0, sizeof(BasicCPU<Unchecked>) / 1024.0, mainMemoryBytes / 1024,
+            videoBytes / 1024 );
+
+    const unsigned int counts[] = { 1, 100, 10000 };
+    for ( unsigned int share = 0; share < 2; share++ ) {
+        for ( unsigned int i = 0; i < 3; i++ )
+            benchInstances<Unchecked>( machineCode, counts[i], share, "CPU (Unchecked)" );
+    }
+    for ( unsigned int i = 0; i < 3; i++ )
+        benchInstances<Checked>( machineCode, counts[i], true, "CPU (Checked)  " );
+
+    return EXIT_SUCCESS;
+}
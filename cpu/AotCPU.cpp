@@ -0,0 +1,106 @@
+// runs programs translated by aotTranslate. See header file
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "AotCPU.h"
+#include <algorithm>
+#include <vector>
+
+AotCPU::AotCPU( const AotProgram &Program ) :
+        cpu( std::vector<int32_t>( Program.image, Program.image + Program.imageWords ) ), program( Program ) {
+    codeWritten = false;
+    memset( &stats, 0, sizeof(stats) );
+}
+
+bool AotCPU::isEntry( int32_t addr ) {
+    return std::binary_search( program.entries, program.entries + program.numEntries, addr );
+}
+
+bool AotCPU::run( uint64_t maxCycles ) {
+    while ( !cpu.halted && (cpu.cycleCount < maxCycles) ) {
+        // the translation is out of date
+        if ( codeWritten ) {
+            // faults go to errExit like they do from the translated code
+            RunStatus status = cpu.run( maxCycles );
+            if ( status == RunStatus::faulted )
+                errExit( cpu.fault.kind, cpu.fault.message );
+            return status == RunStatus::halted;
+        }
+
+        // interpret until we get back to somewhere the translation knows about
+        if ( !isEntry( cpu.programCounter ) ) {
+            cpu.step();
+            stats.interpretedInstructions++;
+            continue;
+        }
+
+        AotContext context;
+        context.registers = cpu.registers;
+        context.memory = cpu.memory;
+        context.programCounter = cpu.programCounter;
+        context.zero = cpu.zero;
+        context.positive = cpu.positive;
+        context.flagsSet = cpu.flagsSet;
+        context.cycleCount = cpu.cycleCount;
+        context.cycleLimit = maxCycles;
+        context.video = cpu.video;
+
+        AotExit exit = program.run( context );
+        stats.translatedRuns++;
+
+        cpu.programCounter = context.programCounter;
+        cpu.zero = context.zero;
+        cpu.positive = context.positive;
+        cpu.flagsSet = context.flagsSet;
+        cpu.cycleCount = context.cycleCount;
+
+        switch ( exit ) {
+            case ( AotExit::halted ):
+                cpu.halted = true;
+                break;
+
+            case ( AotExit::cycleLimit ):
+                break;
+
+            case ( AotExit::interpret ):
+                // programCounter might be an entry whose instruction faults so always run one
+                //      instruction here. FastCPU reports the fault
+                cpu.step();
+                stats.interpretedInstructions++;
+                break;
+
+            case ( AotExit::codeWritten ):
+                codeWritten = true;
+                stats.codeWritten = true;
+                break;
+        }
+    }
+
+    return cpu.halted;
+}
+
+int32_t AotCPU::debugRamRead( int32_t addr ) {
+    return cpu.debugRamRead( addr );
+}
+
+uint64_t AotCPU::getCycleCount( void ) {
+    return cpu.getCycleCount();
+}
+
+AotStats AotCPU::getStats( void ) {
+    return stats;
+}
+
+void AotCPU::setVideoOutput( VideoOutput &output ) {
+    cpu.setVideoOutput( output );
+}
@@ -0,0 +1,115 @@
+// runs programs which were translated to C++ ahead of time by tools/aotTranslate
+// anything the translation cannot do is handed to a FastCPU
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef AOT_CPU_H
+#define AOT_CPU_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "FastCPU.h"
+#include "MemoryMap.h"
+
+// why translated code returned to AotCPU::run
+enum class AotExit {
+    halted,
+    cycleLimit,
+    interpret,  // programCounter is not translated or its instruction faults. FastCPU has to run it
+    codeWritten // a store wrote over translated code so the translation cannot be used any more
+};
+
+// the state translated code works on. Registers and memory belong to the FastCPU in AotCPU
+struct AotContext {
+    int32_t* registers;
+    int8_t* memory;
+    int32_t programCounter;
+    bool zero;
+    bool positive;
+    bool flagsSet;
+    uint64_t cycleCount;
+    uint64_t cycleLimit; // stop at the next jump once cycleCount gets here
+    VideoOutput* video;  // where printBuffer sends frames
+};
+
+// what aotTranslate writes out for a program image
+struct AotProgram {
+    AotExit (*run)( AotContext &context );
+
+    // the program image it was translated from. This is loaded into memory first
+    const int32_t* image;
+    unsigned int imageWords;
+
+    // 1 for each word of the image which was translated. Stores to these words exit with codeWritten
+    const uint8_t* codeWords;
+
+    // addresses run can start from, sorted
+    const int32_t* entries;
+    unsigned int numEntries;
+};
+
+struct AotStats {
+    uint64_t translatedRuns;          // calls to AotProgram::run
+    uint64_t interpretedInstructions; // instructions FastCPU had to run
+    bool codeWritten;                 // the translation was thrown away because of self modifying code
+};
+
+// used by translated code: the same address rules as RamAddrTran and RAM
+inline bool aotValidAddress( uint32_t address ) {
+    if ( address > ramBytes - sizeof(int32_t) )
+        return false;
+
+    return !( (address > mainMemoryBytes - sizeof(int32_t)) && (address < mainMemoryBytes) );
+}
+
+// used by translated code: does a store to address write over any translated words?
+inline bool aotWritesCode( const uint8_t* codeWords, unsigned int imageWords, uint32_t address ) {
+    uint32_t first = address / sizeof(int32_t);
+    uint32_t last = (address + sizeof(int32_t) - 1) / sizeof(int32_t);
+
+    return ( (first < imageWords) && codeWords[first] ) || ( (last < imageWords) && codeWords[last] );
+}
+
+class AotCPU {
+    private:
+        FastCPU cpu;
+        const AotProgram &program;
+        bool codeWritten; // once this is set everything is run by cpu
+        AotStats stats;
+
+        // is addr in program.entries?
+        bool isEntry( int32_t addr );
+
+        // not copyable because of the reference to the program
+        AotCPU( const AotCPU& );
+        AotCPU& operator=( const AotCPU& );
+
+    public:
+        AotCPU( const AotProgram &Program );
+
+        // run until we halt or maxCycles have been counted. Like FastCPU::run this can go over
+        //      maxCycles by a little. Returns wheather or not we are halted
+        bool run( uint64_t maxCycles = UINT64_MAX );
+
+        // same as CPU
+        int32_t debugRamRead( int32_t addr );
+        uint64_t getCycleCount( void );
+
+        AotStats getStats( void );
+
+        // printBuffer sends frames to output instead of the terminal. output must outlive us
+        void setVideoOutput( VideoOutput &output );
+};
+
+#endif
@@ -0,0 +1,96 @@
+// showing frames on a thread of their own. See header file
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "AsyncVideo.h"
+#include <string.h>
+
+AsyncVideo::AsyncVideo( VideoOutput &output )
+    : output( output ), written( 0 ), read( 0 ), shown( 0 ), dropped( 0 ), sleeping( false ), stopping( false ) {
+    renderer = std::thread( &AsyncVideo::render, this );
+}
+
+AsyncVideo::~AsyncVideo( void ) {
+    {
+        std::lock_guard<std::mutex> guard( sleepLock );
+        stopping = true;
+    }
+    wake.notify_one();
+
+    renderer.join();
+}
+
+void AsyncVideo::showFrame( const int8_t* frame ) {
+    uint64_t next = written.load( std::memory_order_relaxed );
+
+    if ( next - read.load( std::memory_order_acquire ) == ringFrames ) {
+        dropped++;
+        return;
+    }
+
+    memcpy( ring[ next % ringFrames ], frame, videoBytes );
+    written.store( next + 1 ); // sequentially consistent so that it is ordered with sleeping below
+
+    // the render thread sets sleeping before it looks at written for the last time, so either it
+    //      sees this frame or we see it asleep
+    if ( sleeping.load() ) {
+        std::lock_guard<std::mutex> guard( sleepLock );
+        wake.notify_one();
+    }
+}
+
+void AsyncVideo::render( void ) {
+    uint64_t next = read.load( std::memory_order_relaxed );
+
+    while ( true ) {
+        uint64_t available = written.load( std::memory_order_acquire );
+
+        if ( available == next ) {
+            std::unique_lock<std::mutex> guard( sleepLock );
+            if ( stopping )
+                return;
+
+            sleeping = true;
+            if ( written.load() == next )
+                wake.wait( guard );
+            sleeping = false;
+            continue;
+        }
+
+        // we are behind, so skip to the newest frame. Its slot stays ours until read is moved past it
+        if ( available - next > 1 ) {
+            dropped += available - next - 1;
+            next = available - 1;
+            read.store( next, std::memory_order_release );
+        }
+
+        output.showFrame( ring[ next % ringFrames ] );
+        shown++;
+
+        next++;
+        read.store( next, std::memory_order_release );
+    }
+}
+
+void AsyncVideo::flush( void ) {
+    while ( read.load( std::memory_order_acquire ) != written.load( std::memory_order_relaxed ) )
+        std::this_thread::yield();
+}
+
+uint64_t AsyncVideo::getFramesShown( void ) {
+    return shown;
+}
+
+uint64_t AsyncVideo::getFramesDropped( void ) {
+    return dropped;
+}
@@ -0,0 +1,77 @@
+// a VideoOutput which hands frames to another one on a thread of its own
+// printBuffer only has to copy the frame, so the CPU never waits for the terminal
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef ASYNC_VIDEO_H
+#define ASYNC_VIDEO_H
+
+#include "Video.h"
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// frames are copied into a ring by showFrame (in the CPU's thread) and taken out by the render thread,
+//      which passes them on to the output it was given. The ring is lock free with one producer and
+//      one consumer: showFrame never takes a lock unless the render thread is asleep, and then only
+//      to wake it up
+// frames are dropped instead of making the CPU wait. If the ring is full the new frame is dropped,
+//      and if the render thread finds more than one frame waiting it only shows the newest
+// only one thread may call showFrame at a time
+class AsyncVideo : public VideoOutput {
+    public:
+        static const unsigned int ringFrames = 4;
+
+    private:
+        VideoOutput &output;
+
+        int8_t ring[ ringFrames ][ videoBytes ];
+        std::atomic<uint64_t> written; // frames put in the ring. Only changed by showFrame
+        std::atomic<uint64_t> read;    // frames taken out (shown or dropped). Only changed by the render thread
+
+        std::atomic<uint64_t> shown;
+        std::atomic<uint64_t> dropped;
+
+        // for the render thread to sleep when there is nothing to show
+        std::mutex sleepLock;
+        std::condition_variable wake;
+        std::atomic<bool> sleeping;
+        std::atomic<bool> stopping;
+
+        std::thread renderer;
+
+        AsyncVideo( const AsyncVideo& );
+        AsyncVideo& operator=( const AsyncVideo& );
+
+        void render( void );
+
+    public:
+        // frames are passed to output, which must outlive us
+        explicit AsyncVideo( VideoOutput &output );
+
+        // the newest frame still waiting is shown before the render thread stops
+        ~AsyncVideo( void );
+
+        void showFrame( const int8_t* frame );
+
+        // wait until every frame given to showFrame so far has been shown or dropped
+        void flush( void );
+
+        // frames passed to output, and frames dropped because the render thread was behind
+        uint64_t getFramesShown( void );
+        uint64_t getFramesDropped( void );
+};
+
+#endif
@@ -16,10 +16,12 @@
 #include "CPU.h"
 #include "../emulator/debug.h"
 #include "aluOps.h"
+#include "Microcode.h"
 
 // to do
 // control unit combinational logic
-inline void CPU::fetch( void ) {
+template <typename Checking>
+inline void BasicCPU<Checking>::fetch( void ) {
     debugSignal( "cpu state", "fetch" );
     // read the next instruction from the RAM into the instruction register
     ram->setAddress( programCounter.getOutput() );
@@ -35,65 +37,44 @@ inline void CPU::fetch( void ) {
     currentOpcode.reset();
 }
 
-inline void CPU::decode( void ) {
+template <typename Checking>
+inline void BasicCPU<Checking>::decode( void ) {
     debugSignal( "cpu state", "decode" );
     // decode the instruction we just read from RAM and read those registers
-    decoder.setMemoryWord( ram->getOutput() );
-    currentOpcode.changeDriveSignal( decoder.getOpcode() );
-
-    controlUnitState.changeDriveSignal( ControlUnitStateEnum::Execute );
+    // instructions we have already decoded are remembered by the address they came from
+    DecodedInstruction inst;
+    if ( !decodeCache.lookup( programCounter.getOutput(), inst ) ) {
+        decoder.setMemoryWord( ram->getOutput() );
+        inst = decoder.getDecodedInstruction();
+        decodeCache.fill( programCounter.getOutput(), inst );
+    }
 
-    // only get what we want so we don't read any undefined signals from decoder
-    // in a real control unit all the logic would happen 
-    switch (decoder.getOpcode()) {
-        case ( Opcode::add ):
-        case ( Opcode::sub ):
-        case ( Opcode::nand ):
-        case ( Opcode::lshift ):
-            // reads from register file
-            registers.setReadThisCycle( true );
-            registers.setReadSelect1( decoder.getA() );
-            registers.setReadSelect2( decoder.getB() );
-
-            resultArg.changeDriveSignal( decoder.getResult() );
-            break;
+    // the control signals for this instruction come from the microcode ROM
+    const MicroInstruction &micro = microcodeFor( inst.op );
+    if ( !micro.valid )
+        errExit( ErrorKind::invalidOpcode, "In cpu/decode, invalid opcode" );
 
-        case ( Opcode::addImmediate ):
-        case ( Opcode::subImmediate ):
-            registers.setReadThisCycle( true );
-            registers.setReadSelect1( decoder.getA() );
-            immediate.changeDriveSignal( decoder.getImmediate() );
-            break;
+    currentOpcode.changeDriveSignal( inst.op );
 
-        case ( Opcode::jumpToReg ):
-        case ( Opcode::branchIfZero ):
-        case ( Opcode::branchIfPositive ):
-            registers.setReadThisCycle( true );
-            registers.setReadSelect1( decoder.getA() );
-            break;
+    controlUnitState.changeDriveSignal( ControlUnitStateEnum::Execute );
 
-        case ( Opcode::load ):
-            registers.setReadThisCycle( true );
-            registers.setReadSelect1( decoder.getA() );
+    // only get what we want so we don't read any undefined signals from decoder
+    // nop, halt and printBuffer read nothing but we can't skip back to fetch yet because PC
+    //      has not got it's new value
+    if ( micro.readA || micro.readB )
+        registers.setReadThisCycle( true );
 
-            resultArg.changeDriveSignal( decoder.getResult() );
-            break;
+    if ( micro.readA )
+        registers.setReadSelect1( inst.A );
 
-        case ( Opcode::store ):
-            registers.setReadThisCycle( true );
-            registers.setReadSelect1( decoder.getA() );
-            registers.setReadSelect2( decoder.getB() );
-            break;
+    if ( micro.readB )
+        registers.setReadSelect2( inst.B );
 
-        case ( Opcode::nop ): 
-        case ( Opcode::halt ):
-        case ( Opcode::printBuffer):
-            // we can't skip back to fetch yet because PC has not got it's new value
-            break;
+    if ( micro.latchResult )
+        resultArg.changeDriveSignal( inst.result );
 
-        default:
-            errExit( "In cpu/decode, invalid opcode" );
-    }
+    if ( micro.latchImmediate )
+        immediate.changeDriveSignal( inst.immediate );
 
     // calculate what the next value of the program counter probably will be
     alu.setControl( AluOps::add );
@@ -102,220 +83,155 @@ inline void CPU::decode( void ) {
     PCplus4.changeDriveSignal( alu.getResult() );
 }
 
-inline void CPU::execute( void ) {
-    // default
-    controlUnitState.changeDriveSignal( ControlUnitStateEnum::Write );
-
-    // actually execure the instructions
-    // to keep the code simple we are not using aluBMux explicitly
-    switch ( currentOpcode.getOutput() ) {
-        case ( Opcode::add ):
-            debugSignal( "cpu state", "add execute" );
-            alu.setA( registers.getOut1() );
-            alu.setB( registers.getOut2() );
-            alu.setControl( AluOps::add );
+template <typename Checking>
+inline void BasicCPU<Checking>::execute( void ) {
+    const MicroInstruction &micro = microcodeFor( currentOpcode.getOutput() );
+    if ( !micro.valid )
+        errExit( ErrorKind::invalidOpcode, "In cpu/execute, invalid opcode" );
 
-            aluResult.changeDriveSignal( alu.getResult() );
-            zero.changeDriveSignal( alu.getZeroFlag() );
-            positive.changeDriveSignal( alu.getPositiveFlag() );
+    debugSignal( "cpu state execute", micro.name );
 
-            programCounter.changeDriveSignal( PCplus4.getOutput() );
-            break;
+    // instructions with nothing to write skip to the next instruction
+    controlUnitState.changeDriveSignal( micro.afterExecute );
 
-        case ( Opcode::sub ):
-            debugSignal( "cpu state", "sub execute" );
-            alu.setA( registers.getOut1() );
+    // to keep the code simple we are not using aluBMux explicitly
+    if ( micro.useAlu ) {
+        alu.setA( registers.getOut1() );
+        if ( micro.aluB == AluBSource::immediate )
+            alu.setB( immediate.getOutput() );
+        else
             alu.setB( registers.getOut2() );
-            alu.setControl( AluOps::sub );
+        alu.setControl( micro.aluOp );
 
-            aluResult.changeDriveSignal( alu.getResult() );
-            zero.changeDriveSignal( alu.getZeroFlag() );
-            positive.changeDriveSignal( alu.getPositiveFlag() );
- 
-            programCounter.changeDriveSignal( PCplus4.getOutput() );
-            break;
-
-        case ( Opcode::nand ):
-            debugSignal( "cpu state", "nand execute" );
-            alu.setA( registers.getOut1() );
-            alu.setB( registers.getOut2() );
-            alu.setControl( AluOps::nand );
+        aluResult.changeDriveSignal( alu.getResult() );
+        zero.changeDriveSignal( alu.getZeroFlag() );
+        positive.changeDriveSignal( alu.getPositiveFlag() );
+    }
 
-            aluResult.changeDriveSignal( alu.getResult() );
-            zero.changeDriveSignal( alu.getZeroFlag() );
-            positive.changeDriveSignal( alu.getPositiveFlag() );
- 
-            programCounter.changeDriveSignal( PCplus4.getOutput() );
+    switch ( micro.memory ) {
+        case ( MemoryOp::read ):
+            ram->setAddress( registers.getOut1() );
+            ram->setReadingThisCycle( true );
             break;
 
-        case ( Opcode::lshift ):
-            debugSignal( "cpu state", "lshift execute" );
-            alu.setA( registers.getOut1() );
-            alu.setB( registers.getOut2() );
-            alu.setControl( AluOps::lshift );
- 
-            aluResult.changeDriveSignal( alu.getResult() );
-            zero.changeDriveSignal( alu.getZeroFlag() );
-            positive.changeDriveSignal( alu.getPositiveFlag() );
- 
-            programCounter.changeDriveSignal( PCplus4.getOutput() );
+        case ( MemoryOp::write ):
+            ram->setAddress( registers.getOut1() );
+            ram->setReadingThisCycle( false ); // write
+            ram->setDataIn( registers.getOut2() );
+
+            // we might have written over an instruction we have already decoded
+            decodeCache.invalidate( registers.getOut1() );
             break;
 
-        case ( Opcode::addImmediate ):
-            debugSignal( "cpu state", "addImmediate execute" );
-            alu.setA( registers.getOut1() );
-            alu.setB( immediate.getOutput() );
-            alu.setControl( AluOps::add );
- 
-            aluResult.changeDriveSignal( alu.getResult() );
-            zero.changeDriveSignal( alu.getZeroFlag() );
-            positive.changeDriveSignal( alu.getPositiveFlag() );
- 
-            programCounter.changeDriveSignal( PCplus4.getOutput() );
+        case ( MemoryOp::none ):
             break;
+    }
 
-        case ( Opcode::subImmediate ):
-            debugSignal( "cpu state", "subImmediate execute" );
-            alu.setA( registers.getOut1() );
-            alu.setB( immediate.getOutput() );
-            alu.setControl( AluOps::sub );
- 
-            aluResult.changeDriveSignal( alu.getResult() );
-            zero.changeDriveSignal( alu.getZeroFlag() );
-            positive.changeDriveSignal( alu.getPositiveFlag() );
- 
+    switch ( micro.pc ) {
+        case ( PCSource::PCplus4 ):
             programCounter.changeDriveSignal( PCplus4.getOutput() );
             break;
 
-        case ( Opcode::jumpToReg ):
-            debugSignal( "cpu state", "Jump to Register execute" );
+        case ( PCSource::out1 ):
             programCounter.changeDriveSignal( registers.getOut1() );
-            
-            // no need to write anything. Skip to next instruction
-            controlUnitState.changeDriveSignal( ControlUnitStateEnum::Fetch );
             break;
 
-        case ( Opcode::branchIfZero ):
-            debugSignal( "cpu state", "Branch if zero execute" );
+        case ( PCSource::ifZero ):
             // using ifZeroMux as an if statement
             // this is using the value of zero from whenever the ALU last did
             //          something in the execute stage
             ifZeroMux.setInput( true, registers.getOut1() );
             ifZeroMux.setInput( false, PCplus4.getOutput() );
             ifZeroMux.setSelect( zero.getOutput() );
-
             programCounter.changeDriveSignal( ifZeroMux.getOutput() );
-             
-            // no need to write anything. Skip to next instruction
-            controlUnitState.changeDriveSignal( ControlUnitStateEnum::Fetch );
             break;
 
-        case ( Opcode::branchIfPositive ):
-            debugSignal( "cpu state", "Branch if positive execute" );
-            // see notes for branchIfZero
+        case ( PCSource::ifPositive ):
+            // see notes for ifZero
             ifPositiveMux.setInput( true, registers.getOut1() );
             ifPositiveMux.setInput( false, PCplus4.getOutput() );
             ifPositiveMux.setSelect( positive.getOutput() );
             programCounter.changeDriveSignal( ifPositiveMux.getOutput() );
-             
-            // no need to write anything. Skip to next instruction
-            controlUnitState.changeDriveSignal( ControlUnitStateEnum::Fetch );
-            break;
-
-        case ( Opcode::load ):
-            debugSignal( "cpu state", "load execute" );
-            ram->setAddress( registers.getOut1() );
-            ram->setReadingThisCycle( true );
- 
-            programCounter.changeDriveSignal( PCplus4.getOutput() );
             break;
 
-        case ( Opcode::store ):
-            debugSignal( "cpu state", "store execute" );
-            ram->setAddress( registers.getOut1() );
-            ram->setReadingThisCycle( false ); // write
-            ram->setDataIn( registers.getOut2() );
- 
-            programCounter.changeDriveSignal( PCplus4.getOutput() );
-             
-            // no need to write anything. Skip to next instruction
-            controlUnitState.changeDriveSignal( ControlUnitStateEnum::Fetch );
+        case ( PCSource::none ):
             break;
+    }
 
-        case ( Opcode::nop ):
-            // nothing needs doing
-            debugSignal( "cpu state", "nop execute" );
-            programCounter.changeDriveSignal( PCplus4.getOutput() );
-             
-            // no need to write anything. Skip to next instruction
-            controlUnitState.changeDriveSignal( ControlUnitStateEnum::Fetch );
-            break;
-
-        case ( Opcode::printBuffer):
-            debugSignal( "cpu state", "serial write" );
-            ram->printBuffer();
-            programCounter.changeDriveSignal( PCplus4.getOutput() );
-
-            // skip writeback
-            controlUnitState.changeDriveSignal( ControlUnitStateEnum::Fetch );
+    switch ( micro.system ) {
+        case ( SystemOp::printBuffer ):
+            ram->printBuffer( *video );
             break;
 
-        case ( Opcode::halt ):
-            debugSignal( "cpu state", "halt execute" );
+        case ( SystemOp::halt ):
             halted.changeDriveSignal( true );
             programCounter.reset(); // errExit if we don't actually halt
             break;
 
-        default:
-            errExit( "In cpu/execute, invalid opcode" );
+        case ( SystemOp::none ):
+            break;
     }
 }
 
-inline void CPU::write( void ) {
+template <typename Checking>
+inline void BasicCPU<Checking>::write( void ) {
     debugSignal( "cpu state", "write" );
-    switch ( currentOpcode.getOutput() ) {
-        case ( Opcode::addImmediate ):
-        case ( Opcode::subImmediate ):
+    const MicroInstruction &micro = microcodeFor( currentOpcode.getOutput() );
+
+    switch ( micro.writeback ) {
+        case ( Writeback::aluToR1 ):
             // write the result back to register 1
             registers.setReadThisCycle( false ); // write
             registers.setWriteSelect( 1 );
             registers.setWriteData( aluResult.getOutput() );
             break;
 
-        case ( Opcode::add ):
-        case ( Opcode::sub ):
-        case ( Opcode::nand ):
-        case ( Opcode::lshift ):
+        case ( Writeback::aluToResult ):
             // write back to the specified register
             registers.setReadThisCycle( false ); // write
             registers.setWriteSelect( resultArg.getOutput() );
             registers.setWriteData( aluResult.getOutput() );
             break;
 
-        case ( Opcode::load ):
+        case ( Writeback::ramToResult ):
             registers.setReadThisCycle( false ); // write
             registers.setWriteSelect( resultArg.getOutput() );
             registers.setWriteData( ram->getOutput() );
             break;
-        
-        case ( Opcode::nop ):
-        case ( Opcode::jumpToReg ):
-        case ( Opcode::branchIfZero ):
-        case ( Opcode::branchIfPositive ):
-        case ( Opcode::store ):
-        case ( Opcode::halt ):
-            errExit( "we should have skipped write for that opcode" );
-            break;
 
-        default:
-            errExit( "cpu/write invalid opcode" );
+        case ( Writeback::none ):
+            if ( micro.valid )
+                errExit( "we should have skipped write for that opcode" );
+            else
+                errExit( ErrorKind::invalidOpcode, "cpu/write invalid opcode" );
+            break;
     }
 
     controlUnitState.changeDriveSignal( ControlUnitStateEnum::Fetch );
 }
 
-CPU::CPU( const std::vector<int32_t> &InitialRamData ) {
-    ram = new RamAddrTran<int32_t, 10240> ( InitialRamData );
+template <typename Checking>
+BasicCPU<Checking>::BasicCPU( const std::vector<int32_t> &InitialRamData ) {
+    ram = new RamAddrTran<int32_t, ramBytes, Checking> ( InitialRamData );
+    start();
+}
+
+template <typename Checking>
+BasicCPU<Checking>::BasicCPU( const std::shared_ptr<const MainMemoryImage> &image ) {
+    ram = new RamAddrTran<int32_t, ramBytes, Checking> ( image );
+    start();
+}
+
+template <typename Checking>
+void BasicCPU<Checking>::start( void ) {
+    video = &terminalVideo();
+    resetCore();
+}
+
+template <typename Checking>
+void BasicCPU<Checking>::resetCore( void ) {
+    cycleCount = 0;
+    faulted = false;
 
     halted.changeDriveSignal( false );
     halted.clockTick();
@@ -327,24 +243,53 @@ CPU::CPU( const std::vector<int32_t> &InitialRamData ) {
     programCounter.clockTick();
 }
 
-CPU::~CPU( void ) {
+template <typename Checking>
+BasicCPU<Checking>::~BasicCPU( void ) {
     delete ram;
 }
 
-bool CPU::clockTick( void ) {
+template <typename Checking>
+void BasicCPU<Checking>::reset( const std::vector<int32_t> &InitialRamData ) {
+    ram->reset( InitialRamData );
+    resetRegisters();
+}
+
+template <typename Checking>
+void BasicCPU<Checking>::reset( const std::shared_ptr<const MainMemoryImage> &image ) {
+    ram->reset( image );
+    resetRegisters();
+}
+
+template <typename Checking>
+void BasicCPU<Checking>::resetRegisters( void ) {
+    registers.reset();
+
+    programCounter.reset();
+    PCplus4.reset();
+    resultArg.reset();
+    immediate.reset();
+    aluResult.reset();
+    zero.reset();
+    positive.reset();
+    halted.reset();
+    controlUnitState.reset();
+    currentOpcode.reset();
+
+    decodeCache.reset();
+    resetCore();
+}
+
+template <typename Checking>
+bool BasicCPU<Checking>::clockTick( void ) {
     // don't bother doing anything if we are halted
     if ( halted.getOutput() )
         return halted.getOutput();
 
+    cycleCount++;
+
     // all of the combinational logic must not remember stuff from the previous cycle
-    alu.undefine();
-    decoder.undefine();
-    //aluBMx.undefine();
-    //PCMux.undefine();
-    ifZeroMux.undefine();
-    ifPositiveMux.undefine();
-    //regWriteSelectMux.undefine();
-    //regWriteDataMux.undefine();
+    // the alu, decoder and muxes are made of CombinationalSignals so this undefines all of them
+    advanceCombinationalEpoch();
 
     // do all combinational logic
     switch( controlUnitState.getOutput() ) {
@@ -385,6 +330,157 @@ bool CPU::clockTick( void ) {
     return halted.getOutput();   
 }
 
-int32_t CPU::debugRamRead( int32_t addr ) {
+template <typename Checking>
+RunStatus BasicCPU<Checking>::run( uint64_t maxCycles ) {
+    if ( faulted )
+        return RunStatus::faulted;
+
+    ScopedErrorHandler handler( throwFault, NULL );
+
+    try {
+        bool isHalted = halted.getOutput();
+        while ( !isHalted && (cycleCount < maxCycles) )
+            isHalted = clockTick();
+
+        return isHalted ? RunStatus::halted : RunStatus::cycleLimit;
+    } catch ( const FaultThrown &thrown ) {
+        faulted = true;
+        fault.kind = thrown.kind;
+        fault.message = thrown.message;
+        fault.pc = faultAddress();
+        fault.cycle = cycleCount;
+        return RunStatus::faulted;
+    }
+}
+
+template <typename Checking>
+int32_t BasicCPU<Checking>::faultAddress( void ) {
+    // the registers have not been clocked yet so these are the values from the start of the clock tick
+    // by the write stage the program counter has moved on to the next instruction
+    if ( controlUnitState.isDefined() && (controlUnitState.getOutput() == ControlUnitStateEnum::Write) ) {
+        if ( PCplus4.isDefined() )
+            return PCplus4.getOutput() - sizeof(int32_t);
+    } else if ( programCounter.isDefined() ) {
+        return programCounter.getOutput();
+    }
+
+    return -1;
+}
+
+template <typename Checking>
+bool BasicCPU<Checking>::hasFaulted( void ) {
+    return faulted;
+}
+
+template <typename Checking>
+const CPUFault& BasicCPU<Checking>::getFault( void ) {
+    return fault;
+}
+
+template <typename Checking>
+void BasicCPU<Checking>::saveCore( CPUCoreState &state ) {
+    registers.saveState( state.registers );
+
+    programCounter.saveState( state.programCounter );
+    PCplus4.saveState( state.PCplus4 );
+    resultArg.saveState( state.resultArg );
+    immediate.saveState( state.immediate );
+    aluResult.saveState( state.aluResult );
+    zero.saveState( state.zero );
+    positive.saveState( state.positive );
+    halted.saveState( state.halted );
+    controlUnitState.saveState( state.controlUnitState );
+    currentOpcode.saveState( state.currentOpcode );
+
+    state.cycleCount = cycleCount;
+}
+
+template <typename Checking>
+void BasicCPU<Checking>::snapshot( CPUState &state ) {
+    saveCore( state.core );
+    ram->saveState( state.ram );
+}
+
+template <typename Checking>
+void BasicCPU<Checking>::snapshotDirty( CPUState &state, std::vector<unsigned int> &pages ) {
+    saveCore( state.core );
+    ram->saveDirtyState( state.ram, pages );
+}
+
+template <typename Checking>
+void BasicCPU<Checking>::restore( const CPUState &state ) {
+    const CPUCoreState &core = state.core;
+
+    registers.restoreState( core.registers );
+    ram->restoreState( state.ram );
+
+    programCounter.restoreState( core.programCounter );
+    PCplus4.restoreState( core.PCplus4 );
+    resultArg.restoreState( core.resultArg );
+    immediate.restoreState( core.immediate );
+    aluResult.restoreState( core.aluResult );
+    zero.restoreState( core.zero );
+    positive.restoreState( core.positive );
+    halted.restoreState( core.halted );
+    controlUnitState.restoreState( core.controlUnitState );
+    currentOpcode.restoreState( core.currentOpcode );
+
+    cycleCount = core.cycleCount;
+    faulted = false;
+
+    // the instructions in memory are probably different now
+    decodeCache.invalidateAll();
+}
+
+template <typename Checking>
+unsigned int BasicCPU<Checking>::privateRamPages( void ) {
+    return ram->privatePages();
+}
+
+template <typename Checking>
+int32_t BasicCPU<Checking>::debugRamRead( int32_t addr ) {
     return ram->debugRead( addr );
 }
+
+template <typename Checking>
+void BasicCPU<Checking>::copyRamOut( int8_t* dest ) {
+    ram->copyOut( dest );
+}
+
+template <typename Checking>
+uint64_t BasicCPU<Checking>::getCycleCount( void ) {
+    return cycleCount;
+}
+
+template <typename Checking>
+uint64_t BasicCPU<Checking>::getDecodeCacheHits( void ) {
+    return decodeCache.getHits();
+}
+
+template <typename Checking>
+uint64_t BasicCPU<Checking>::getDecodeCacheMisses( void ) {
+    return decodeCache.getMisses();
+}
+
+template <typename Checking>
+void BasicCPU<Checking>::setVideoOutput( VideoOutput &output ) {
+    video = &output;
+}
+
+template <typename Checking>
+VideoOutput& BasicCPU<Checking>::getVideoOutput( void ) {
+    return *video;
+}
+
+template <typename Checking>
+ControlUnitStateEnum BasicCPU<Checking>::getControlUnitState( void ) {
+    return controlUnitState.getOutput();
+}
+
+template <typename Checking>
+int32_t BasicCPU<Checking>::getProgramCounter( void ) {
+    return programCounter.getOutput();
+}
+
+template class BasicCPU<Checked>;
+template class BasicCPU<Unchecked>;
@@ -19,11 +19,16 @@
 
 #include <stdint.h>
 #include <vector>
+#include <type_traits>
+#include <memory>
+#include <string>
 
 //#include "../emulator/Bus.h"
+#include "../emulator/debug.h"
 #include "../emulator/mux.h"
 #include "alu.h"
 #include "Decoder.h"
+#include "DecodeCache.h"
 #include "../emulator/Register.h"
 #include "../emulator/RegisterFile.h"
 #include "muxControlEnums.h"
@@ -31,30 +36,81 @@
 #include "ControlUnitState.h"
 //#include "ram.h"
 #include "RamAddrTranslator.h"
+#include "MemoryMap.h"
 #include "Opcodes.h"
+#include "CPUFault.h"
 
-class CPU {
+// everything in a CPU which lasts from one clock tick to the next apart from the RAM
+// the ALU, decoder and multiplexers are not here because they are combinational: nothing in them is
+//      remembered between clock ticks
+// this is the same for both checking policies. Unchecked Signals are saved as defined
+struct CPUCoreState {
+    RegisterFileState<int32_t, 32> registers;
+
+    RegisterState<int32_t> programCounter;
+    RegisterState<int32_t> PCplus4;
+    RegisterState<uint8_t> resultArg;
+    RegisterState<int32_t> immediate;
+    RegisterState<int32_t> aluResult;
+    RegisterState<bool> zero;
+    RegisterState<bool> positive;
+    RegisterState<bool> halted;
+    RegisterState<ControlUnitStateEnum> controlUnitState;
+    RegisterState<Opcode> currentOpcode;
+
+    uint64_t cycleCount;
+};
+
+// the whole CPU as plain data so that it can be copied around with memcpy
+struct CPUState {
+    CPUCoreState core;
+    RamAddrTranState<ramBytes> ram;
+};
+
+static_assert( std::is_pod<CPUState>::value, "CPUState must be plain data" );
+
+// what the main memory of a CPU starts with. Any number of CPUs can share one (see RAMImage in ram.h)
+typedef RAMImage<mainMemoryBytes> MainMemoryImage;
+
+// Checking is the policy used by every Signal in the datapath (see emulator/CheckingPolicy.h)
+// the members are defined in CPU.cpp, which instantiates this for Checked and Unchecked
+template <typename Checking>
+class BasicCPU {
     private:
         // big parts
-        ALU alu;
-        Decoder decoder;
-        RegisterFile<int32_t, uint8_t, 32> registers; // user registers
+        BasicALU<Checking> alu;
+        BasicDecoder<Checking> decoder;
+        RegisterFile<int32_t, uint8_t, 32, Checking> registers; // user registers
         
         // not really part of a cpu but included here for simplicity
-        RamAddrTran<int32_t, 10240>* ram; // 10240 bytes of ram
+        RamAddrTran<int32_t, ramBytes, Checking>* ram; // 10240 bytes of ram
 
         // special purpose registers
-        Register<int32_t> programCounter;
-        Register<int32_t> PCplus4;
-        Register<uint8_t> resultArg;
-        Register<int32_t> immediate;
-        Register<int32_t> aluResult;
-        Register<bool> zero;
-        Register<bool> positive;
+        Register<int32_t, Checking> programCounter;
+        Register<int32_t, Checking> PCplus4;
+        Register<uint8_t, Checking> resultArg;
+        Register<int32_t, Checking> immediate;
+        Register<int32_t, Checking> aluResult;
+        Register<bool, Checking> zero;
+        Register<bool, Checking> positive;
 //        Register<int32_t> ramRead;
-        Register<bool> halted;
-        Register<ControlUnitStateEnum> controlUnitState;
-        Register<Opcode> currentOpcode;
+        Register<bool, Checking> halted;
+        Register<ControlUnitStateEnum, Checking> controlUnitState;
+        Register<Opcode, Checking> currentOpcode;
+
+        // not part of the hardware. Counts clock ticks until we halt
+        uint64_t cycleCount;
+
+        // set by run when the program faults. The CPU is left part way through a clock tick so it
+        //      cannot carry on until it is reset or restored
+        bool faulted;
+        CPUFault fault;
+
+        // where printBuffer sends frames
+        VideoOutput* video;
+
+        // not part of the hardware. Saves decoding the same instruction over and over again
+        DecodeCache<ramBytes> decodeCache;
         
         // interface with ram
         //Bus<int32_t> ramDataBus;
@@ -62,11 +118,29 @@ class CPU {
         // multiplexers
         //Mux<AluBMuxControl, int32_t> aluBMux;
         //Mux<PCMuxControl, int32_t> PCMux;
-        Mux<bool, int32_t> ifZeroMux;
-        Mux<bool, int32_t> ifPositiveMux;
+        FixedMux<bool, int32_t, 2, Checking> ifZeroMux;
+        FixedMux<bool, int32_t, 2, Checking> ifPositiveMux;
         //Mux<RegWriteSelectMuxControl, uint8_t> regWriteSelectMux;
         //Mux<RegWriteDataMuxControl, int32_t> regWriteDataMux;
     
+        // not copyable because we own ram. Use snapshot and restore to copy the state instead
+        BasicCPU( const BasicCPU& );
+        BasicCPU& operator=( const BasicCPU& );
+
+        void saveCore( CPUCoreState &state );
+
+        // where the instruction running in the clock tick which faulted came from
+        int32_t faultAddress( void );
+
+        // everything the constructors have in common apart from the RAM
+        void start( void );
+
+        // the registers which start defined (see start)
+        void resetCore( void );
+
+        // everything apart from the RAM back to how the constructors leave it
+        void resetRegisters( void );
+
         // control unit combinational logic for each state
         void fetch( void );
         void decode( void );
@@ -74,14 +148,66 @@ class CPU {
         void write( void );
 
     public:
-        CPU( const std::vector<int32_t> &InitialRamData );
-        ~CPU( void );
+        BasicCPU( const std::vector<int32_t> &InitialRamData );
+
+        // the main memory starts as image. Memory is only copied when it is written to, so lots of
+        //      CPUs running the same program use a lot less memory this way
+        BasicCPU( const std::shared_ptr<const MainMemoryImage> &image );
+        ~BasicCPU( void );
+
+        // start again with a new program as if we had just been constructed, without allocating any
+        //      memory if this CPU has already run something like it. The video output is kept
+        void reset( const std::vector<int32_t> &InitialRamData );
+        void reset( const std::shared_ptr<const MainMemoryImage> &image );
 
         bool clockTick( void ); // returns wheather or not we are halted
 
+        // clock ticks until we halt, the cycle count reaches maxCycles or the program faults. Faults
+        //      are returned instead of going to errExit, so one bad program does not stop the others
+        //      in the process. Once faulted, run returns straight away until reset or restore
+        RunStatus run( uint64_t maxCycles = UINT64_MAX );
+        bool hasFaulted( void );
+        const CPUFault& getFault( void ); // only meaningful if hasFaulted
+
         // this should only be used in automated testing to check the correct values 
         // made it to RAM
         int32_t debugRamRead( int32_t addr );
+
+        // all ramBytes of RAM as they are stored, including what has never been written (which
+        //      debugRamRead would fail on with Checked signals)
+        void copyRamOut( int8_t* dest );
+
+        // number of clock ticks so far (including the one which halted)
+        uint64_t getCycleCount( void );
+
+        // RAM pages (RAM_PAGE_BYTES each) which have been written so are not shared with the image
+        unsigned int privateRamPages( void );
+
+        // statistics for the decoded instruction cache
+        uint64_t getDecodeCacheHits( void );
+        uint64_t getDecodeCacheMisses( void );
+
+        // printBuffer sends frames to output instead of the terminal. output must outlive us
+        void setVideoOutput( VideoOutput &output );
+        VideoOutput& getVideoOutput( void );
+
+        // copy our state out in between clock ticks
+        void snapshot( CPUState &state );
+
+        // carry on from a state saved by snapshot (from this CPU or any other). RAM pages which are the
+        //      same as the image we started from go back to being shared with it
+        void restore( const CPUState &state );
+
+        // bring a state saved by snapshot up to date, copying only the RAM pages which have been written
+        //      since the last snapshot or restore. The numbers of the pages copied are added to pages
+        //      (see readPage in RamAddrTranslator.h)
+        void snapshotDirty( CPUState &state, std::vector<unsigned int> &pages );
+
+        // for comparing with LevelizedCPU cycle by cycle. There is no program counter once we have halted
+        ControlUnitStateEnum getControlUnitState( void );
+        int32_t getProgramCounter( void );
 };
 
+typedef BasicCPU<DefaultChecking> CPU;
+
 #endif
@@ -0,0 +1,50 @@
+// what CPU::run and FastCPU::run return, and how they catch faults in the program
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef CPU_FAULT_H
+#define CPU_FAULT_H
+
+#include "../emulator/debug.h"
+#include <stdint.h>
+#include <string>
+
+// why run returned
+enum class RunStatus {
+    halted,
+    cycleLimit, // the cycle count reached maxCycles first
+    faulted     // the program did something wrong (see CPUFault)
+};
+
+// something the program did which would otherwise have been passed to errExit
+struct CPUFault {
+    ErrorKind kind;
+    std::string message;
+    int32_t pc;     // address of the instruction which faulted, or -1 if that is not known
+    uint64_t cycle; // the clock tick it happened in, counted the same way as getCycleCount
+};
+
+// run puts this in as the error handler while the program runs, so a fault is thrown back to run
+//      as a FaultThrown instead of exiting
+struct FaultThrown {
+    ErrorKind kind;
+    std::string message;
+};
+
+inline void throwFault( ErrorKind kind, const std::string &message, void* context ) {
+    (void) context;
+    FaultThrown thrown = { kind, message };
+    throw thrown;
+}
+
+#endif
@@ -0,0 +1,128 @@
+// CPUs made once and then reused for one program after another
+// Making a CPU allocates its RAM; resetting one which has already run a program reuses the memory it
+// has, so once every CPU in the pool has been used, handing them out does not allocate anything
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef CPU_POOL_H
+#define CPU_POOL_H
+
+#include "CPU.h"
+#include "Video.h"
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// acquire and release can be called from any thread
+template <typename Checking = DefaultChecking>
+class BasicCPUPool {
+    private:
+        std::mutex lock;
+        std::vector< std::unique_ptr< BasicCPU<Checking> > > cpus; // every CPU we have made
+        std::vector< BasicCPU<Checking>* > idle;
+
+        BasicCPUPool( const BasicCPUPool& );
+        BasicCPUPool& operator=( const BasicCPUPool& );
+
+        // called with lock held
+        void grow( void ) {
+            cpus.push_back( std::unique_ptr< BasicCPU<Checking> >( new BasicCPU<Checking>( std::vector<int32_t>() ) ) );
+            idle.reserve( cpus.size() ); // so release never has to allocate
+            idle.push_back( cpus.back().get() );
+        }
+
+        // an idle CPU, making a new one if there are none left
+        BasicCPU<Checking>* take( void ) {
+            std::lock_guard<std::mutex> guard( lock );
+
+            if ( idle.empty() )
+                grow();
+
+            BasicCPU<Checking>* cpu = idle.back();
+            idle.pop_back();
+            return cpu;
+        }
+
+    public:
+        // start with size CPUs ready
+        BasicCPUPool( unsigned int size ) {
+            cpus.reserve( size );
+            for ( unsigned int i = 0; i < size; i++ )
+                grow();
+        }
+
+        // a CPU reset to run program (a vector or a MainMemoryImage). Give it back with release
+        template <typename Program>
+        BasicCPU<Checking>* acquire( const Program &program ) {
+            BasicCPU<Checking>* cpu = take();
+
+            // errExit can throw if a ScopedErrorHandler says so (the program might not fit)
+            try {
+                cpu->reset( program );
+            } catch ( ... ) {
+                release( cpu );
+                throw;
+            }
+
+            return cpu;
+        }
+
+        // cpu must have come from acquire. Its video output goes back to the terminal so that it is not
+        //      left pointing at something which might not outlive it
+        void release( BasicCPU<Checking>* cpu ) {
+            cpu->setVideoOutput( terminalVideo() );
+
+            std::lock_guard<std::mutex> guard( lock );
+            idle.push_back( cpu );
+        }
+
+        // number of CPUs made so far, including the ones made by the constructor
+        unsigned int size( void ) {
+            std::lock_guard<std::mutex> guard( lock );
+            return cpus.size();
+        }
+};
+
+// a CPU from a pool for as long as this is in scope
+template <typename Checking = DefaultChecking>
+class BasicPooledCPU {
+    private:
+        BasicCPUPool<Checking> &pool;
+        BasicCPU<Checking>* cpu;
+
+        BasicPooledCPU( const BasicPooledCPU& );
+        BasicPooledCPU& operator=( const BasicPooledCPU& );
+
+    public:
+        template <typename Program>
+        BasicPooledCPU( BasicCPUPool<Checking> &Pool, const Program &program )
+            : pool( Pool ), cpu( Pool.acquire( program ) ) {}
+
+        ~BasicPooledCPU( void ) {
+            pool.release( cpu );
+        }
+
+        BasicCPU<Checking>* operator->( void ) {
+            return cpu;
+        }
+
+        BasicCPU<Checking>& operator*( void ) {
+            return *cpu;
+        }
+};
+
+typedef BasicCPUPool<DefaultChecking> CPUPool;
+typedef BasicPooledCPU<DefaultChecking> PooledCPU;
+
+#endif
@@ -0,0 +1,97 @@
+// cache of decoded instructions, indexed by the address they were fetched from
+// Not part of the hardware. This saves the emulator from decoding the same instruction every time it
+// goes around a loop. Entries are invalidated when a store writes over them so self-modifying code
+// still works.
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef DECODE_CACHE_H
+#define DECODE_CACHE_H
+
+#include "Decoder.h"
+#include <stdint.h>
+#include <string.h>
+
+// numBytes is the size of the address space. Only word aligned addresses are cached
+template <unsigned int numBytes>
+class DecodeCache {
+    private:
+        static const unsigned int numEntries = numBytes / sizeof(int32_t);
+
+        DecodedInstruction entries[numEntries];
+        bool valid[numEntries];
+
+        uint64_t hits;
+        uint64_t misses;
+
+    public:
+        DecodeCache( void ) {
+            memset( valid, 0, sizeof(valid) );
+            hits = 0;
+            misses = 0;
+        }
+
+        // returns true and sets ret if the instruction at addr is cached
+        bool lookup( int32_t addr, DecodedInstruction &ret ) {
+            uint32_t index = static_cast<uint32_t>(addr) / sizeof(int32_t);
+
+            if ( ((addr % sizeof(int32_t)) == 0) && (index < numEntries) && valid[index] ) {
+                hits++;
+                ret = entries[index];
+                return true;
+            }
+
+            misses++;
+            return false;
+        }
+
+        void fill( int32_t addr, const DecodedInstruction &inst ) {
+            uint32_t index = static_cast<uint32_t>(addr) / sizeof(int32_t);
+
+            if ( ((addr % sizeof(int32_t)) == 0) && (index < numEntries) ) {
+                entries[index] = inst;
+                valid[index] = true;
+            }
+        }
+
+        // a word has been written at addr. This might not be word aligned so it can cover two entries
+        void invalidate( int32_t addr ) {
+            uint32_t first = static_cast<uint32_t>(addr) / sizeof(int32_t);
+            uint32_t last = ( static_cast<uint32_t>(addr) + sizeof(int32_t) - 1 ) / sizeof(int32_t);
+
+            for ( uint32_t i = first; (i <= last) && (i < numEntries); i++ )
+                valid[i] = false;
+        }
+
+        // the whole of memory might have changed
+        void invalidateAll( void ) {
+            memset( valid, 0, sizeof(valid) );
+        }
+
+        // empty, with the statistics back to zero
+        void reset( void ) {
+            invalidateAll();
+            hits = 0;
+            misses = 0;
+        }
+
+        uint64_t getHits( void ) {
+            return hits;
+        }
+
+        uint64_t getMisses( void ) {
+            return misses;
+        }
+};
+
+#endif
@@ -19,7 +19,8 @@
 
 // decoders for different instruction formats
 // add sub nand lshift
-void Decoder::decodeArgs3Reg( void ) {
+template <typename Checking>
+void BasicDecoder<Checking>::decodeArgs3Reg( void ) {
     // arguements are A, B and result
     A.setValue( get5BitsAtOffset( 5 ) );
     B.setValue( get5BitsAtOffset( 10 ) );
@@ -27,7 +28,8 @@ void Decoder::decodeArgs3Reg( void ) {
 }
 
 // addImmediate, subImmediate
-void Decoder::decodeArgsImmediate( void ) {
+template <typename Checking>
+void BasicDecoder<Checking>::decodeArgsImmediate( void ) {
     // arguements are A and result
     A.setValue( get5BitsAtOffset( 5 ) );
 
@@ -38,12 +40,14 @@ void Decoder::decodeArgsImmediate( void ) {
 }
 
 // jumpToReg, branchIfZero, branchIfPositive
-void Decoder::decodeArgs1Reg( void ) {
+template <typename Checking>
+void BasicDecoder<Checking>::decodeArgs1Reg( void ) {
     // A is the only arguement
     A.setValue( get5BitsAtOffset( 5 ) );
 }
 
-uint8_t Decoder::get5BitsAtOffset( uint8_t offset ) {
+template <typename Checking>
+uint8_t BasicDecoder<Checking>::get5BitsAtOffset( uint8_t offset ) {
     uint32_t word = memoryWord.getValue();
     word = word >> offset;
     
@@ -57,7 +61,8 @@ uint8_t Decoder::get5BitsAtOffset( uint8_t offset ) {
     return ret;
 }
 
-void Decoder::setMemoryWord( uint32_t inMemoryWord ) {
+template <typename Checking>
+void BasicDecoder<Checking>::setMemoryWord( uint32_t inMemoryWord ) {
     // invalidate old outputs
     undefine();
 
@@ -103,31 +108,50 @@ void Decoder::setMemoryWord( uint32_t inMemoryWord ) {
             break;
 
         default:
-            errExit( "decoding invalid opcode (cpu/Decoder.cpp)" );
+            errExit( ErrorKind::invalidOpcode, "decoding invalid opcode (cpu/Decoder.cpp)" );
     }
 }
 
-Opcode Decoder::getOpcode( void ) {
+template <typename Checking>
+Opcode BasicDecoder<Checking>::getOpcode( void ) {
     return Op.getValue();
 }
 
-uint8_t Decoder::getA( void ) {
+template <typename Checking>
+uint8_t BasicDecoder<Checking>::getA( void ) {
     return A.getValue();
 }
 
-uint8_t Decoder::getB( void ) {
+template <typename Checking>
+uint8_t BasicDecoder<Checking>::getB( void ) {
     return B.getValue();
 }
 
-uint8_t Decoder::getResult( void ) {
+template <typename Checking>
+uint8_t BasicDecoder<Checking>::getResult( void ) {
     return result.getValue();
 }
 
-int32_t Decoder::getImmediate( void ) {
+template <typename Checking>
+int32_t BasicDecoder<Checking>::getImmediate( void ) {
     return immediate.getValue();
 }
 
-void Decoder::undefine( void ) {
+template <typename Checking>
+DecodedInstruction BasicDecoder<Checking>::getDecodedInstruction( void ) {
+    DecodedInstruction ret;
+
+    ret.op = Op.getValue();
+    ret.A = A.isDefined() ? A.getValue() : 0;
+    ret.B = B.isDefined() ? B.getValue() : 0;
+    ret.result = result.isDefined() ? result.getValue() : 0;
+    ret.immediate = immediate.isDefined() ? immediate.getValue() : 0;
+
+    return ret;
+}
+
+template <typename Checking>
+void BasicDecoder<Checking>::undefine( void ) {
     memoryWord.undefine();
     Op.undefine();
     A.undefine();
@@ -136,3 +160,6 @@ void Decoder::undefine( void ) {
     immediate.undefine();
 }
     
+
+template class BasicDecoder<Checked>;
+template class BasicDecoder<Unchecked>;
@@ -28,17 +28,30 @@
 #define DECODER_H
 
 #include "../emulator/Signal.h"
+#include "../emulator/CombinationalSignal.h"
 #include "Opcodes.h"
 #include <stdint.h>
 
-class Decoder {
+// all of the outputs of the decoder at once. Fields which the opcode does not use are 0
+//      (unless the decoder is Unchecked, when they are left over from an earlier instruction)
+struct DecodedInstruction {
+    Opcode op;
+    uint8_t A;
+    uint8_t B;
+    uint8_t result;
+    int32_t immediate;
+};
+
+// the members are defined in Decoder.cpp, which instantiates this for Checked and Unchecked
+template <typename Checking>
+class BasicDecoder {
     private:
-        Signal<uint32_t> memoryWord;
-        Signal<Opcode> Op;
-        Signal<uint8_t> A;
-        Signal<uint8_t> B;
-        Signal<uint8_t> result;
-        Signal<int32_t> immediate;
+        CombinationalSignal<uint32_t, Checking> memoryWord;
+        CombinationalSignal<Opcode, Checking> Op;
+        CombinationalSignal<uint8_t, Checking> A;
+        CombinationalSignal<uint8_t, Checking> B;
+        CombinationalSignal<uint8_t, Checking> result;
+        CombinationalSignal<int32_t, Checking> immediate;
 
         // decoders for different instruction formats
         // add, sub, nand, lshift
@@ -62,7 +75,12 @@ class Decoder {
         uint8_t getResult( void );
         int32_t getImmediate( void );
 
+        // only reads the outputs which are defined for the current opcode
+        DecodedInstruction getDecodedInstruction( void );
+
         void undefine( void );
 };
 
+typedef BasicDecoder<DefaultChecking> Decoder;
+
 #endif
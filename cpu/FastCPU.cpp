@@ -0,0 +1,397 @@
+// functional model of the cpu. See header file
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "FastCPU.h"
+#include "Microcode.h"
+#include "../emulator/debug.h"
+#include <string.h>
+#include <endian.h>
+
+// the control unit always does fetch, decode and execute. Only some opcodes need a write stage
+// (halt is not one of them: the CPU stops before it gets to write)
+unsigned int FastCPU::cyclesFor( Opcode op ) {
+    return ( microcodeFor( op ).writeback != Writeback::none ) ? 4 : 3;
+}
+
+FastCPU::FastCPU( const std::vector<int32_t> &InitialRamData ) {
+    if ( InitialRamData.size() > mainMemoryBytes/sizeof(int32_t) )
+        errExit( "Initial RAM data does not fit" );
+
+    memset( registers, 0, sizeof(registers) );
+    memset( memory, 0, mainMemoryBytes );
+    memset( memory + mainMemoryBytes, 0x23, videoBytes ); // '#' = 0x23, like RamAddrTran
+
+    if ( InitialRamData.size() > 0 )
+        memcpy( memory, &InitialRamData[0], InitialRamData.size() * sizeof(int32_t) );
+
+    for ( unsigned int i = 0; i < numWords; i++ )
+        translations[i].valid = false;
+    memset( &fusionStats, 0, sizeof(fusionStats) );
+
+    programCounter = 0;
+    zero = false;
+    positive = false;
+    flagsSet = false;
+    halted = false;
+    faulted = false;
+    cycleCount = 0;
+    cyclesOwed = 0;
+    video = &terminalVideo();
+}
+
+void FastCPU::validateAddress( int32_t addr ) {
+    // a word must fit inside either the main memory or the video memory
+    uint32_t address = addr; // negative addresses become huge
+    if ( address > ramBytes - sizeof(int32_t) )
+        errExit( ErrorKind::badAddress, "Invalid memory address given to FastCPU" );
+
+    if ( (address > mainMemoryBytes - sizeof(int32_t)) && (address < mainMemoryBytes) )
+        errExit( ErrorKind::badAddress, "FastCPU: specified address does not exist" );
+}
+
+int32_t FastCPU::readWord( int32_t addr ) {
+    int32_t word;
+    memcpy( &word, memory + addr, sizeof(int32_t) );
+    return word;
+}
+
+// the arithmetic is done unsigned so that overflow wraps around like it does in the ALU
+static inline int32_t aluAdd( int32_t a, int32_t b ) {
+    return static_cast<int32_t>( static_cast<uint32_t>(a) + static_cast<uint32_t>(b) );
+}
+
+static inline int32_t aluSub( int32_t a, int32_t b ) {
+    return static_cast<int32_t>( static_cast<uint32_t>(a) - static_cast<uint32_t>(b) );
+}
+
+// the shift amount is masked like it is by the x86 shift instruction used by the ALU
+static inline int32_t aluLshift( int32_t a, int32_t b ) {
+    return static_cast<int32_t>( static_cast<uint32_t>(a) << (b & 31) );
+}
+
+FastInstruction FastCPU::decodeWord( uint32_t word ) {
+    FastInstruction ret;
+
+    ret.op = static_cast<Opcode>( word & 0x1F );
+    ret.A = (word >> 5) & 0x1F;
+    ret.B = (word >> 10) & 0x1F;
+    ret.dest = (word >> 15) & 0x1F;
+    ret.immediate = static_cast<int32_t>(word) >> 10; // sign extended
+
+    if ( (ret.op == Opcode::addImmediate) || (ret.op == Opcode::subImmediate) )
+        ret.dest = 1;
+
+    return ret;
+}
+
+void FastCPU::setFlags( int32_t result ) {
+    zero = ( result == 0 );
+    positive = ( result >= 0 );
+    flagsSet = true;
+}
+
+void FastCPU::storeWord( int32_t addr, int32_t data ) {
+    validateAddress( addr );
+    memcpy( memory + addr, &data, sizeof(int32_t) );
+    invalidateTranslations( addr );
+}
+
+unsigned int FastCPU::execute( const FastInstruction &inst ) {
+    int32_t result;
+    int32_t nextPC = aluAdd( programCounter, sizeof(int32_t) );
+
+    switch ( inst.op ) {
+        case ( Opcode::add ):
+            result = aluAdd( registers[inst.A], registers[inst.B] );
+            break;
+
+        case ( Opcode::sub ):
+            result = aluSub( registers[inst.A], registers[inst.B] );
+            break;
+
+        case ( Opcode::nand ):
+            result = ~( registers[inst.A] & registers[inst.B] );
+            break;
+
+        case ( Opcode::lshift ):
+            result = aluLshift( registers[inst.A], registers[inst.B] );
+            break;
+
+        case ( Opcode::addImmediate ):
+            result = aluAdd( registers[inst.A], inst.immediate );
+            break;
+
+        case ( Opcode::subImmediate ):
+            result = aluSub( registers[inst.A], inst.immediate );
+            break;
+
+        case ( Opcode::jumpToReg ):
+            programCounter = registers[inst.A];
+            return 3;
+
+        case ( Opcode::branchIfZero ):
+            if ( !flagsSet )
+                errExit( ErrorKind::undefinedValue, "FastCPU: branchIfZero before the zero flag was set" );
+            programCounter = zero ? registers[inst.A] : nextPC;
+            return 3;
+
+        case ( Opcode::branchIfPositive ):
+            if ( !flagsSet )
+                errExit( ErrorKind::undefinedValue, "FastCPU: branchIfPositive before the positive flag was set" );
+            programCounter = positive ? registers[inst.A] : nextPC;
+            return 3;
+
+        case ( Opcode::load ):
+            validateAddress( registers[inst.A] );
+            if ( inst.dest != 0 )
+                registers[inst.dest] = be32toh( readWord( registers[inst.A] ) );
+            programCounter = nextPC;
+            return 4;
+
+        case ( Opcode::store ):
+            storeWord( registers[inst.A], registers[inst.B] );
+            programCounter = nextPC;
+            return 3;
+
+        case ( Opcode::nop ):
+            programCounter = nextPC;
+            return 3;
+
+        case ( Opcode::printBuffer ):
+            video->showFrame( memory + mainMemoryBytes );
+            programCounter = nextPC;
+            return 3;
+
+        case ( Opcode::halt ):
+            halted = true;
+            return 3;
+
+        default:
+            errExit( ErrorKind::invalidOpcode, "In FastCPU, invalid opcode" );
+            return 0;
+    }
+
+    // only ALU instructions get to here
+    setFlags( result );
+
+    if ( inst.dest != 0 ) // writes to r0 are ignored
+        registers[inst.dest] = result;
+
+    programCounter = nextPC;
+    return 4;
+}
+
+unsigned int FastCPU::executeInstruction( void ) {
+    validateAddress( programCounter );
+    return execute( decodeWord( be32toh( readWord( programCounter ) ) ) );
+}
+
+void FastCPU::translate( int32_t addr, Translation &ret ) {
+    validateAddress( addr );
+    ret.first = decodeWord( be32toh( readWord( addr ) ) );
+    ret.fusion = Fusion::none;
+    ret.valid = true;
+
+    // everything we fuse starts with an addImmediate (which writes to r1)
+    // the second instruction must be in the same memory (main or video) as the first
+    uint32_t secondAddr = static_cast<uint32_t>(addr) + sizeof(int32_t);
+    if ( (ret.first.op != Opcode::addImmediate) || (secondAddr > ramBytes - sizeof(int32_t))
+            || (secondAddr == mainMemoryBytes) )
+        return;
+
+    ret.second = decodeWord( be32toh( readWord( secondAddr ) ) );
+
+    switch ( ret.second.op ) {
+        case ( Opcode::add ):
+            // copy r1 to another register
+            if ( ((ret.second.A == 1) && (ret.second.B == 0)) || ((ret.second.A == 0) && (ret.second.B == 1)) )
+                ret.fusion = Fusion::addImmediateCopy;
+            break;
+
+        case ( Opcode::load ):
+            if ( ret.second.A == 1 )
+                ret.fusion = Fusion::addImmediateLoad;
+            break;
+
+        case ( Opcode::store ):
+            if ( ret.second.A == 1 )
+                ret.fusion = Fusion::addImmediateStore;
+            break;
+
+        default:
+            break;
+    }
+}
+
+unsigned int FastCPU::executeTranslation( const Translation &t ) {
+    if ( t.fusion == Fusion::none ) {
+        fusionStats.instructions++;
+        return execute( t.first );
+    }
+
+    fusionStats.instructions += 2;
+    fusionStats.fused[ static_cast<unsigned int>(t.fusion) ]++;
+
+    // the addImmediate part is always the same
+    int32_t address = aluAdd( registers[t.first.A], t.first.immediate );
+    setFlags( address );
+    registers[1] = address;
+
+    switch ( t.fusion ) {
+        case ( Fusion::addImmediateCopy ):
+            // adding r0 does not change the flags
+            if ( t.second.dest != 0 )
+                registers[t.second.dest] = address;
+            programCounter = aluAdd( programCounter, 2*sizeof(int32_t) );
+            return 4 + 4;
+
+        case ( Fusion::addImmediateLoad ):
+            validateAddress( address );
+            if ( t.second.dest != 0 )
+                registers[t.second.dest] = be32toh( readWord( address ) );
+            programCounter = aluAdd( programCounter, 2*sizeof(int32_t) );
+            return 4 + 4;
+
+        case ( Fusion::addImmediateStore ):
+            storeWord( address, registers[t.second.B] );
+            programCounter = aluAdd( programCounter, 2*sizeof(int32_t) );
+            return 4 + 3;
+
+        default:
+            errExit( "FastCPU: invalid fusion" );
+            return 0;
+    }
+}
+
+void FastCPU::invalidateTranslations( int32_t addr ) {
+    // the translation for the word before might have fused the written word in
+    // and an unaligned write covers two words
+    uint32_t address = addr;
+    uint32_t first = (address / sizeof(int32_t)) == 0 ? 0 : (address / sizeof(int32_t)) - 1;
+    uint32_t last = ( address + sizeof(int32_t) - 1 ) / sizeof(int32_t);
+
+    for ( uint32_t i = first; (i <= last) && (i < numWords); i++ )
+        translations[i].valid = false;
+}
+
+bool FastCPU::clockTick( void ) {
+    if ( halted && (cyclesOwed == 0) )
+        return true;
+
+    if ( cyclesOwed == 0 )
+        cyclesOwed = executeInstruction();
+
+    cyclesOwed--;
+    cycleCount++;
+
+    return halted && (cyclesOwed == 0);
+}
+
+bool FastCPU::step( void ) {
+    // finish off an instruction started by clockTick
+    cycleCount += cyclesOwed;
+    cyclesOwed = 0;
+
+    if ( !halted )
+        cycleCount += executeInstruction();
+
+    return halted;
+}
+
+RunStatus FastCPU::run( uint64_t maxCycles ) {
+    if ( faulted )
+        return RunStatus::faulted;
+
+    cycleCount += cyclesOwed;
+    cyclesOwed = 0;
+
+    ScopedErrorHandler handler( throwFault, NULL );
+    int32_t pc = programCounter;
+
+    try {
+        while ( !halted && (cycleCount < maxCycles) ) {
+            pc = programCounter;
+            uint32_t index = static_cast<uint32_t>(pc) / sizeof(int32_t);
+
+            if ( ((pc % sizeof(int32_t)) == 0) && (index < numWords) ) {
+                if ( !translations[index].valid )
+                    translate( programCounter, translations[index] );
+
+                cycleCount += executeTranslation( translations[index] );
+            } else {
+                // unaligned instructions are not worth translating
+                fusionStats.instructions++;
+                cycleCount += executeInstruction();
+            }
+        }
+    } catch ( const FaultThrown &thrown ) {
+        recordFault( thrown, pc, cycleCount );
+        return RunStatus::faulted;
+    }
+
+    return halted ? RunStatus::halted : RunStatus::cycleLimit;
+}
+
+void FastCPU::recordFault( const FaultThrown &thrown, int32_t addr, uint64_t start ) {
+    faulted = true;
+    fault.kind = thrown.kind;
+    fault.message = thrown.message;
+    fault.pc = addr;
+
+    // the first half of a fused pair is an addImmediate, which can't fault, so it was the second half
+    uint32_t index = static_cast<uint32_t>(addr) / sizeof(int32_t);
+    if ( ((addr % sizeof(int32_t)) == 0) && (index < numWords) && translations[index].valid &&
+            (translations[index].fusion != Fusion::none) ) {
+        fault.pc = aluAdd( addr, sizeof(int32_t) );
+        start += cyclesFor( Opcode::addImmediate );
+    }
+
+    // CPU finds a bad program counter in fetch, an invalid opcode in decode and everything else in execute
+    uint32_t pc = fault.pc;
+    bool badFetch = (thrown.kind == ErrorKind::badAddress) && ( (pc > ramBytes - sizeof(int32_t)) ||
+            ((pc > mainMemoryBytes - sizeof(int32_t)) && (pc < mainMemoryBytes)) );
+    if ( badFetch )
+        fault.cycle = start + 1;
+    else if ( thrown.kind == ErrorKind::invalidOpcode )
+        fault.cycle = start + 2;
+    else
+        fault.cycle = start + 3;
+
+    cycleCount = fault.cycle;
+}
+
+bool FastCPU::hasFaulted( void ) {
+    return faulted;
+}
+
+const CPUFault& FastCPU::getFault( void ) {
+    return fault;
+}
+
+void FastCPU::setVideoOutput( VideoOutput &output ) {
+    video = &output;
+}
+
+FusionStats FastCPU::getFusionStats( void ) {
+    return fusionStats;
+}
+
+int32_t FastCPU::debugRamRead( int32_t addr ) {
+    validateAddress( addr );
+    return readWord( addr );
+}
+
+uint64_t FastCPU::getCycleCount( void ) {
+    return cycleCount;
+}
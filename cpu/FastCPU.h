@@ -0,0 +1,155 @@
+// functional (instruction set level) model of the cpu
+// This runs the same instructions as CPU but does not model the datapath. It is for when only the
+// architectural results matter. Cycle counts are still exact because the control unit timing only
+// depends on the opcode.
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef FAST_CPU_H
+#define FAST_CPU_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "MemoryMap.h"
+#include "Opcodes.h"
+#include "CPUFault.h"
+
+// an instruction with its fields pulled out
+struct FastInstruction {
+    Opcode op;
+    uint8_t A;
+    uint8_t B;
+    uint8_t dest; // 1 for addImmediate and subImmediate
+    int32_t immediate;
+};
+
+// pairs of instructions which run() does as one operation
+// programs made with Instruction are full of these because addImmediate always writes to r1
+enum class Fusion {
+    none,
+    addImmediateCopy,  // addImmediate rA, k then add r1, r0 -> rX (or add r0, r1 -> rX)
+    addImmediateLoad,  // addImmediate rA, k then load rX <- ram[r1]
+    addImmediateStore, // addImmediate rA, k then store ram[r1] <- rB
+    numFusions
+};
+
+// how often run() was able to use each fusion
+struct FusionStats {
+    uint64_t instructions; // instructions run by run(), fused or not
+    uint64_t fused[ static_cast<unsigned int>(Fusion::numFusions) ]; // pairs (so 2 instructions each)
+};
+
+class FastCPU {
+    // AotCPU runs translated code on our registers and memory and uses us for everything else
+    friend class AotCPU;
+
+    private:
+        // what run() does at a word aligned address. Made the first time that address is run
+        struct Translation {
+            FastInstruction first;
+            FastInstruction second; // only used if fusion is not none
+            Fusion fusion;
+            bool valid;
+        };
+
+        static const unsigned int numWords = ramBytes / sizeof(int32_t);
+        Translation translations[numWords];
+        FusionStats fusionStats;
+
+        int32_t registers[32]; // r0 is always 0
+        int8_t memory[ramBytes]; // main memory followed by video memory. Unwritten memory reads as 0
+        int32_t programCounter;
+
+        bool zero;
+        bool positive;
+        bool flagsSet; // the flags are undefined until the first ALU instruction
+
+        bool halted;
+        uint64_t cycleCount;
+
+        bool faulted; // run caught a fault. It won't run again
+        CPUFault fault;
+
+        VideoOutput* video; // where printBuffer sends frames
+
+        // for clockTick: cycles still to be counted for the instruction which has already run
+        unsigned int cyclesOwed;
+
+        // check an address the same way that RamAddrTran and RAM do
+        void validateAddress( int32_t addr );
+
+        // bytes at addr as they are stored (the same endian-ness as debugRamRead)
+        int32_t readWord( int32_t addr );
+
+        static FastInstruction decodeWord( uint32_t word );
+
+        // run an instruction which was at programCounter. Returns the number of cycles it takes
+        unsigned int execute( const FastInstruction &inst );
+
+        // execute the instruction at programCounter without using the translations
+        unsigned int executeInstruction( void );
+
+        // decode the instruction(s) at addr and look for something to fuse
+        void translate( int32_t addr, Translation &ret );
+
+        // run a translation made for programCounter. Returns the number of cycles it takes
+        unsigned int executeTranslation( const Translation &t );
+
+        // a word has been written at addr so any translations using it are out of date
+        void invalidateTranslations( int32_t addr );
+
+        // write a word in the same way as a store instruction
+        void storeWord( int32_t addr, int32_t data );
+
+        void setFlags( int32_t result );
+
+        // fill in fault for a fault thrown while running the instruction (or fused pair) at addr,
+        //      which started at cycle start. The cycle is the one CPU would have found it in
+        void recordFault( const FaultThrown &thrown, int32_t addr, uint64_t start );
+
+    public:
+        FastCPU( const std::vector<int32_t> &InitialRamData );
+
+        // same interface as CPU::clockTick. The whole instruction happens on its first cycle and the
+        //      rest of its cycles are only counted. Returns true once the halt has taken all of its cycles
+        bool clockTick( void );
+
+        // run one instruction. Returns wheather or not we are halted
+        bool step( void );
+
+        // run whole instructions until we halt, maxCycles have been counted or the program faults
+        // this is the fastest way to run FastCPU. Fused pairs count as two instructions so it can
+        //      go over maxCycles by a little
+        // faults are returned like CPU::run does, with the same kind, address and cycle. Unlike CPU,
+        //      registers and memory start as zero rather than undefined, so reading one which was never
+        //      written is not a fault. Only using the flags before they are set is
+        // clockTick and step still pass faults to errExit
+        RunStatus run( uint64_t maxCycles = UINT64_MAX );
+        bool hasFaulted( void );
+        const CPUFault& getFault( void ); // only meaningful if hasFaulted
+
+        FusionStats getFusionStats( void );
+
+        // printBuffer sends frames to output instead of the terminal. output must outlive us
+        void setVideoOutput( VideoOutput &output );
+
+        // same as CPU
+        int32_t debugRamRead( int32_t addr );
+        uint64_t getCycleCount( void );
+
+        // number of cycles CPU takes to run an instruction with this opcode
+        static unsigned int cyclesFor( Opcode op );
+};
+
+#endif
@@ -0,0 +1,245 @@
+// recording frames to a file and reading them back. See header file
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "FrameRecording.h"
+#include "../emulator/debug.h"
+#include <string.h>
+#include <endian.h>
+
+static const char magic[] = "CPUFRM01";
+static const size_t magicBytes = 8;
+
+// a run header costs 4 bytes, so gaps shorter than this are recorded instead of starting a new run
+static const unsigned int maxGap = 4;
+
+static void putBigEndian( std::vector<uint8_t> &out, uint64_t value, unsigned int bytes ) {
+    for ( unsigned int i = bytes; i > 0; i-- )
+        out.push_back( static_cast<uint8_t>( value >> (8 * (i - 1)) ) );
+}
+
+FrameRecorder::FrameRecorder( const std::string &path )
+    : path( path ), frames( 0 ), bytes( 0 ), stopping( false ), failed( false ) {
+    file = fopen( path.c_str(), "wb" );
+    if ( file == NULL )
+        errExit( "Could not open " + path + " to record frames" );
+
+    uint16_t size[2] = { htobe16( videoWidth ), htobe16( videoHeight ) };
+    if ( (fwrite( magic, 1, magicBytes, file ) != magicBytes) || (fwrite( size, sizeof(size), 1, file ) != 1) )
+        failed = true;
+    bytes = magicBytes + sizeof(size);
+
+    memset( previous, 0, sizeof(previous) );
+    start = std::chrono::steady_clock::now();
+
+    current.reset( new std::vector<uint8_t>() );
+    current->reserve( bufferBytes + videoBytes * 2 );
+
+    writer = std::thread( &FrameRecorder::write, this );
+}
+
+FrameRecorder::~FrameRecorder( void ) {
+    if ( file && !finish() )
+        debug( "Could not write the frame recording " + path );
+}
+
+void FrameRecorder::showFrame( const int8_t* frame ) {
+    std::vector<uint8_t> &out = *current;
+    size_t startBytes = out.size();
+
+    uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start ).count();
+    putBigEndian( out, nanoseconds, 8 );
+
+    // filled in once we know how many runs there are
+    size_t runsAt = out.size();
+    putBigEndian( out, 0, 2 );
+    unsigned int runs = 0;
+
+    unsigned int i = 0;
+    while ( i < videoBytes ) {
+        // whole words the same as last time are skipped quickly
+        if ( (i % sizeof(uint64_t) == 0) && (memcmp( frame + i, previous + i, sizeof(uint64_t) ) == 0) ) {
+            i += sizeof(uint64_t);
+            continue;
+        }
+
+        if ( frame[i] == previous[i] ) {
+            i++;
+            continue;
+        }
+
+        // a run starts at i. It carries on over gaps of up to maxGap unchanged bytes
+        unsigned int end = i + 1;
+        unsigned int gap = 0;
+        while ( (end + gap < videoBytes) && (gap <= maxGap) ) {
+            if ( frame[ end + gap ] != previous[ end + gap ] ) {
+                end += gap + 1;
+                gap = 0;
+            } else {
+                gap++;
+            }
+        }
+
+        putBigEndian( out, i, 2 );
+        putBigEndian( out, end - i, 2 );
+        out.insert( out.end(), reinterpret_cast<const uint8_t*>( frame + i ), reinterpret_cast<const uint8_t*>( frame + end ) );
+        runs++;
+
+        i = end;
+    }
+
+    out[ runsAt ] = static_cast<uint8_t>( runs >> 8 );
+    out[ runsAt + 1 ] = static_cast<uint8_t>( runs );
+
+    memcpy( previous, frame, videoBytes );
+    frames++;
+    bytes += out.size() - startBytes;
+
+    if ( out.size() >= bufferBytes )
+        hand();
+}
+
+void FrameRecorder::hand( void ) {
+    std::unique_ptr< std::vector<uint8_t> > next;
+
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        full.push_back( std::move( current ) );
+
+        if ( !spare.empty() ) {
+            next = std::move( spare.back() );
+            spare.pop_back();
+        }
+    }
+    wake.notify_one();
+
+    if ( !next ) {
+        next.reset( new std::vector<uint8_t>() );
+        next->reserve( bufferBytes + videoBytes * 2 );
+    }
+
+    next->clear();
+    current = std::move( next );
+}
+
+void FrameRecorder::write( void ) {
+    std::unique_lock<std::mutex> guard( lock );
+
+    while ( true ) {
+        while ( full.empty() && !stopping )
+            wake.wait( guard );
+
+        if ( full.empty() )
+            return;
+
+        std::unique_ptr< std::vector<uint8_t> > buffer = std::move( full.front() );
+        full.pop_front();
+
+        // the file is only used by this thread so it is written without the lock
+        guard.unlock();
+        bool ok = fwrite( buffer->data(), 1, buffer->size(), file ) == buffer->size();
+        guard.lock();
+
+        if ( !ok )
+            failed = true;
+        spare.push_back( std::move( buffer ) );
+    }
+}
+
+bool FrameRecorder::finish( void ) {
+    if ( !current->empty() )
+        hand();
+
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+
+    bool ok = !failed;
+    if ( fclose( file ) != 0 )
+        ok = false;
+    file = NULL;
+
+    return ok;
+}
+
+void FrameRecorder::close( void ) {
+    if ( !file )
+        return;
+
+    if ( !finish() )
+        errExit( "Could not write the frame recording " + path );
+}
+
+uint64_t FrameRecorder::getFrames( void ) {
+    return frames;
+}
+
+uint64_t FrameRecorder::getBytes( void ) {
+    return bytes;
+}
+
+FrameReader::FrameReader( const std::string &path ) : path( path ) {
+    file = fopen( path.c_str(), "rb" );
+    if ( file == NULL )
+        errExit( "Could not open the frame recording " + path );
+
+    char fileMagic[ magicBytes ];
+    uint16_t size[2];
+    if ( (fread( fileMagic, 1, magicBytes, file ) != magicBytes) || (memcmp( fileMagic, magic, magicBytes ) != 0)
+            || (fread( size, sizeof(size), 1, file ) != 1) )
+        errExit( path + " is not a frame recording" );
+
+    if ( (be16toh( size[0] ) != videoWidth) || (be16toh( size[1] ) != videoHeight) )
+        errExit( path + " has frames of a different size" );
+
+    memset( frame, 0, sizeof(frame) );
+}
+
+FrameReader::~FrameReader( void ) {
+    fclose( file );
+}
+
+bool FrameReader::next( const int8_t* &nextFrame, uint64_t &nanoseconds ) {
+    uint8_t header[10];
+    size_t got = fread( header, 1, sizeof(header), file );
+    if ( got == 0 )
+        return false;
+    if ( got != sizeof(header) )
+        errExit( path + " ends part way through a frame" );
+
+    nanoseconds = 0;
+    for ( unsigned int i = 0; i < 8; i++ )
+        nanoseconds = (nanoseconds << 8) | header[i];
+    unsigned int runs = (header[8] << 8) | header[9];
+
+    for ( unsigned int i = 0; i < runs; i++ ) {
+        uint8_t run[4];
+        if ( fread( run, 1, sizeof(run), file ) != sizeof(run) )
+            errExit( path + " ends part way through a frame" );
+
+        unsigned int offset = (run[0] << 8) | run[1];
+        unsigned int length = (run[2] << 8) | run[3];
+        if ( offset + length > videoBytes )
+            errExit( path + " has a run past the end of the frame" );
+
+        if ( fread( frame + offset, 1, length, file ) != length )
+            errExit( path + " ends part way through a frame" );
+    }
+
+    nextFrame = frame;
+    return true;
+}
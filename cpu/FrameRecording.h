@@ -0,0 +1,122 @@
+// recording every frame a program prints to a file, and reading them back
+// The CPU only works out what has changed since the last frame; a thread of its own writes the file
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef FRAME_RECORDING_H
+#define FRAME_RECORDING_H
+
+#include "Video.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* File format:
+    8 bytes     "CPUFRM01"
+    2 bytes     frame width (big endian)
+    2 bytes     frame height (big endian)
+    then for each frame:
+        8 bytes     nanoseconds from the start of the recording to this frame (big endian)
+        2 bytes     number of runs (big endian)
+        each run:
+            2 bytes     offset of the first byte in the frame (big endian)
+            2 bytes     number of bytes (big endian)
+            the bytes
+
+    Each frame only has the bytes which are different to the frame before it. The frame before the
+    first one is all zeros
+*/
+
+// a VideoOutput which records every frame to a file
+// frames are never dropped: if the file cannot be written as fast as frames come the buffers waiting
+//      to be written grow instead
+class FrameRecorder : public VideoOutput {
+    public:
+        // frames are handed to the writer thread in buffers of about this many bytes
+        static const unsigned int bufferBytes = 64 * 1024;
+
+    private:
+        FILE* file;
+        std::string path;
+
+        int8_t previous[ videoBytes ];
+        std::chrono::steady_clock::time_point start;
+        uint64_t frames;
+        uint64_t bytes; // the size of the file once everything has been written
+
+        // being filled by showFrame
+        std::unique_ptr< std::vector<uint8_t> > current;
+
+        // shared with the writer thread
+        std::mutex lock;
+        std::condition_variable wake;
+        std::deque< std::unique_ptr< std::vector<uint8_t> > > full;  // waiting to be written
+        std::vector< std::unique_ptr< std::vector<uint8_t> > > spare; // written, to be filled again
+        bool stopping;
+        bool failed;
+
+        std::thread writer;
+
+        FrameRecorder( const FrameRecorder& );
+        FrameRecorder& operator=( const FrameRecorder& );
+
+        void hand( void ); // give current to the writer thread and get another
+        void write( void );
+
+        // stop the writer thread and close the file. false if anything could not be written
+        bool finish( void );
+
+    public:
+        // errExit's if path cannot be opened
+        explicit FrameRecorder( const std::string &path );
+
+        // closes the file if close has not been called. Errors only get a debug message
+        ~FrameRecorder( void );
+
+        void showFrame( const int8_t* frame );
+
+        // waits for everything to be written and closes the file. errExit's if anything could not be
+        //      written. No more frames can be shown after this
+        void close( void );
+
+        uint64_t getFrames( void );
+        uint64_t getBytes( void );
+};
+
+// reads a file written by FrameRecorder one frame at a time
+class FrameReader {
+    private:
+        FILE* file;
+        std::string path;
+        int8_t frame[ videoBytes ];
+
+        FrameReader( const FrameReader& );
+        FrameReader& operator=( const FrameReader& );
+
+    public:
+        // errExit's if path cannot be opened or is not a frame recording
+        explicit FrameReader( const std::string &path );
+        ~FrameReader( void );
+
+        // false at the end of the recording. The frame is only valid until the next call
+        bool next( const int8_t* &frame, uint64_t &nanoseconds );
+};
+
+#endif
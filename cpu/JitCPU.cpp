@@ -0,0 +1,651 @@
+// just in time compiler for the cpu. See header file
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "JitCPU.h"
+#include "FastCPU.h"
+#include "../emulator/debug.h"
+#include <stddef.h>
+#include <string.h>
+#include <endian.h>
+#include <sys/mman.h>
+
+/* Host registers while translated code is running:
+ *      rbx     JitState*
+ *      r12     guest memory
+ *      r13     cycle count
+ *      r14d    zero flag (0, 1 or 2 for undefined)
+ *      r15d    positive flag (0, 1 or 2 for undefined)
+ *      eax, ecx, edx are scratch
+ * All of these are callee saved so printBuffer can be a normal function call.
+ *
+ * Block exits to another guest address are patched to jump straight to that block once
+ * JitCPU::run has found (or made) it:
+ *      direct (the target is known when translating):
+ *          site:   jmp slow                 -> patched to jmp block
+ *          slow:   set programCounter, exitSite and return to run()
+ *      indirect (the target is in eax):
+ *                  cmp eax, 0xFFFFFFFF      -> patched to the first target seen
+ *                  jne slow
+ *          site:   jmp slow                 -> patched to jmp block
+ *          slow:   set programCounter, exitSite and return to run()
+ */
+
+// size of the executable buffer. When it is full everything is thrown away
+static const size_t codeBytes = 4 * 1024 * 1024;
+// more than the most code one block can need
+static const size_t maxBlockBytes = 16 * 1024;
+// no valid address can be this so it is used for unpatched inline caches
+static const uint32_t noTarget = 0xFFFFFFFF;
+
+// offsets into JitState for the generated code
+static uint32_t registerOffset( unsigned int reg ) {
+    return offsetof( JitState, registers ) + reg * sizeof(int32_t);
+}
+
+static const uint32_t pcOffset = offsetof( JitState, programCounter );
+static const uint32_t exitReasonOffset = offsetof( JitState, exitReason );
+static const uint32_t cycleCountOffset = offsetof( JitState, cycleCount );
+static const uint32_t cycleLimitOffset = offsetof( JitState, cycleLimit );
+static const uint32_t memoryOffset = offsetof( JitState, memory );
+static const uint32_t zeroOffset = offsetof( JitState, zero );
+static const uint32_t positiveOffset = offsetof( JitState, positive );
+static const uint32_t exitSiteOffset = offsetof( JitState, exitSite );
+static const uint32_t exitSiteIsIndirectOffset = offsetof( JitState, exitSiteIsIndirect );
+static const uint32_t translatedWordsOffset = offsetof( JitState, translatedWords );
+
+// called from translated code for printBuffer
+static void printBufferHelper( JitState* state ) {
+    state->video->showFrame( state->memory + mainMemoryBytes );
+}
+
+namespace {
+
+// writes x86-64 machine code one byte at a time
+class Emitter {
+    public:
+        uint8_t* p;
+
+        explicit Emitter( uint8_t* start ) : p( start ) {}
+
+        void b( uint8_t byte ) {
+            *p++ = byte;
+        }
+
+        void b( uint8_t b1, uint8_t b2 ) {
+            b( b1 );
+            b( b2 );
+        }
+
+        void b( uint8_t b1, uint8_t b2, uint8_t b3 ) {
+            b( b1, b2 );
+            b( b3 );
+        }
+
+        void b( uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4 ) {
+            b( b1, b2 );
+            b( b3, b4 );
+        }
+
+        void d( uint32_t dword ) {
+            memcpy( p, &dword, sizeof(dword) );
+            p += sizeof(dword);
+        }
+
+        void q( uint64_t qword ) {
+            memcpy( p, &qword, sizeof(qword) );
+            p += sizeof(qword);
+        }
+
+        // conditional jump (0F cc rel32). Returns the rel32 so it can be pointed somewhere later
+        uint8_t* jcc( uint8_t cc ) {
+            b( 0x0F, cc );
+            uint8_t* rel = p;
+            d( 0 );
+            return rel;
+        }
+
+        // jmp rel32. Returns the rel32
+        uint8_t* jmp( void ) {
+            b( 0xE9 );
+            uint8_t* rel = p;
+            d( 0 );
+            return rel;
+        }
+
+        static void setTarget( uint8_t* rel, const uint8_t* target ) {
+            int32_t displacement = static_cast<int32_t>( target - (rel + sizeof(int32_t)) );
+            memcpy( rel, &displacement, sizeof(displacement) );
+        }
+
+        // mov eax, [rbx + reg]
+        void loadEax( unsigned int reg ) {
+            b( 0x8B, 0x83 );
+            d( registerOffset( reg ) );
+        }
+
+        // mov ecx, [rbx + reg]
+        void loadEcx( unsigned int reg ) {
+            b( 0x8B, 0x8B );
+            d( registerOffset( reg ) );
+        }
+
+        // mov [rbx + reg], eax. Writes to r0 are ignored
+        void storeEax( unsigned int reg ) {
+            if ( reg == 0 )
+                return;
+
+            b( 0x89, 0x83 );
+            d( registerOffset( reg ) );
+        }
+
+        // zero and positive flags from the result in eax
+        void setFlags( void ) {
+            b( 0x85, 0xC0 );                // test eax, eax
+            b( 0x41, 0x0F, 0x94, 0xC6 );    // setz r14b
+            b( 0x45, 0x0F, 0xB6, 0xF6 );    // movzx r14d, r14b
+            b( 0x41, 0x0F, 0x99, 0xC7 );    // setns r15b
+            b( 0x45, 0x0F, 0xB6, 0xFF );    // movzx r15d, r15b
+        }
+
+        // add r13, cycles
+        void addCycles( uint32_t cycles ) {
+            if ( cycles == 0 )
+                return;
+
+            b( 0x49, 0x81, 0xC5 );
+            d( cycles );
+        }
+
+        // mov dword [rbx + offset], value
+        void storeImmediate( uint32_t offset, uint32_t value ) {
+            b( 0xC7, 0x83 );
+            d( offset );
+            d( value );
+        }
+};
+
+// an exit from the middle of a block which is written out after the rest of the block
+struct PendingExit {
+    uint8_t* rel; // jcc to point at the exit
+    int32_t pc;
+    JitExit reason;
+    uint32_t cycles;
+};
+
+} // end of anonymous namespace
+
+JitCPU::JitCPU( const std::vector<int32_t> &InitialRamData ) {
+    if ( !isSupported() )
+        errExit( "JitCPU: translated code can only run on x86-64 Linux" );
+
+    if ( InitialRamData.size() > mainMemoryBytes/sizeof(int32_t) )
+        errExit( "Initial RAM data does not fit" );
+
+    memset( memory, 0, mainMemoryBytes );
+    memset( memory + mainMemoryBytes, 0x23, videoBytes ); // '#' = 0x23, like RamAddrTran
+
+    if ( InitialRamData.size() > 0 )
+        memcpy( memory, &InitialRamData[0], InitialRamData.size() * sizeof(int32_t) );
+
+    memset( &state, 0, sizeof(state) );
+    state.memory = memory;
+    state.video = &terminalVideo();
+    state.zero = 2;
+    state.positive = 2;
+    halted = false;
+
+    memset( &stats, 0, sizeof(stats) );
+    generation = 0;
+
+    void* mapped = mmap( NULL, codeBytes, PROT_READ | PROT_WRITE | PROT_EXEC,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if ( mapped == MAP_FAILED )
+        errExit( "JitCPU: could not allocate executable memory" );
+    code = static_cast<uint8_t*>( mapped );
+
+    emitTrampolines();
+    flush();
+    stats.flushes = 0;
+}
+
+JitCPU::~JitCPU( void ) {
+    munmap( code, codeBytes );
+}
+
+bool JitCPU::isSupported( void ) {
+    #if defined(__x86_64__) && defined(__linux__)
+        return true;
+    #else
+        return false;
+    #endif
+}
+
+void JitCPU::emitTrampolines( void ) {
+    Emitter e( code );
+
+    // void entry( JitState* state (rdi), uint8_t* block (rsi) )
+    entry = e.p;
+    e.b( 0x53 );                // push rbx
+    e.b( 0x55 );                // push rbp
+    e.b( 0x41, 0x54 );          // push r12
+    e.b( 0x41, 0x55 );          // push r13
+    e.b( 0x41, 0x56 );          // push r14
+    e.b( 0x41, 0x57 );          // push r15
+    e.b( 0x48, 0x83, 0xEC, 0x08 ); // sub rsp, 8 (so the stack is 16 byte aligned for calls)
+    e.b( 0x48, 0x89, 0xFB );    // mov rbx, rdi
+    e.b( 0x4C, 0x8B, 0xA3 );    // mov r12, [rbx + memory]
+    e.d( memoryOffset );
+    e.b( 0x4C, 0x8B, 0xAB );    // mov r13, [rbx + cycleCount]
+    e.d( cycleCountOffset );
+    e.b( 0x44, 0x8B, 0xB3 );    // mov r14d, [rbx + zero]
+    e.d( zeroOffset );
+    e.b( 0x44, 0x8B, 0xBB );    // mov r15d, [rbx + positive]
+    e.d( positiveOffset );
+    e.b( 0xFF, 0xE6 );          // jmp rsi
+
+    // blocks jump here after setting programCounter and exitReason
+    exitStub = e.p;
+    e.b( 0x4C, 0x89, 0xAB );    // mov [rbx + cycleCount], r13
+    e.d( cycleCountOffset );
+    e.b( 0x44, 0x89, 0xB3 );    // mov [rbx + zero], r14d
+    e.d( zeroOffset );
+    e.b( 0x44, 0x89, 0xBB );    // mov [rbx + positive], r15d
+    e.d( positiveOffset );
+    e.b( 0x48, 0x83, 0xC4, 0x08 ); // add rsp, 8
+    e.b( 0x41, 0x5F );          // pop r15
+    e.b( 0x41, 0x5E );          // pop r14
+    e.b( 0x41, 0x5D );          // pop r13
+    e.b( 0x41, 0x5C );          // pop r12
+    e.b( 0x5D );                // pop rbp
+    e.b( 0x5B );                // pop rbx
+    e.b( 0xC3 );                // ret
+
+    blocksStart = e.p;
+}
+
+void JitCPU::flush( void ) {
+    codeEnd = blocksStart;
+
+    memset( blocks, 0, sizeof(blocks) );
+    memset( state.translatedWords, 0, sizeof(state.translatedWords) );
+    generation++;
+    stats.flushes++;
+}
+
+// same rules as RamAddrTran and RAM: the word must fit inside either main memory or video memory
+static bool validAddress( int32_t addr ) {
+    uint32_t address = addr;
+
+    if ( address > ramBytes - sizeof(int32_t) )
+        return false;
+
+    return !( (address > mainMemoryBytes - sizeof(int32_t)) && (address < mainMemoryBytes) );
+}
+
+uint8_t* JitCPU::lookup( int32_t addr ) {
+    if ( !validAddress( addr ) )
+        errExit( ErrorKind::badAddress, "JitCPU: program counter is not a valid address" );
+
+    if ( blocks[addr] == NULL )
+        blocks[addr] = translate( addr );
+
+    return blocks[addr];
+}
+
+uint8_t* JitCPU::translate( int32_t addr ) {
+    if ( codeEnd + maxBlockBytes > code + codeBytes )
+        flush();
+
+    stats.blocksTranslated++;
+
+    uint8_t* block = codeEnd;
+    Emitter e( block );
+    std::vector<PendingExit> pending;
+
+    // direct chain exit to a known guest address
+    struct {
+        void operator()( Emitter &e, uint8_t* exitStub, int32_t target, uint32_t cycles ) {
+            e.addCycles( cycles );
+            uint8_t* site = e.p;
+            uint8_t* rel = e.jmp();
+            Emitter::setTarget( rel, e.p );
+
+            e.storeImmediate( pcOffset, target );
+            e.storeImmediate( exitReasonOffset, static_cast<uint32_t>(JitExit::chain) );
+            e.b( 0x48, 0xB8 );                  // mov rax, site
+            e.q( reinterpret_cast<uint64_t>(site) );
+            e.b( 0x48, 0x89, 0x83 );            // mov [rbx + exitSite], rax
+            e.d( exitSiteOffset );
+            e.storeImmediate( exitSiteIsIndirectOffset, 0 );
+            Emitter::setTarget( e.jmp(), exitStub );
+        }
+    } directExit;
+
+    // chain exit to the guest address in eax
+    struct {
+        void operator()( Emitter &e, uint8_t* exitStub, uint32_t cycles ) {
+            e.addCycles( cycles );
+            e.b( 0x3D );                        // cmp eax, target
+            e.d( noTarget );
+            uint8_t* miss = e.jcc( 0x85 );      // jne slow
+            uint8_t* site = e.p;
+            uint8_t* rel = e.jmp();             // jmp block
+            Emitter::setTarget( rel, e.p );
+            Emitter::setTarget( miss, e.p );
+
+            e.b( 0x89, 0x83 );                  // mov [rbx + programCounter], eax
+            e.d( pcOffset );
+            e.storeImmediate( exitReasonOffset, static_cast<uint32_t>(JitExit::chain) );
+            e.b( 0x48, 0xB8 );                  // mov rax, site
+            e.q( reinterpret_cast<uint64_t>(site) );
+            e.b( 0x48, 0x89, 0x83 );            // mov [rbx + exitSite], rax
+            e.d( exitSiteOffset );
+            e.storeImmediate( exitSiteIsIndirectOffset, 1 );
+            Emitter::setTarget( e.jmp(), exitStub );
+        }
+    } indirectExit;
+
+    // stop if we have used up our cycles
+    e.b( 0x4C, 0x3B, 0xAB );                    // cmp r13, [rbx + cycleLimit]
+    e.d( cycleLimitOffset );
+    PendingExit limit = { e.jcc( 0x83 ), addr, JitExit::cycleLimit, 0 }; // jae
+    pending.push_back( limit );
+
+    int32_t pc = addr;
+    uint32_t cycles = 0;
+    bool ended = false;
+
+    for ( unsigned int n = 0; !ended; n++ ) {
+        if ( (n == maxBlockInstructions) || !validAddress( pc ) ) {
+            // run() will complain about the address if it is not valid
+            directExit( e, exitStub, pc, cycles );
+            break;
+        }
+
+        uint32_t word;
+        memcpy( &word, memory + pc, sizeof(word) );
+        word = be32toh( word );
+
+        Opcode op = static_cast<Opcode>( word & 0x1F );
+        unsigned int A = (word >> 5) & 0x1F;
+        unsigned int B = (word >> 10) & 0x1F;
+        unsigned int dest = (word >> 15) & 0x1F;
+        int32_t immediate = static_cast<int32_t>(word) >> 10; // sign extended
+
+        // a store to any of these bytes must throw the translation away
+        state.translatedWords[ pc / sizeof(int32_t) ] = 1;
+        state.translatedWords[ (pc + sizeof(int32_t) - 1) / sizeof(int32_t) ] = 1;
+
+        cycles += FastCPU::cyclesFor( op );
+        int32_t nextPC = pc + sizeof(int32_t);
+
+        switch ( op ) {
+            case ( Opcode::add ):
+                e.loadEax( A );
+                e.b( 0x03, 0x83 );              // add eax, [rbx + B]
+                e.d( registerOffset( B ) );
+                e.setFlags();
+                e.storeEax( dest );
+                break;
+
+            case ( Opcode::sub ):
+                e.loadEax( A );
+                e.b( 0x2B, 0x83 );              // sub eax, [rbx + B]
+                e.d( registerOffset( B ) );
+                e.setFlags();
+                e.storeEax( dest );
+                break;
+
+            case ( Opcode::nand ):
+                e.loadEax( A );
+                e.b( 0x23, 0x83 );              // and eax, [rbx + B]
+                e.d( registerOffset( B ) );
+                e.b( 0xF7, 0xD0 );              // not eax
+                e.setFlags();
+                e.storeEax( dest );
+                break;
+
+            case ( Opcode::lshift ):
+                e.loadEax( A );
+                e.loadEcx( B );
+                e.b( 0xD3, 0xE0 );              // shl eax, cl (cl is masked to 5 bits like the ALU)
+                e.setFlags();
+                e.storeEax( dest );
+                break;
+
+            case ( Opcode::addImmediate ):
+                e.loadEax( A );
+                e.b( 0x05 );                    // add eax, immediate
+                e.d( immediate );
+                e.setFlags();
+                e.storeEax( 1 );
+                break;
+
+            case ( Opcode::subImmediate ):
+                e.loadEax( A );
+                e.b( 0x2D );                    // sub eax, immediate
+                e.d( immediate );
+                e.setFlags();
+                e.storeEax( 1 );
+                break;
+
+            case ( Opcode::load ):
+            case ( Opcode::store ): {
+                e.loadEcx( A );
+
+                // check the address in ecx
+                e.b( 0x81, 0xF9 );              // cmp ecx, ramBytes - 4
+                e.d( ramBytes - sizeof(int32_t) );
+                PendingExit tooBig = { e.jcc( 0x87 ), pc, JitExit::badAddress, cycles }; // ja
+                pending.push_back( tooBig );
+                e.b( 0x8D, 0x91 );              // lea edx, [rcx - (mainMemoryBytes - 3)]
+                e.d( -static_cast<int32_t>( mainMemoryBytes - sizeof(int32_t) + 1 ) );
+                e.b( 0x83, 0xFA, 0x02 );        // cmp edx, 2
+                PendingExit straddles = { e.jcc( 0x86 ), pc, JitExit::badAddress, cycles }; // jbe
+                pending.push_back( straddles );
+
+                if ( op == Opcode::load ) {
+                    e.b( 0x41, 0x8B, 0x04, 0x0C ); // mov eax, [r12 + rcx]
+                    e.b( 0x0F, 0xC8 );          // bswap eax
+                    e.storeEax( dest );
+                    break;
+                }
+
+                e.loadEax( B );
+                e.b( 0x41, 0x89, 0x04, 0x0C );  // mov [r12 + rcx], eax
+
+                // did we write over anything which has been translated? (either word the store touched)
+                e.b( 0x89, 0xCA );              // mov edx, ecx
+                e.b( 0xC1, 0xEA, 0x02 );        // shr edx, 2
+                e.b( 0x80, 0xBC, 0x13 );        // cmp byte [rbx + rdx + translatedWords], 0
+                e.d( translatedWordsOffset );
+                e.b( 0x00 );
+                PendingExit written1 = { e.jcc( 0x85 ), nextPC, JitExit::codeWritten, cycles }; // jne
+                pending.push_back( written1 );
+                e.b( 0x8D, 0x51, 0x03 );        // lea edx, [rcx + 3]
+                e.b( 0xC1, 0xEA, 0x02 );        // shr edx, 2
+                e.b( 0x80, 0xBC, 0x13 );        // cmp byte [rbx + rdx + translatedWords], 0
+                e.d( translatedWordsOffset );
+                e.b( 0x00 );
+                PendingExit written2 = { e.jcc( 0x85 ), nextPC, JitExit::codeWritten, cycles }; // jne
+                pending.push_back( written2 );
+                break;
+            }
+
+            case ( Opcode::nop ):
+                break;
+
+            case ( Opcode::jumpToReg ):
+                e.loadEax( A );
+                indirectExit( e, exitStub, cycles );
+                ended = true;
+                break;
+
+            case ( Opcode::branchIfZero ):
+            case ( Opcode::branchIfPositive ): {
+                if ( op == Opcode::branchIfZero )
+                    e.b( 0x41, 0x83, 0xFE, 0x01 ); // cmp r14d, 1
+                else
+                    e.b( 0x41, 0x83, 0xFF, 0x01 ); // cmp r15d, 1
+
+                PendingExit undefinedFlag = { e.jcc( 0x87 ), pc, JitExit::flagsUndefined, cycles }; // ja
+                pending.push_back( undefinedFlag );
+                uint8_t* notTaken = e.jcc( 0x85 ); // jne
+
+                e.loadEax( A );
+                indirectExit( e, exitStub, cycles );
+
+                Emitter::setTarget( notTaken, e.p );
+                directExit( e, exitStub, nextPC, cycles );
+                ended = true;
+                break;
+            }
+
+            case ( Opcode::printBuffer ):
+                e.b( 0x48, 0x89, 0xDF );        // mov rdi, rbx
+                e.b( 0x48, 0xB8 );              // mov rax, printBufferHelper
+                e.q( reinterpret_cast<uint64_t>( &printBufferHelper ) );
+                e.b( 0xFF, 0xD0 );              // call rax
+                directExit( e, exitStub, nextPC, cycles );
+                ended = true;
+                break;
+
+            case ( Opcode::halt ):
+                e.addCycles( cycles );
+                e.storeImmediate( pcOffset, pc );
+                e.storeImmediate( exitReasonOffset, static_cast<uint32_t>(JitExit::halted) );
+                Emitter::setTarget( e.jmp(), exitStub );
+                ended = true;
+                break;
+
+            default:
+                e.storeImmediate( pcOffset, pc );
+                e.storeImmediate( exitReasonOffset, static_cast<uint32_t>(JitExit::invalidOpcode) );
+                Emitter::setTarget( e.jmp(), exitStub );
+                ended = true;
+                break;
+        }
+
+        pc = nextPC;
+    }
+
+    // exits from the middle of the block
+    for ( unsigned int i = 0; i < pending.size(); i++ ) {
+        Emitter::setTarget( pending[i].rel, e.p );
+        e.addCycles( pending[i].cycles );
+        e.storeImmediate( pcOffset, pending[i].pc );
+        e.storeImmediate( exitReasonOffset, static_cast<uint32_t>(pending[i].reason) );
+        Emitter::setTarget( e.jmp(), exitStub );
+    }
+
+    codeEnd = e.p;
+    if ( codeEnd > block + maxBlockBytes )
+        errExit( "JitCPU: block was bigger than maxBlockBytes" );
+
+    return block;
+}
+
+void JitCPU::patch( uint8_t* site, bool indirect, int32_t target, uint8_t* block ) {
+    if ( indirect ) {
+        // cmp eax, imm32 (5 bytes) then jne rel32 (6 bytes) before the site
+        uint8_t* cachedTarget = site - 10;
+        uint32_t current;
+        memcpy( &current, cachedTarget, sizeof(current) );
+
+        // only the first target gets cached
+        if ( current != noTarget )
+            return;
+
+        uint32_t newTarget = target;
+        memcpy( cachedTarget, &newTarget, sizeof(newTarget) );
+    }
+
+    Emitter::setTarget( site + 1, block );
+    stats.chainsPatched++;
+}
+
+bool JitCPU::run( uint64_t maxCycles ) {
+    if ( halted )
+        return true;
+
+    state.cycleLimit = maxCycles;
+
+    // the trampoline is data as far as C++ is concerned
+    void (*enter)( JitState*, uint8_t* );
+    memcpy( &enter, &entry, sizeof(enter) );
+
+    uint8_t* block = lookup( state.programCounter );
+
+    while ( true ) {
+        enter( &state, block );
+        stats.exits++;
+
+        switch ( state.exitReason ) {
+            case ( JitExit::chain ): {
+                uint64_t oldGeneration = generation;
+                block = lookup( state.programCounter );
+
+                // the site is gone if lookup had to flush to make space
+                if ( oldGeneration == generation )
+                    patch( state.exitSite, state.exitSiteIsIndirect, state.programCounter, block );
+                break;
+            }
+
+            case ( JitExit::halted ):
+                halted = true;
+                return true;
+
+            case ( JitExit::cycleLimit ):
+                return false;
+
+            case ( JitExit::codeWritten ):
+                flush();
+                block = lookup( state.programCounter );
+                break;
+
+            case ( JitExit::badAddress ):
+                errExit( ErrorKind::badAddress, "JitCPU: load or store to an address which does not exist" );
+                break;
+
+            case ( JitExit::flagsUndefined ):
+                errExit( ErrorKind::undefinedValue, "JitCPU: branch before the flags were set" );
+                break;
+
+            case ( JitExit::invalidOpcode ):
+                errExit( ErrorKind::invalidOpcode, "In JitCPU, invalid opcode" );
+                break;
+        }
+    }
+}
+
+int32_t JitCPU::debugRamRead( int32_t addr ) {
+    if ( !validAddress( addr ) )
+        errExit( ErrorKind::badAddress, "Invalid memory address given to JitCPU" );
+
+    int32_t word;
+    memcpy( &word, memory + addr, sizeof(word) );
+    return word;
+}
+
+uint64_t JitCPU::getCycleCount( void ) {
+    return state.cycleCount;
+}
+
+JitStats JitCPU::getStats( void ) {
+    return stats;
+}
+
+void JitCPU::setVideoOutput( VideoOutput &output ) {
+    state.video = &output;
+}
@@ -0,0 +1,128 @@
+// just in time compiler for the cpu. Translates basic blocks of guest instructions into x86-64 machine code
+// Like FastCPU this only gives architectural results, with the same cycle counts as CPU.
+// 
+// Blocks end at jumpToReg, branchIfZero, branchIfPositive, halt and printBuffer (or after
+// maxBlockInstructions). Block exits jump straight to the next block once it is known.
+// Guest registers stay in JitState, which is pointed to by a host register. There are 32 of them and
+// not enough host registers to go around. The zero and positive flags and the cycle count stay in host
+// registers while translated code runs.
+// A store to a word that has been translated throws away all translations.
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef JIT_CPU_H
+#define JIT_CPU_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "MemoryMap.h"
+#include "Opcodes.h"
+
+// why translated code returned to JitCPU::run
+enum class JitExit : uint32_t {
+    chain,          // go to programCounter. exitSite can be patched to jump there directly
+    halted,
+    cycleLimit,     // cycleCount reached cycleLimit at the start of a block
+    codeWritten,    // a store wrote over translated code. programCounter is the next instruction
+    badAddress,     // load or store to an address which does not exist
+    flagsUndefined, // branch before the flags were set by an ALU instruction
+    invalidOpcode
+};
+
+// everything translated code reads and writes apart from guest memory
+// the layout matters: the generated code uses offsetof on this
+struct JitState {
+    int32_t registers[32]; // r0 is always 0
+    int32_t programCounter;
+    JitExit exitReason;
+    uint64_t cycleCount;
+    uint64_t cycleLimit;
+    int8_t* memory;
+
+    // the flags are 0 or 1, or 2 before the first ALU instruction
+    uint32_t zero;
+    uint32_t positive;
+
+    // the jump to patch for a chain exit. Either a direct jmp or an inline cache (see JitCPU.cpp)
+    uint8_t* exitSite;
+    uint32_t exitSiteIsIndirect;
+
+    VideoOutput* video; // where printBuffer sends frames
+
+    // 1 for each word of guest memory which is part of a translation
+    uint8_t translatedWords[ ramBytes / sizeof(int32_t) ];
+};
+
+struct JitStats {
+    uint64_t blocksTranslated;
+    uint64_t flushes;       // all translations thrown away (self modifying code or out of space)
+    uint64_t chainsPatched; // block exits rewritten to jump straight to another block
+    uint64_t exits;         // times translated code returned to JitCPU::run
+};
+
+class JitCPU {
+    private:
+        JitState state;
+        int8_t memory[ramBytes]; // main memory followed by video memory. Unwritten memory reads as 0
+        bool halted;
+
+        // executable memory
+        uint8_t* code;
+        uint8_t* codeEnd; // where the next block goes
+        uint8_t* entry;   // the trampoline from C++ into translated code
+        uint8_t* exitStub; // the way back out again
+        uint8_t* blocksStart; // translated blocks start after the trampolines
+
+        // translated block for each guest address (any alignment). null if not translated
+        uint8_t* blocks[ramBytes];
+        // incremented by flush. Saved exit sites are stale after a flush
+        uint64_t generation;
+
+        JitStats stats;
+
+        // not copyable because we own code
+        JitCPU( const JitCPU& );
+        JitCPU& operator=( const JitCPU& );
+
+        void emitTrampolines( void );
+        void flush( void );
+        uint8_t* translate( int32_t addr );
+        uint8_t* lookup( int32_t addr );
+        void patch( uint8_t* site, bool indirect, int32_t target, uint8_t* block );
+
+    public:
+        // at most this many instructions go in one block
+        static const unsigned int maxBlockInstructions = 64;
+
+        JitCPU( const std::vector<int32_t> &InitialRamData );
+        ~JitCPU( void );
+
+        // can this host run translated code?
+        static bool isSupported( void );
+
+        // run until we halt or maxCycles have been counted. Cycles are only checked at the start of a
+        //      block so this can go over maxCycles. Returns wheather or not we are halted
+        bool run( uint64_t maxCycles = UINT64_MAX );
+
+        // same as CPU
+        int32_t debugRamRead( int32_t addr );
+        uint64_t getCycleCount( void );
+
+        JitStats getStats( void );
+
+        // printBuffer sends frames to output instead of the terminal. output must outlive us
+        void setVideoOutput( VideoOutput &output );
+};
+
+#endif
@@ -0,0 +1,72 @@
+// runs the tick functions written by tools/levelize
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "LevelizedCPU.h"
+
+LevelizedCPU::LevelizedCPU( const std::vector<int32_t> &InitialRamData ) {
+    if ( InitialRamData.size() > mainMemoryBytes/sizeof(int32_t) )
+        errExit( "Initial RAM data does not fit" );
+
+    memset( &state, 0, sizeof(state) );
+    memset( state.memory + mainMemoryBytes, 0x23, videoBytes ); // '#' = 0x23, like RamAddrTran
+
+    if ( InitialRamData.size() > 0 )
+        memcpy( state.memory, &InitialRamData[0], InitialRamData.size() * sizeof(int32_t) );
+
+    // the same reset values as the CPU constructor
+    state.controlUnitState = ControlUnitStateEnum::Fetch;
+    state.currentOpcode = Opcode::nop;
+    state.programCounter = 0;
+    state.halted = false;
+    state.video = &terminalVideo();
+    cycleCount = 0;
+}
+
+bool LevelizedCPU::clockTick( void ) {
+    // don't bother doing anything if we are halted
+    if ( state.halted )
+        return true;
+
+    cycleCount++;
+
+    levelizedTicks[ static_cast<unsigned int>(state.controlUnitState) ]
+        [ static_cast<unsigned int>(state.currentOpcode) ]( state );
+
+    return state.halted;
+}
+
+int32_t LevelizedCPU::debugRamRead( int32_t addr ) {
+    levelizedCheckAddress( addr );
+
+    // the bytes as they are stored, like CPU::debugRamRead
+    int32_t word;
+    memcpy( &word, state.memory + addr, sizeof(int32_t) );
+    return word;
+}
+
+uint64_t LevelizedCPU::getCycleCount( void ) {
+    return cycleCount;
+}
+
+ControlUnitStateEnum LevelizedCPU::getControlUnitState( void ) {
+    return state.controlUnitState;
+}
+
+int32_t LevelizedCPU::getProgramCounter( void ) {
+    return state.programCounter;
+}
+
+void LevelizedCPU::setVideoOutput( VideoOutput &output ) {
+    state.video = &output;
+}
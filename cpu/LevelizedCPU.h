@@ -0,0 +1,113 @@
+// the cycle accurate CPU as compiled code: one generated function per control unit state and opcode
+// see tools/levelize.cpp for how the functions are made
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef LEVELIZED_CPU_H
+#define LEVELIZED_CPU_H
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <endian.h>
+
+#include "ControlUnitState.h"
+#include "MemoryMap.h"
+#include "Opcodes.h"
+#include "../emulator/debug.h"
+
+// every register in CPU as a plain value. The tick functions written by tools/levelize work on this
+struct LevelizedState {
+    int32_t registers[32]; // the register file. r0 is always 0
+
+    // register file outputs. In CPU these are only defined in the cycle after a read
+    int32_t out1;
+    int32_t out2;
+
+    // the word the RAM read last cycle (already converted from big endian)
+    int32_t ramOut;
+
+    // the special purpose registers in CPU
+    int32_t programCounter;
+    int32_t PCplus4;
+    uint8_t resultArg;
+    int32_t immediate;
+    int32_t aluResult;
+    bool zero;
+    bool positive;
+    bool flagsSet; // zero and positive are undefined until the first ALU instruction
+    bool halted;
+    ControlUnitStateEnum controlUnitState;
+
+    // currentOpcode is undefined during decode in CPU so here fetch sets it to the opcode
+    //      it read. That is what the decode tick is picked by
+    Opcode currentOpcode;
+
+    int8_t memory[ ramBytes ]; // main memory followed by video memory
+
+    VideoOutput* video; // where printBuffer sends frames
+};
+
+// one clock tick for one (controlUnitState, currentOpcode) pair. Only the registers which that
+//      state drives are written
+typedef void (*LevelizedTick)( LevelizedState &s );
+
+// written by tools/levelize (objects/levelizedTicks.cpp). Invalid opcodes get a tick which errors
+const unsigned int levelizedStates = 4;
+const unsigned int levelizedOpcodes = 32;
+extern const LevelizedTick levelizedTicks[ levelizedStates ][ levelizedOpcodes ];
+
+// used by the tick functions: the same address rules as RamAddrTran and RAM
+inline void levelizedCheckAddress( int32_t addr ) {
+    uint32_t address = addr; // negative addresses become huge
+    if ( (address > ramBytes - sizeof(int32_t))
+            || ((address > mainMemoryBytes - sizeof(int32_t)) && (address < mainMemoryBytes)) )
+        errExit( ErrorKind::badAddress, "LevelizedCPU: specified address does not exist" );
+}
+
+// used by the tick functions: a RAM read, including the conversion from big endian
+inline int32_t levelizedRead( const LevelizedState &s, int32_t addr ) {
+    int32_t word;
+    memcpy( &word, s.memory + addr, sizeof(int32_t) );
+    return be32toh( word );
+}
+
+// used by the tick functions: a RAM write. The bytes are stored as they are given, like RAM
+inline void levelizedWrite( LevelizedState &s, int32_t addr, int32_t data ) {
+    memcpy( s.memory + addr, &data, sizeof(int32_t) );
+}
+
+// cycle accurate like CPU, but each clock tick is a call to a straight line function made for the
+//      state and opcode instead of driving and ticking every Signal and Register
+// this does not check for undefined signals so test changes with CPU first
+class LevelizedCPU {
+    private:
+        LevelizedState state;
+        uint64_t cycleCount;
+
+    public:
+        LevelizedCPU( const std::vector<int32_t> &InitialRamData );
+
+        bool clockTick( void ); // returns wheather or not we are halted
+
+        // same as CPU
+        int32_t debugRamRead( int32_t addr );
+        uint64_t getCycleCount( void );
+        ControlUnitStateEnum getControlUnitState( void );
+        int32_t getProgramCounter( void );
+
+        // printBuffer sends frames to output instead of the terminal. output must outlive us
+        void setVideoOutput( VideoOutput &output );
+};
+
+#endif
@@ -0,0 +1,685 @@
+// many copies of the same program run together, one per lane
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "LockstepCPU.h"
+#include "Microcode.h"
+#include "Opcodes.h"
+#include "../emulator/debug.h"
+#include <string.h>
+#include <string>
+#include <endian.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LOCKSTEP_AVX2
+#include <immintrin.h>
+#endif
+
+// the work which is done for all of the lanes in mask at once. There is a portable version of each
+// and (on x86) one using AVX2. A lane's bit of zero and positive is all ones when the flag is set
+struct LockstepKernels {
+    // the lanes in running which are at the lowest program counter. That program counter goes in leaderPC
+    uint32_t (*schedule)( const int32_t* programCounter, uint32_t running, unsigned int numLanes,
+                          uint32_t* leaderPC );
+
+    // dest = a op b (b is the immediate if it is NULL) and set the flags. dest is NULL for writes to r0
+    void (*alu)( AluOps op, const int32_t* a, const int32_t* b, int32_t immediate, int32_t* dest,
+                 int32_t* zero, int32_t* positive, uint32_t mask, unsigned int numLanes );
+
+    // dest = the word at address in each lane's memory, byte swapped like a load. memory is lane 0's
+    //      memory with the others after it. dest is NULL for loads to r0
+    // nothing is loaded if any of the addresses are not valid. The lanes with bad addresses are returned
+    uint32_t (*load)( const int32_t* address, const int8_t* memory, int32_t* dest, uint32_t mask,
+                      unsigned int numLanes );
+
+    // move the program counters on and count the cycles. target is (A) for jumps and branches
+    void (*retire)( PCSource source, int32_t nextPC, const int32_t* target, const int32_t* zero,
+                    const int32_t* positive, int32_t* programCounter, uint64_t* cycleCount,
+                    unsigned int cycles, uint32_t mask, unsigned int numLanes );
+
+    bool simd;
+};
+
+// the same arithmetic as FastCPU: unsigned so that overflow wraps and the shift amount masked like x86
+static inline int32_t aluScalar( AluOps op, int32_t a, int32_t b ) {
+    switch ( op ) {
+        case ( AluOps::add ):
+            return static_cast<int32_t>( static_cast<uint32_t>(a) + static_cast<uint32_t>(b) );
+
+        case ( AluOps::sub ):
+            return static_cast<int32_t>( static_cast<uint32_t>(a) - static_cast<uint32_t>(b) );
+
+        case ( AluOps::nand ):
+            return ~( a & b );
+
+        case ( AluOps::lshift ):
+            return static_cast<int32_t>( static_cast<uint32_t>(a) << (b & 31) );
+
+        default:
+            errExit( "LockstepCPU: invalid ALU operation" );
+            return 0;
+    }
+}
+
+static uint32_t schedulePortable( const int32_t* programCounter, uint32_t running, unsigned int numLanes,
+                                  uint32_t* leaderPC ) {
+    uint32_t least = UINT32_MAX;
+    uint32_t group = 0;
+
+    for ( unsigned int lane = 0; lane < numLanes; lane++ ) {
+        if ( !(running & (UINT32_C(1) << lane)) )
+            continue;
+
+        uint32_t pc = programCounter[lane];
+        if ( pc < least ) {
+            least = pc;
+            group = 0;
+        }
+        if ( pc == least )
+            group |= UINT32_C(1) << lane;
+    }
+
+    *leaderPC = least;
+    return group;
+}
+
+static void aluPortable( AluOps op, const int32_t* a, const int32_t* b, int32_t immediate, int32_t* dest,
+                         int32_t* zero, int32_t* positive, uint32_t mask, unsigned int numLanes ) {
+    for ( unsigned int lane = 0; lane < numLanes; lane++ ) {
+        if ( !(mask & (UINT32_C(1) << lane)) )
+            continue;
+
+        int32_t result = aluScalar( op, a[lane], b ? b[lane] : immediate );
+
+        zero[lane] = ( result == 0 ) ? -1 : 0;
+        positive[lane] = ( result >= 0 ) ? -1 : 0;
+        if ( dest )
+            dest[lane] = result;
+    }
+}
+
+// the same checks as FastCPU: a word must fit inside either the main memory or the video memory
+static inline bool addressValid( int32_t addr ) {
+    uint32_t address = addr; // negative addresses become huge
+    return ( address <= ramBytes - sizeof(int32_t) )
+           && !( (address > mainMemoryBytes - sizeof(int32_t)) && (address < mainMemoryBytes) );
+}
+
+// what FastCPU says about an address which is not valid
+static std::string addressProblem( int32_t addr ) {
+    uint32_t address = addr;
+    if ( address > ramBytes - sizeof(int32_t) )
+        return "Invalid memory address given to LockstepCPU";
+
+    return "LockstepCPU: specified address does not exist";
+}
+
+static uint32_t loadPortable( const int32_t* address, const int8_t* memory, int32_t* dest, uint32_t mask,
+                              unsigned int numLanes ) {
+    uint32_t bad = 0;
+    for ( unsigned int lane = 0; lane < numLanes; lane++ ) {
+        if ( (mask & (UINT32_C(1) << lane)) && !addressValid( address[lane] ) )
+            bad |= UINT32_C(1) << lane;
+    }
+
+    if ( bad || !dest )
+        return bad;
+
+    for ( unsigned int lane = 0; lane < numLanes; lane++ ) {
+        if ( !(mask & (UINT32_C(1) << lane)) )
+            continue;
+
+        int32_t word;
+        memcpy( &word, memory + lane*ramBytes + address[lane], sizeof(int32_t) );
+        dest[lane] = be32toh( word );
+    }
+
+    return 0;
+}
+
+static void retirePortable( PCSource source, int32_t nextPC, const int32_t* target, const int32_t* zero,
+                            const int32_t* positive, int32_t* programCounter, uint64_t* cycleCount,
+                            unsigned int cycles, uint32_t mask, unsigned int numLanes ) {
+    // the flag is all ones or all zeros so it picks between the two addresses
+    const int32_t* flag = ( source == PCSource::ifZero ) ? zero : positive;
+
+    for ( unsigned int lane = 0; lane < numLanes; lane++ ) {
+        if ( !(mask & (UINT32_C(1) << lane)) )
+            continue;
+
+        switch ( source ) {
+            case ( PCSource::PCplus4 ):
+                programCounter[lane] = nextPC;
+                break;
+
+            case ( PCSource::out1 ):
+                programCounter[lane] = target[lane];
+                break;
+
+            case ( PCSource::ifZero ):
+            case ( PCSource::ifPositive ):
+                programCounter[lane] = ( target[lane] & flag[lane] ) | ( nextPC & ~flag[lane] );
+                break;
+
+            case ( PCSource::none ):
+                break;
+        }
+
+        cycleCount[lane] += cycles;
+    }
+}
+
+static const LockstepKernels portableKernels = { schedulePortable, aluPortable, loadPortable, retirePortable, false };
+
+#ifdef LOCKSTEP_AVX2
+// these are compiled for AVX2 on their own so that the rest of the program still runs on hosts without it
+// lanes which are not in mask keep their old values by blending them back in
+
+// all ones in the lanes of this group of 8 whose bit is set in mask
+__attribute__(( target("avx2") ))
+static inline __m256i laneMask( uint32_t mask, unsigned int base ) {
+    const __m256i laneBits = _mm256_setr_epi32( 1, 2, 4, 8, 16, 32, 64, 128 );
+    __m256i bits = _mm256_and_si256( _mm256_set1_epi32( static_cast<int32_t>(mask >> base) ), laneBits );
+    return _mm256_cmpeq_epi32( bits, laneBits );
+}
+
+__attribute__(( target("avx2") ))
+static inline __m256i load8( const int32_t* p ) {
+    return _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p ) );
+}
+
+// p = value in the lanes in active
+__attribute__(( target("avx2") ))
+static inline void blendStore8( int32_t* p, __m256i value, __m256i active ) {
+    __m256i* out = reinterpret_cast<__m256i*>( p );
+    _mm256_storeu_si256( out, _mm256_blendv_epi8( _mm256_loadu_si256( out ), value, active ) );
+}
+
+// lanes which are not running are given the highest address so that they are never the lowest
+__attribute__(( target("avx2") ))
+static uint32_t scheduleAvx2( const int32_t* programCounter, uint32_t running, unsigned int numLanes,
+                              uint32_t* leaderPC ) {
+    const __m256i allOnes = _mm256_set1_epi32( -1 );
+    __m256i keys[4]; // at most 32 lanes
+    __m256i least = allOnes;
+
+    for ( unsigned int base = 0; base < numLanes; base += 8 ) {
+        __m256i notRunning = _mm256_andnot_si256( laneMask( running, base ), allOnes );
+        keys[base / 8] = _mm256_or_si256( load8( programCounter + base ), notRunning );
+        least = _mm256_min_epu32( least, keys[base / 8] );
+    }
+
+    // the minimum of the 8 lanes ends up in all of them
+    least = _mm256_min_epu32( least, _mm256_permute2x128_si256( least, least, 1 ) );
+    least = _mm256_min_epu32( least, _mm256_shuffle_epi32( least, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+    least = _mm256_min_epu32( least, _mm256_shuffle_epi32( least, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+
+    uint32_t group = 0;
+    for ( unsigned int base = 0; base < numLanes; base += 8 ) {
+        __m256i same = _mm256_cmpeq_epi32( keys[base / 8], least );
+        group |= static_cast<uint32_t>( _mm256_movemask_ps( _mm256_castsi256_ps( same ) ) ) << base;
+    }
+
+    *leaderPC = static_cast<uint32_t>( _mm256_cvtsi256_si32( least ) );
+    return group & running;
+}
+
+__attribute__(( target("avx2") ))
+static void aluAvx2( AluOps op, const int32_t* a, const int32_t* b, int32_t immediate, int32_t* dest,
+                     int32_t* zero, int32_t* positive, uint32_t mask, unsigned int numLanes ) {
+    const __m256i allOnes = _mm256_set1_epi32( -1 );
+    const __m256i zeros = _mm256_setzero_si256();
+    const __m256i shiftMask = _mm256_set1_epi32( 31 );
+
+    for ( unsigned int base = 0; base < numLanes; base += 8 ) {
+        __m256i active = laneMask( mask, base );
+        __m256i A = load8( a + base );
+        __m256i B = b ? load8( b + base ) : _mm256_set1_epi32( immediate );
+        __m256i result;
+
+        switch ( op ) {
+            case ( AluOps::add ):
+                result = _mm256_add_epi32( A, B );
+                break;
+
+            case ( AluOps::sub ):
+                result = _mm256_sub_epi32( A, B );
+                break;
+
+            case ( AluOps::nand ):
+                result = _mm256_xor_si256( _mm256_and_si256( A, B ), allOnes );
+                break;
+
+            case ( AluOps::lshift ):
+                result = _mm256_sllv_epi32( A, _mm256_and_si256( B, shiftMask ) );
+                break;
+
+            default:
+                errExit( "LockstepCPU: invalid ALU operation" );
+                return;
+        }
+
+        blendStore8( zero + base, _mm256_cmpeq_epi32( result, zeros ), active );
+        blendStore8( positive + base, _mm256_cmpgt_epi32( result, allOnes ), active ); // result > -1
+        if ( dest )
+            blendStore8( dest + base, result, active );
+    }
+}
+
+// the lanes are gathered from each lane's memory together. Flipping the top bit lets the signed
+// compares do the unsigned ones which addressValid does
+__attribute__(( target("avx2") ))
+static uint32_t loadAvx2( const int32_t* address, const int8_t* memory, int32_t* dest, uint32_t mask,
+                          unsigned int numLanes ) {
+    const __m256i topBit = _mm256_set1_epi32( INT32_MIN );
+    const __m256i lastWord = _mm256_xor_si256( _mm256_set1_epi32( ramBytes - sizeof(int32_t) ), topBit );
+    const __m256i lastMainWord = _mm256_xor_si256( _mm256_set1_epi32( mainMemoryBytes - sizeof(int32_t) ), topBit );
+    const __m256i videoStart = _mm256_xor_si256( _mm256_set1_epi32( mainMemoryBytes ), topBit );
+    const __m256i laneOffsets = _mm256_mullo_epi32( _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 ), _mm256_set1_epi32( ramBytes ) );
+    const __m256i byteSwap = _mm256_setr_epi8( 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                               3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 );
+
+    uint32_t bad = 0;
+    for ( unsigned int base = 0; base < numLanes; base += 8 ) {
+        __m256i biased = _mm256_xor_si256( load8( address + base ), topBit );
+        __m256i outside = _mm256_cmpgt_epi32( biased, lastWord );
+        __m256i gap = _mm256_and_si256( _mm256_cmpgt_epi32( biased, lastMainWord ), _mm256_cmpgt_epi32( videoStart, biased ) );
+        __m256i invalid = _mm256_and_si256( _mm256_or_si256( outside, gap ), laneMask( mask, base ) );
+        bad |= static_cast<uint32_t>( _mm256_movemask_ps( _mm256_castsi256_ps( invalid ) ) ) << base;
+    }
+
+    if ( bad || !dest )
+        return bad;
+
+    for ( unsigned int base = 0; base < numLanes; base += 8 ) {
+        __m256i active = laneMask( mask, base );
+        __m256i offsets = _mm256_add_epi32( _mm256_add_epi32( load8( address + base ), laneOffsets ),
+                                            _mm256_set1_epi32( base * ramBytes ) );
+        __m256i words = _mm256_mask_i32gather_epi32( _mm256_setzero_si256(), reinterpret_cast<const int*>( memory ),
+                                                     offsets, active, 1 );
+        blendStore8( dest + base, _mm256_shuffle_epi8( words, byteSwap ), active );
+    }
+
+    return 0;
+}
+
+__attribute__(( target("avx2") ))
+static void retireAvx2( PCSource source, int32_t nextPC, const int32_t* target, const int32_t* zero,
+                        const int32_t* positive, int32_t* programCounter, uint64_t* cycleCount,
+                        unsigned int cycles, uint32_t mask, unsigned int numLanes ) {
+    const __m256i next = _mm256_set1_epi32( nextPC );
+    const __m256i cyclesToAdd = _mm256_set1_epi64x( cycles );
+
+    for ( unsigned int base = 0; base < numLanes; base += 8 ) {
+        __m256i active = laneMask( mask, base );
+
+        switch ( source ) {
+            case ( PCSource::PCplus4 ):
+                blendStore8( programCounter + base, next, active );
+                break;
+
+            case ( PCSource::out1 ):
+                blendStore8( programCounter + base, load8( target + base ), active );
+                break;
+
+            case ( PCSource::ifZero ):
+                blendStore8( programCounter + base, _mm256_blendv_epi8( next, load8( target + base ), load8( zero + base ) ), active );
+                break;
+
+            case ( PCSource::ifPositive ):
+                blendStore8( programCounter + base, _mm256_blendv_epi8( next, load8( target + base ), load8( positive + base ) ), active );
+                break;
+
+            case ( PCSource::none ):
+                break;
+        }
+
+        // the cycle counts are 64 bit so the 8 lanes are done 4 at a time
+        __m256i* counts = reinterpret_cast<__m256i*>( cycleCount + base );
+        __m256i low = _mm256_cvtepi32_epi64( _mm256_castsi256_si128( active ) );
+        __m256i high = _mm256_cvtepi32_epi64( _mm256_extracti128_si256( active, 1 ) );
+        _mm256_storeu_si256( counts, _mm256_add_epi64( _mm256_loadu_si256( counts ), _mm256_and_si256( low, cyclesToAdd ) ) );
+        _mm256_storeu_si256( counts + 1, _mm256_add_epi64( _mm256_loadu_si256( counts + 1 ), _mm256_and_si256( high, cyclesToAdd ) ) );
+    }
+}
+
+static const LockstepKernels avx2Kernels = { scheduleAvx2, aluAvx2, loadAvx2, retireAvx2, true };
+#endif
+
+template <unsigned int numLanes>
+bool LockstepCPU<numLanes>::simdSupported( void ) {
+    #ifdef LOCKSTEP_AVX2
+        return __builtin_cpu_supports( "avx2" );
+    #else
+        return false;
+    #endif
+}
+
+template <unsigned int numLanes>
+LockstepCPU<numLanes>::LockstepCPU( const std::vector< std::vector<int32_t> > &laneImages, bool useSimd ) {
+    if ( laneImages.size() > numLanes )
+        errExit( "LockstepCPU: more images than lanes" );
+
+    memset( registers, 0, sizeof(registers) );
+    memset( programCounter, 0, sizeof(programCounter) );
+    memset( zero, 0, sizeof(zero) );
+    memset( positive, 0, sizeof(positive) );
+    memset( cycleCount, 0, sizeof(cycleCount) );
+    memset( &stats, 0, sizeof(stats) );
+    flagsSet = 0;
+    halted = 0;
+    faulted = 0;
+
+    for ( unsigned int lane = 0; lane < numLanes; lane++ ) {
+        memset( memory[lane], 0, mainMemoryBytes );
+        memset( memory[lane] + mainMemoryBytes, 0x23, videoBytes ); // '#' = 0x23, like RamAddrTran
+
+        if ( lane >= laneImages.size() ) {
+            halted |= UINT32_C(1) << lane;
+            continue;
+        }
+
+        const std::vector<int32_t> &image = laneImages[lane];
+        if ( image.size() > mainMemoryBytes/sizeof(int32_t) )
+            errExit( "Initial RAM data does not fit" );
+
+        if ( image.size() > 0 )
+            memcpy( memory[lane], &image[0], image.size() * sizeof(int32_t) );
+    }
+
+    // the lanes without an image never fetch anything so they are left out
+    for ( unsigned int i = 0; i < numWords; i++ ) {
+        sameWord[i] = true;
+        decoded[i].valid = false;
+
+        for ( unsigned int lane = 1; lane < laneImages.size(); lane++ ) {
+            if ( memcmp( memory[lane] + i*sizeof(int32_t), memory[0] + i*sizeof(int32_t), sizeof(int32_t) ) != 0 )
+                sameWord[i] = false;
+        }
+    }
+
+    kernels = &portableKernels;
+    #ifdef LOCKSTEP_AVX2
+        if ( useSimd && simdSupported() )
+            kernels = &avx2Kernels;
+    #else
+        (void) useSimd;
+    #endif
+
+    video = &terminalVideo();
+}
+
+template <unsigned int numLanes>
+void LockstepCPU<numLanes>::fault( uint32_t lanes, ErrorKind kind, const std::string &message, int32_t pc,
+                                   unsigned int stage ) {
+    faulted |= lanes;
+
+    for ( uint32_t remaining = lanes; remaining != 0; remaining &= remaining - 1 ) {
+        unsigned int lane = __builtin_ctz( remaining );
+
+        faults[lane].kind = kind;
+        faults[lane].message = message;
+        faults[lane].pc = pc;
+        faults[lane].cycle = cycleCount[lane] + stage;
+        cycleCount[lane] = faults[lane].cycle;
+    }
+}
+
+template <unsigned int numLanes>
+int32_t LockstepCPU<numLanes>::readWord( unsigned int lane, int32_t addr ) {
+    int32_t word;
+    memcpy( &word, memory[lane] + addr, sizeof(int32_t) );
+    return word;
+}
+
+template <unsigned int numLanes>
+void LockstepCPU<numLanes>::storeWord( unsigned int lane, int32_t addr, int32_t data ) {
+    memcpy( memory[lane] + addr, &data, sizeof(int32_t) );
+
+    // the lanes might not all write the same thing. An unaligned write covers two words
+    uint32_t first = static_cast<uint32_t>(addr) / sizeof(int32_t);
+    uint32_t last = ( static_cast<uint32_t>(addr) + sizeof(int32_t) - 1 ) / sizeof(int32_t);
+    for ( uint32_t i = first; (i <= last) && (i < numWords); i++ ) {
+        sameWord[i] = false;
+        decoded[i].valid = false;
+    }
+}
+
+template <unsigned int numLanes>
+bool LockstepCPU<numLanes>::decode( uint32_t word, Decoded &ret ) {
+    const MicroInstruction &m = microcodeFor( static_cast<Opcode>( word & 0x1F ) );
+    if ( !m.valid )
+        return false;
+
+    ret.micro = &m;
+    ret.A = (word >> 5) & 0x1F;
+    ret.B = (word >> 10) & 0x1F;
+    ret.dest = ( m.writeback == Writeback::aluToR1 ) ? 1 : (word >> 15) & 0x1F;
+    ret.cycles = ( m.writeback != Writeback::none ) ? 4 : 3;
+    ret.immediate = static_cast<int32_t>(word) >> 10; // sign extended
+    ret.valid = true;
+    return true;
+}
+
+template <unsigned int numLanes>
+void LockstepCPU<numLanes>::issue( const Decoded &inst, int32_t pc, uint32_t group ) {
+    const MicroInstruction &m = *inst.micro;
+    int32_t nextPC = static_cast<int32_t>( static_cast<uint32_t>(pc) + sizeof(int32_t) );
+
+    stats.issues++;
+    stats.laneInstructions += __builtin_popcount( group );
+
+    if ( m.useAlu ) {
+        const int32_t* b = ( m.aluB == AluBSource::immediate ) ? NULL : registers[inst.B];
+        int32_t* dest = ( inst.dest != 0 ) ? registers[inst.dest] : NULL;
+
+        kernels->alu( m.aluOp, registers[inst.A], b, inst.immediate, dest, zero, positive, group, numLanes );
+        flagsSet |= group;
+    }
+
+    // AVX2 cannot scatter so stores are done a lane at a time
+    switch ( m.memory ) {
+        case ( MemoryOp::read ): {
+            int32_t* dest = ( inst.dest != 0 ) ? registers[inst.dest] : NULL;
+            uint32_t bad = kernels->load( registers[inst.A], memory[0], dest, group, numLanes );
+            if ( bad != 0 ) {
+                // the other lanes still load
+                for ( uint32_t remaining = bad; remaining != 0; remaining &= remaining - 1 ) {
+                    unsigned int lane = __builtin_ctz( remaining );
+                    fault( UINT32_C(1) << lane, ErrorKind::badAddress, addressProblem( registers[inst.A][lane] ), pc, 3 );
+                }
+
+                group &= ~bad;
+                kernels->load( registers[inst.A], memory[0], dest, group, numLanes );
+            }
+            break;
+        }
+
+        case ( MemoryOp::write ):
+            for ( uint32_t remaining = group; remaining != 0; remaining &= remaining - 1 ) {
+                unsigned int lane = __builtin_ctz( remaining );
+                int32_t addr = registers[inst.A][lane];
+
+                if ( addressValid( addr ) ) {
+                    storeWord( lane, addr, registers[inst.B][lane] );
+                } else {
+                    fault( UINT32_C(1) << lane, ErrorKind::badAddress, addressProblem( addr ), pc, 3 );
+                    group &= ~(UINT32_C(1) << lane);
+                }
+            }
+            break;
+
+        case ( MemoryOp::none ):
+            break;
+    }
+
+    switch ( m.system ) {
+        case ( SystemOp::printBuffer ):
+            for ( uint32_t remaining = group; remaining != 0; remaining &= remaining - 1 )
+                video->showFrame( memory[ __builtin_ctz( remaining ) ] + mainMemoryBytes );
+            break;
+
+        case ( SystemOp::halt ):
+            halted |= group;
+            break;
+
+        case ( SystemOp::none ):
+            break;
+    }
+
+    if ( ((m.pc == PCSource::ifZero) || (m.pc == PCSource::ifPositive)) && ((flagsSet & group) != group) ) {
+        fault( group & ~flagsSet, ErrorKind::undefinedValue, "LockstepCPU: branch before the flags were set", pc, 3 );
+        group &= flagsSet;
+    }
+
+    kernels->retire( m.pc, nextPC, registers[inst.A], zero, positive, programCounter, cycleCount,
+                     inst.cycles, group, numLanes );
+}
+
+template <unsigned int numLanes>
+RunStatus LockstepCPU<numLanes>::run( uint64_t maxCycles ) {
+    uint32_t running = 0;
+    // an instruction adds at most 4 cycles to a lane so no lane can get to maxCycles for this many
+    //      issues. The lanes are only checked against maxCycles when this runs out
+    uint64_t safeIssues = 0;
+
+    for ( ;; ) {
+        if ( safeIssues == 0 ) {
+            uint64_t leastRemaining = UINT64_MAX;
+            running = allLanes & ~(halted | faulted);
+
+            for ( unsigned int lane = 0; lane < numLanes; lane++ ) {
+                if ( !(running & (UINT32_C(1) << lane)) )
+                    continue;
+
+                if ( cycleCount[lane] >= maxCycles )
+                    running &= ~(UINT32_C(1) << lane);
+                else if ( maxCycles - cycleCount[lane] < leastRemaining )
+                    leastRemaining = maxCycles - cycleCount[lane];
+            }
+
+            if ( running == 0 )
+                break;
+
+            safeIssues = leastRemaining / 4 + ( (leastRemaining % 4) != 0 );
+        }
+
+        // issue the instruction at the lowest program counter. Lanes which went a different way at a
+        // branch usually meet again further on, so the ones behind are run until they catch up
+        uint32_t leaderPC;
+        uint32_t group = kernels->schedule( programCounter, running, numLanes, &leaderPC );
+        uint32_t index = leaderPC / sizeof(int32_t);
+
+        if ( !addressValid( leaderPC ) ) {
+            fault( group, ErrorKind::badAddress, addressProblem( leaderPC ), leaderPC, 1 );
+        } else if ( ((leaderPC % sizeof(int32_t)) == 0) && (index < numWords) && sameWord[index] ) {
+            // every lane has this instruction so it only needs decoding once
+            if ( decoded[index].valid || decode( be32toh( readWord( __builtin_ctz( group ), leaderPC ) ), decoded[index] ) )
+                issue( decoded[index], leaderPC, group );
+            else
+                fault( group, ErrorKind::invalidOpcode, "In LockstepCPU, invalid opcode", leaderPC, 2 );
+        } else {
+            // the lanes which have something else here wait their turn
+            unsigned int leader = __builtin_ctz( group );
+            int32_t word = readWord( leader, leaderPC );
+
+            for ( uint32_t remaining = group; remaining != 0; remaining &= remaining - 1 ) {
+                unsigned int lane = __builtin_ctz( remaining );
+                if ( readWord( lane, leaderPC ) != word )
+                    group &= ~(UINT32_C(1) << lane);
+            }
+
+            Decoded inst;
+            if ( decode( be32toh( word ), inst ) )
+                issue( inst, leaderPC, group );
+            else
+                fault( group, ErrorKind::invalidOpcode, "In LockstepCPU, invalid opcode", leaderPC, 2 );
+        }
+
+        safeIssues--;
+        running &= ~(halted | faulted);
+        if ( running == 0 )
+            safeIssues = 0;
+    }
+
+    if ( (halted & allLanes) == allLanes )
+        return RunStatus::halted;
+
+    // some lanes stopped at maxCycles rather than halting or faulting
+    if ( ((halted | faulted) & allLanes) != allLanes )
+        return RunStatus::cycleLimit;
+
+    return RunStatus::faulted;
+}
+
+template <unsigned int numLanes>
+bool LockstepCPU<numLanes>::isHalted( unsigned int lane ) {
+    if ( lane >= numLanes )
+        errExit( "LockstepCPU: no such lane" );
+
+    return halted & (UINT32_C(1) << lane);
+}
+
+template <unsigned int numLanes>
+bool LockstepCPU<numLanes>::hasFaulted( unsigned int lane ) {
+    if ( lane >= numLanes )
+        errExit( "LockstepCPU: no such lane" );
+
+    return faulted & (UINT32_C(1) << lane);
+}
+
+template <unsigned int numLanes>
+const CPUFault& LockstepCPU<numLanes>::getFault( unsigned int lane ) {
+    if ( lane >= numLanes )
+        errExit( "LockstepCPU: no such lane" );
+
+    return faults[lane];
+}
+
+template <unsigned int numLanes>
+void LockstepCPU<numLanes>::setVideoOutput( VideoOutput &output ) {
+    video = &output;
+}
+
+template <unsigned int numLanes>
+LockstepStats LockstepCPU<numLanes>::getStats( void ) {
+    return stats;
+}
+
+template <unsigned int numLanes>
+bool LockstepCPU<numLanes>::usingSimd( void ) {
+    return kernels->simd;
+}
+
+template <unsigned int numLanes>
+int32_t LockstepCPU<numLanes>::debugRamRead( unsigned int lane, int32_t addr ) {
+    if ( lane >= numLanes )
+        errExit( "LockstepCPU: no such lane" );
+
+    if ( !addressValid( addr ) )
+        errExit( ErrorKind::badAddress, addressProblem( addr ) );
+
+    return readWord( lane, addr );
+}
+
+template <unsigned int numLanes>
+uint64_t LockstepCPU<numLanes>::getCycleCount( unsigned int lane ) {
+    if ( lane >= numLanes )
+        errExit( "LockstepCPU: no such lane" );
+
+    return cycleCount[lane];
+}
+
+// the lane counts which are used
+template class LockstepCPU<8>;
+template class LockstepCPU<16>;
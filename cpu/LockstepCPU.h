@@ -0,0 +1,143 @@
+// many copies of the same program run together, one per lane
+// The registers, program counters and flags of every lane are kept as structure of arrays so that an
+// ALU instruction is done for all of the lanes at once (with AVX2 when the host has it). Each lane
+// has its own memory so the lanes can start with different data. Lanes whose control flow goes a
+// different way are masked off until they meet the others again. Like FastCPU this is an
+// instruction set level model: the cycle counts are exact but the datapath is not modelled.
+// A lane which faults stops and the others carry on.
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef LOCKSTEP_CPU_H
+#define LOCKSTEP_CPU_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "MemoryMap.h"
+#include "CPUFault.h"
+#include "aluOps.h"
+
+// how well the lanes stayed together
+struct LockstepStats {
+    uint64_t issues;           // instructions issued (each one runs on some of the lanes)
+    uint64_t laneInstructions; // instructions run, counting each lane separately
+};
+
+// the functions which do the work for all of the lanes at once (see LockstepCPU.cpp)
+struct LockstepKernels;
+
+struct MicroInstruction;
+
+// numLanes is a multiple of 8 (one AVX2 register of int32_t) and at most 32 (a bit each in a uint32_t)
+// this holds the memory for every lane so it is big: allocate it with new
+template <unsigned int numLanes>
+class LockstepCPU {
+    static_assert( (numLanes % 8 == 0) && (numLanes <= 32), "LockstepCPU lanes must be a multiple of 8 up to 32" );
+
+    private:
+        static const unsigned int numWords = ramBytes / sizeof(int32_t);
+        static const uint32_t allLanes = (numLanes == 32) ? UINT32_MAX : ((UINT32_C(1) << numLanes) - 1);
+
+        // an instruction with its fields pulled out, so it is only decoded once for all of the lanes
+        struct Decoded {
+            const MicroInstruction* micro;
+            uint8_t A;
+            uint8_t B;
+            uint8_t dest; // 1 for addImmediate and subImmediate
+            uint8_t cycles;
+            int32_t immediate;
+            bool valid;
+        };
+
+        // registers[r][lane]: one register for every lane is next to each other. r0 is always 0
+        int32_t registers[32][numLanes];
+        int32_t programCounter[numLanes];
+        int32_t zero[numLanes];     // all ones if the lane's last ALU result was 0
+        int32_t positive[numLanes]; // all ones if the lane's last ALU result was >= 0
+        uint64_t cycleCount[numLanes];
+
+        // a bit for each lane
+        uint32_t flagsSet; // the flags are undefined until the lane's first ALU instruction
+        uint32_t halted;
+        uint32_t faulted;
+
+        CPUFault faults[numLanes]; // only meaningful for the lanes in faulted
+
+        const LockstepKernels* kernels;
+        LockstepStats stats;
+        VideoOutput* video; // where printBuffer sends frames
+
+        // true while every lane has the same word here, so an instruction there is the same for all of them
+        bool sameWord[numWords];
+
+        // the instructions at word aligned addresses where sameWord is true. Made the first time they are run
+        Decoded decoded[numWords];
+
+        // main memory followed by video memory for each lane. Unwritten memory reads as 0
+        int8_t memory[numLanes][ramBytes];
+
+        // not copyable (it is far too big to want to)
+        LockstepCPU( const LockstepCPU& );
+        LockstepCPU& operator=( const LockstepCPU& );
+
+        // stop lanes because of something the program did in the instruction at pc. stage is the cycle
+        //      of the instruction CPU would have found it in: 1 for fetch, 2 for decode or 3 for execute
+        void fault( uint32_t lanes, ErrorKind kind, const std::string &message, int32_t pc, unsigned int stage );
+
+        // bytes at addr as they are stored
+        int32_t readWord( unsigned int lane, int32_t addr );
+
+        // addr must have been checked
+        void storeWord( unsigned int lane, int32_t addr, int32_t data );
+
+        // returns false if word is not an instruction
+        static bool decode( uint32_t word, Decoded &ret );
+
+        // run inst, which is at pc, for every lane in group. Lanes which fault stop there
+        void issue( const Decoded &inst, int32_t pc, uint32_t group );
+
+    public:
+        static const unsigned int lanes = numLanes;
+
+        // lane i starts with laneImages[i] at address 0. Lanes without an image start halted
+        // useSimd = false does everything without AVX2 even if the host has it (for testing)
+        LockstepCPU( const std::vector< std::vector<int32_t> > &laneImages, bool useSimd = true );
+
+        // run until every lane has halted, faulted or counted maxCycles
+        // an instruction is not split so a lane can go over maxCycles by a little
+        // returns halted if every lane has halted, cycleLimit if any lane could carry on and faulted
+        //      otherwise. A lane's fault has the same kind, address and cycle as FastCPU::run would give
+        RunStatus run( uint64_t maxCycles = UINT64_MAX );
+
+        bool isHalted( unsigned int lane );
+        bool hasFaulted( unsigned int lane );
+        const CPUFault& getFault( unsigned int lane ); // only meaningful if hasFaulted
+
+        // printBuffer sends frames to output instead of the terminal. output must outlive us
+        void setVideoOutput( VideoOutput &output );
+
+        LockstepStats getStats( void );
+
+        // are the lanes being run with AVX2?
+        bool usingSimd( void );
+
+        // can this host run the lanes with AVX2?
+        static bool simdSupported( void );
+
+        // same as FastCPU but for one lane
+        int32_t debugRamRead( unsigned int lane, int32_t addr );
+        uint64_t getCycleCount( unsigned int lane );
+};
+
+#endif
@@ -0,0 +1,24 @@
+// sizes of the cpu's address space
+// main memory starts at address 0 and the video memory takes the top videoBytes addresses
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef MEMORY_MAP_H
+#define MEMORY_MAP_H
+
+#include "Video.h"
+
+const unsigned int ramBytes = 10240; // main memory and video memory together
+const unsigned int mainMemoryBytes = ramBytes - videoBytes;
+
+#endif
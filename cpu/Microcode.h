@@ -0,0 +1,163 @@
+// the microcode ROM for the control unit: the control signals for each opcode
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef MICROCODE_H
+#define MICROCODE_H
+
+#include "aluOps.h"
+#include "ControlUnitState.h"
+#include "Opcodes.h"
+
+// where the ALU gets its B input from in execute (A is always register file output 1)
+enum class AluBSource {
+    out2,     // register file output 2
+    immediate // the immediate register
+};
+
+// what execute does with the RAM. The address is always register file output 1
+enum class MemoryOp {
+    none,
+    read, // the word is available to write in the next cycle
+    write // the data is register file output 2
+};
+
+// what execute drives the program counter with
+enum class PCSource {
+    none,      // the program counter is not driven (only halt)
+    PCplus4,
+    out1,      // register file output 1 (jumpToReg)
+    ifZero,    // out1 if the zero flag is set, otherwise PCplus4 (ifZeroMux)
+    ifPositive // out1 if the positive flag is set, otherwise PCplus4 (ifPositiveMux)
+};
+
+enum class SystemOp {
+    none,
+    printBuffer,
+    halt
+};
+
+// what write puts in to the register file
+enum class Writeback {
+    none,         // write is skipped
+    aluToResult,  // (resultArg) = aluResult
+    aluToR1,      // r1 = aluResult (addImmediate and subImmediate)
+    ramToResult   // (resultArg) = the word read by execute
+};
+
+// the control signals for one opcode
+struct MicroInstruction {
+    bool valid;
+    const char* name; // for debugSignal
+
+    // decode: the register file read ports used and the decoded fields which are kept
+    bool readA;          // out1 = (A)
+    bool readB;          // out2 = (B)
+    bool latchResult;    // resultArg = result
+    bool latchImmediate; // immediate = immediate
+
+    // execute
+    bool useAlu; // sets aluResult and the flags
+    AluOps aluOp;
+    AluBSource aluB;
+    MemoryOp memory;
+    PCSource pc;
+    SystemOp system;
+    ControlUnitStateEnum afterExecute; // Write, or Fetch to skip write
+
+    // write
+    Writeback writeback;
+};
+
+// add, sub, nand and lshift: (result) = (A) op (B)
+constexpr MicroInstruction microAlu( const char* name, AluOps op ) {
+    return MicroInstruction{ true, name, true, true, true, false,
+        true, op, AluBSource::out2, MemoryOp::none, PCSource::PCplus4, SystemOp::none,
+        ControlUnitStateEnum::Write, Writeback::aluToResult };
+}
+
+// addImmediate and subImmediate: r1 = (A) op immediate
+constexpr MicroInstruction microImmediate( const char* name, AluOps op ) {
+    return MicroInstruction{ true, name, true, false, false, true,
+        true, op, AluBSource::immediate, MemoryOp::none, PCSource::PCplus4, SystemOp::none,
+        ControlUnitStateEnum::Write, Writeback::aluToR1 };
+}
+
+// jumpToReg, branchIfZero and branchIfPositive: PC = (A), maybe
+constexpr MicroInstruction microJump( const char* name, PCSource pc ) {
+    return MicroInstruction{ true, name, true, false, false, false,
+        false, AluOps::nop, AluBSource::out2, MemoryOp::none, pc, SystemOp::none,
+        ControlUnitStateEnum::Fetch, Writeback::none };
+}
+
+// instructions which do not read any registers
+constexpr MicroInstruction microSystem( const char* name, PCSource pc, SystemOp system,
+        ControlUnitStateEnum afterExecute ) {
+    return MicroInstruction{ true, name, false, false, false, false,
+        false, AluOps::nop, AluBSource::out2, MemoryOp::none, pc, system,
+        afterExecute, Writeback::none };
+}
+
+constexpr MicroInstruction microInvalid( void ) {
+    return MicroInstruction{ false, "invalid", false, false, false, false,
+        false, AluOps::nop, AluBSource::out2, MemoryOp::none, PCSource::none, SystemOp::none,
+        ControlUnitStateEnum::Fetch, Writeback::none };
+}
+
+const unsigned int numMicroInstructions = 32; // opcodes are 5 bits
+
+// the microcode ROM, indexed by opcode. Adding an instruction is adding an entry here (and to Opcode)
+// everything which needs to know what an opcode does should use this so that they all agree
+constexpr MicroInstruction microcode[ numMicroInstructions ] = {
+    /* 0x00 */ microSystem( "nop", PCSource::PCplus4, SystemOp::none, ControlUnitStateEnum::Fetch ),
+    /* 0x01 */ microImmediate( "addImmediate", AluOps::add ),
+    /* 0x02 */ microImmediate( "subImmediate", AluOps::sub ),
+    /* 0x03 */ microAlu( "add", AluOps::add ),
+    /* 0x04 */ microAlu( "sub", AluOps::sub ),
+    /* 0x05 */ microAlu( "nand", AluOps::nand ),
+    /* 0x06 */ microAlu( "lshift", AluOps::lshift ),
+    /* 0x07 */ microJump( "jumpToReg", PCSource::out1 ),
+    /* 0x08 */ microInvalid(),
+    /* 0x09 */ microJump( "branchIfZero", PCSource::ifZero ),
+    /* 0x0A */ microJump( "branchIfPositive", PCSource::ifPositive ),
+    /* 0x0B */ microInvalid(),
+    /* 0x0C */ microInvalid(),
+    /* 0x0D */ microInvalid(),
+    /* 0x0E */ MicroInstruction{ true, "load", true, false, true, false,
+                   false, AluOps::nop, AluBSource::out2, MemoryOp::read, PCSource::PCplus4, SystemOp::none,
+                   ControlUnitStateEnum::Write, Writeback::ramToResult },
+    /* 0x0F */ MicroInstruction{ true, "store", true, true, false, false,
+                   false, AluOps::nop, AluBSource::out2, MemoryOp::write, PCSource::PCplus4, SystemOp::none,
+                   ControlUnitStateEnum::Fetch, Writeback::none },
+    /* 0x10 */ microSystem( "printBuffer", PCSource::PCplus4, SystemOp::printBuffer, ControlUnitStateEnum::Fetch ),
+    // the control unit still goes to write after halt but the CPU stops before it gets there
+    /* 0x11 */ microSystem( "halt", PCSource::none, SystemOp::halt, ControlUnitStateEnum::Write ),
+    microInvalid(), microInvalid(), microInvalid(), microInvalid(), microInvalid(), microInvalid(),
+    microInvalid(), microInvalid(), microInvalid(), microInvalid(), microInvalid(), microInvalid(),
+    microInvalid(), microInvalid()
+};
+
+// the ROM entry for an opcode (which might not be valid)
+constexpr const MicroInstruction& microcodeFor( Opcode op ) {
+    return microcode[ static_cast<unsigned int>(op) & (numMicroInstructions - 1) ];
+}
+
+// the ROM has to agree with Opcode
+static_assert( microcodeFor( Opcode::add ).aluOp == AluOps::add, "microcode is out of order" );
+static_assert( microcodeFor( Opcode::load ).memory == MemoryOp::read, "microcode is out of order" );
+static_assert( microcodeFor( Opcode::store ).memory == MemoryOp::write, "microcode is out of order" );
+static_assert( microcodeFor( Opcode::branchIfZero ).pc == PCSource::ifZero, "microcode is out of order" );
+static_assert( microcodeFor( Opcode::printBuffer ).system == SystemOp::printBuffer, "microcode is out of order" );
+static_assert( microcodeFor( Opcode::halt ).system == SystemOp::halt, "microcode is out of order" );
+
+#endif
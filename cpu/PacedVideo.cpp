@@ -0,0 +1,143 @@
+// passing frames on at a set frame rate. See header file
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "PacedVideo.h"
+#include <string.h>
+#include <thread>
+#include <utility>
+
+PacedVideo::PacedVideo( VideoOutput &output, double framesPerSecond, bool wait )
+    : output( output ), wait( wait ), due( Clock::now() ), havePending( false ), pending( frames[0] ),
+      showing( frames[1] ), presenting( false ), stopping( false ) {
+    if ( framesPerSecond > 0 )
+        period = std::chrono::duration_cast<Clock::duration>( std::chrono::duration<double>( 1 / framesPerSecond ) );
+    else
+        period = Clock::duration::zero();
+
+    stats.presented = 0;
+    stats.skipped = 0;
+    stats.stallSeconds = 0;
+
+    // frames are only kept if we don't wait and there is a frame rate
+    if ( !wait && (period > Clock::duration::zero()) )
+        timer = std::thread( &PacedVideo::showWhenDue, this );
+}
+
+PacedVideo::~PacedVideo( void ) {
+    if ( timer.joinable() ) {
+        {
+            std::lock_guard<std::mutex> guard( lock );
+            stopping = true;
+        }
+        wake.notify_all();
+        timer.join();
+    }
+
+    flush();
+}
+
+void PacedVideo::present( std::unique_lock<std::mutex> &guard, const int8_t* frame, Clock::time_point now ) {
+    presenting = true;
+
+    // if we are late the next frame is a whole period from now, so frames never bunch up
+    due += period;
+    if ( due < now )
+        due = now + period;
+
+    guard.unlock();
+    output.showFrame( frame );
+    guard.lock();
+
+    // counted once output has finished, so a caller who sees the count can look at output
+    stats.presented++;
+    presenting = false;
+    wake.notify_all();
+}
+
+void PacedVideo::presentPending( std::unique_lock<std::mutex> &guard ) {
+    // frames reach output in the order they came, so wait for the one being shown
+    while ( presenting )
+        wake.wait( guard );
+
+    if ( havePending ) {
+        // showFrame can keep another frame while output has this one
+        havePending = false;
+        std::swap( pending, showing );
+        present( guard, showing, Clock::now() );
+    }
+}
+
+void PacedVideo::showWhenDue( void ) {
+    std::unique_lock<std::mutex> guard( lock );
+
+    while ( !stopping ) {
+        if ( !havePending || presenting ) {
+            wake.wait( guard );
+            continue;
+        }
+
+        // due can move (when showFrame presents a newer frame) so it is looked at again after waking
+        if ( Clock::now() >= due )
+            presentPending( guard );
+        else
+            wake.wait_until( guard, due );
+    }
+}
+
+void PacedVideo::showFrame( const int8_t* frame ) {
+    std::unique_lock<std::mutex> guard( lock );
+    Clock::time_point now = Clock::now();
+
+    if ( wait ) {
+        // there is no timer thread when waiting, so only flush can be showing a frame
+        while ( presenting )
+            wake.wait( guard );
+
+        now = Clock::now();
+        if ( now < due ) {
+            // nothing else needs the lock for long, so it is kept
+            std::this_thread::sleep_until( due );
+            Clock::time_point woken = Clock::now();
+            stats.stallSeconds += std::chrono::duration<double>( woken - now ).count();
+            now = woken;
+        }
+    } else if ( (now < due) || presenting ) {
+        if ( havePending )
+            stats.skipped++;
+
+        memcpy( pending, frame, videoBytes );
+        havePending = true;
+        guard.unlock();
+        wake.notify_all();
+        return;
+    }
+
+    // anything being kept is older than this frame
+    if ( havePending ) {
+        stats.skipped++;
+        havePending = false;
+    }
+
+    present( guard, frame, now );
+}
+
+void PacedVideo::flush( void ) {
+    std::unique_lock<std::mutex> guard( lock );
+    presentPending( guard );
+}
+
+PacingStats PacedVideo::getStats( void ) {
+    std::lock_guard<std::mutex> guard( lock );
+    return stats;
+}
@@ -0,0 +1,94 @@
+// a VideoOutput which passes frames on to another one no faster than a set frame rate
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef PACED_VIDEO_H
+#define PACED_VIDEO_H
+
+#include "Video.h"
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+struct PacingStats {
+    uint64_t presented;  // frames passed on
+    uint64_t skipped;    // frames replaced by a newer one before it was time to show them
+    double stallSeconds; // time spent waiting for a frame to be due (only when waiting)
+};
+
+// frames are timed with the monotonic clock. One which comes before the next frame is due is kept
+//      instead of being shown. If another comes first that one is skipped, otherwise a thread of our
+//      own shows it once it is due. So a program which prints frames faster than the frame rate is
+//      shown at the frame rate, and the last frame it prints is shown soon after, even if the
+//      program goes on for a long time without printing another
+// output is given frames by that thread as well as by the thread calling showFrame, but never by
+//      both at once and never with the lock held. If the timer thread is in output when a frame comes,
+//      the frame is kept like an early one, so showFrame does not wait for the terminal
+// if wait is set the CPU is made to wait until each frame is due instead, so nothing is skipped
+//      and the program runs no faster than the frame rate. This is for watching an animation on a
+//      terminal: with no terminal (writing to a file or a FrameHashLog) leave wait unset and the CPU
+//      never sleeps
+class PacedVideo : public VideoOutput {
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        VideoOutput &output;
+        Clock::duration period;
+        bool wait;
+
+        // everything after this is shared with the timer thread
+        std::mutex lock;
+        std::condition_variable wake; // a frame was kept, one has been shown or we are stopping
+
+        Clock::time_point due; // when the next frame can be shown
+        bool havePending;
+        int8_t* pending;  // the frame being kept
+        int8_t* showing;  // the last frame taken from pending, which output may still be looking at
+        int8_t frames[2][ videoBytes ];
+
+        // set while a thread is in output. Only the thread which set it calls output
+        bool presenting;
+
+        PacingStats stats;
+
+        // shows the pending frame when it is due. Only started if frames can be kept
+        std::thread timer;
+        bool stopping;
+
+        PacedVideo( const PacedVideo& );
+        PacedVideo& operator=( const PacedVideo& );
+
+        // these are called with lock held by guard. They let go of it while output has the frame
+        void present( std::unique_lock<std::mutex> &guard, const int8_t* frame, Clock::time_point now );
+        void presentPending( std::unique_lock<std::mutex> &guard );
+
+        void showWhenDue( void );
+
+    public:
+        // frames are passed to output, which must outlive us. framesPerSecond of 0 means no limit
+        PacedVideo( VideoOutput &output, double framesPerSecond, bool wait = false );
+
+        // shows the frame which is being kept, if there is one
+        ~PacedVideo( void );
+
+        void showFrame( const int8_t* frame );
+
+        // show the frame which is being kept now instead of waiting for the next frame
+        void flush( void );
+
+        PacingStats getStats( void );
+};
+
+#endif
@@ -33,27 +33,84 @@
 #define RAM_ADDR_TRANS
 
 #include "ram.h" // this also includes most of the other headers we will need
-#include <iostream>
-#include <unistd.h>
+#include "Video.h"
+#include <string.h>
+
+// a RamAddrTran as plain data
+template <unsigned int numBytes> struct RamAddrTranState {
+    RAMState<numBytes-videoBytes> mainMemory;
+    RAMState<videoBytes> videoMemory;
+    SignalState<bool> oldVideoMemorySelected;
+};
+
+// the parts of a RamAddrTranState which are not in pages: what was read on the last clock tick
+struct RamAddrTranOutputs {
+    SignalState<int32_t> mainMemory;
+    SignalState<int32_t> videoMemory;
+    SignalState<bool> oldVideoMemorySelected;
+};
+
+template <unsigned int numBytes>
+void readOutputs( const RamAddrTranState<numBytes> &state, RamAddrTranOutputs &out ) {
+    out.mainMemory = state.mainMemory.output;
+    out.videoMemory = state.videoMemory.output;
+    out.oldVideoMemorySelected = state.oldVideoMemorySelected;
+}
+
+template <unsigned int numBytes>
+void writeOutputs( RamAddrTranState<numBytes> &state, const RamAddrTranOutputs &in ) {
+    state.mainMemory.output = in.mainMemory;
+    state.videoMemory.output = in.videoMemory;
+    state.oldVideoMemorySelected = in.oldVideoMemorySelected;
+}
+
+// the pages of a RamAddrTranState are numbered through the main memory and then the video memory
+template <unsigned int numBytes> unsigned int mainMemoryPages( void ) {
+    return (numBytes - videoBytes + RAM_PAGE_BYTES - 1) / RAM_PAGE_BYTES;
+}
+
+template <unsigned int numBytes> unsigned int ramAddrTranPages( void ) {
+    return mainMemoryPages<numBytes>() + (videoBytes + RAM_PAGE_BYTES - 1) / RAM_PAGE_BYTES;
+}
+
+template <unsigned int numBytes>
+void readPage( const RamAddrTranState<numBytes> &state, unsigned int page, RAMPage &out ) {
+    if ( page < mainMemoryPages<numBytes>() )
+        readPage( state.mainMemory, page, out );
+    else
+        readPage( state.videoMemory, page - mainMemoryPages<numBytes>(), out );
+}
+
+template <unsigned int numBytes>
+void writePage( RamAddrTranState<numBytes> &state, unsigned int page, const RAMPage &in ) {
+    if ( page < mainMemoryPages<numBytes>() )
+        writePage( state.mainMemory, page, in );
+    else
+        writePage( state.videoMemory, page - mainMemoryPages<numBytes>(), in );
+}
 
 // the types are assumed to be numeric or atleast have those sorts of operators working
 // generally just keep the types as integers. In the context of the cpu, nothing else really makes sense
 // TODO: template magic to force the types to be integral
-template <typename AddressType, unsigned int numBytes> class RamAddrTran {
+template <typename AddressType, unsigned int numBytes, typename Checking = DefaultChecking> class RamAddrTran {
     private:
-        RAM<AddressType, numBytes-4096> *mainMemory;
-        RAM<AddressType, 4096> *videoMemory;
-        Signal<bool> videoMemorySelected; // we are using the video memory this cycle
-        Signal<bool> oldVideoMemorySelected; // from the previous clock cycle so getData knows which one to return from
+        RAM<AddressType, numBytes-videoBytes, Checking> *mainMemory;
+        RAM<AddressType, videoBytes, Checking> *videoMemory;
+        Signal<bool, Checking> videoMemorySelected; // we are using the video memory this cycle
+        Signal<bool, Checking> oldVideoMemorySelected; // from the previous clock cycle so getData knows which one to return from
                                              // this would not need to exit in a hardware implementation because the correct
                                              // ram object would be writing to the memory data bus and the other would be 
                                              // resenting a high impedance output. 
 
+        // not copyable because we own the RAMs
+        RamAddrTran( const RamAddrTran& );
+        RamAddrTran& operator=( const RamAddrTran& );
+
         // combinational logic translating an address to whatever it should be
         // the target memory is returned by refference becasue we need to return two arguments
         AddressType translateAddress( AddressType input, bool& videoAddr ) {
             if ( input > static_cast<AddressType>(numBytes-1) ) {
-                errExit( "Invalid memory address given to ramAddrTran" );
+                errExit( ErrorKind::badAddress, "Invalid memory address given to ramAddrTran" );
             } else if ( input > static_cast<AddressType>(numBytes-4097) ) { // top 4096 addresses
                 videoAddr = true;
                 return input - (numBytes - 4096); // pretty substantial combinational logic is needed to make this happen
@@ -68,20 +125,37 @@ template <typename AddressType, unsigned int numBytes> class RamAddrTran {
             return input;
         }
 
-    public:
-        // constructor with initial data for the main memory
-        RamAddrTran( const std::vector<int32_t> &InitialData ) {
+        // the video memory starts filled with '#'. Every RamAddrTran shares this until it writes to it
+        static std::shared_ptr< const RAMImage<videoBytes> > videoImage( void ) {
+            static std::shared_ptr< const RAMImage<videoBytes> > image =
+                std::make_shared< const RAMImage<videoBytes> >( std::vector<int32_t>( videoBytes / sizeof(int32_t), 0x23232323 ) ); // '#' = 0x23
+            return image;
+        }
+
+        void checkSize( void ) {
             if (numBytes < 4097)
                 errExit( "Your RAM can't fit the fixed-size frame buffer" );
+        }
 
-            mainMemory = new RAM<AddressType, numBytes-4096>( InitialData );
-
-            std::vector<int32_t> videoInitial;
+        void resetVideo( void ) {
+            videoMemory->reset( videoImage() );
+            videoMemorySelected.undefine();
+            oldVideoMemorySelected.undefine();
+        }
 
-            for ( unsigned int i = 0; i <= 4096-sizeof(int32_t); i+= sizeof(int32_t) )
-                videoInitial.push_back( 0x23232323 ); // '#' = 0x23
+    public:
+        // constructor with initial data for the main memory
+        RamAddrTran( const std::vector<int32_t> &InitialData ) {
+            checkSize();
+            mainMemory = new RAM<AddressType, numBytes-videoBytes, Checking>( InitialData );
+            videoMemory = new RAM<AddressType, videoBytes, Checking>( videoImage() );
+        }
 
-            videoMemory = new RAM<AddressType, 4096>( videoInitial );
+        // the main memory starts as mainImage, which can be shared with other RamAddrTrans
+        RamAddrTran( const std::shared_ptr< const RAMImage<numBytes-videoBytes> > &mainImage ) {
+            checkSize();
+            mainMemory = new RAM<AddressType, numBytes-videoBytes, Checking>( mainImage );
+            videoMemory = new RAM<AddressType, videoBytes, Checking>( videoImage() );
         }
 
         // destructor to unallocate the RAM objects
@@ -90,6 +164,41 @@ template <typename AddressType, unsigned int numBytes> class RamAddrTran {
             delete videoMemory;
         }
 
+        // start again as if we had just been constructed, reusing the memory we already have
+        void reset( const std::vector<int32_t> &InitialData ) {
+            mainMemory->reset( InitialData );
+            resetVideo();
+        }
+
+        void reset( const std::shared_ptr< const RAMImage<numBytes-videoBytes> > &mainImage ) {
+            mainMemory->reset( mainImage );
+            resetVideo();
+        }
+
+        void saveState( RamAddrTranState<numBytes> &state ) {
+            mainMemory->saveState( state.mainMemory );
+            videoMemory->saveState( state.videoMemory );
+            oldVideoMemorySelected.saveState( state.oldVideoMemorySelected );
+        }
+
+        // only copy the pages written since the state was last saved or restored (see RAM::saveDirtyState)
+        void saveDirtyState( RamAddrTranState<numBytes> &state, std::vector<unsigned int> &pages ) {
+            mainMemory->saveDirtyState( state.mainMemory, pages, 0 );
+            videoMemory->saveDirtyState( state.videoMemory, pages, mainMemoryPages<numBytes>() );
+            oldVideoMemorySelected.saveState( state.oldVideoMemorySelected );
+        }
+
+        void restoreState( const RamAddrTranState<numBytes> &state ) {
+            mainMemory->restoreState( state.mainMemory );
+            videoMemory->restoreState( state.videoMemory );
+            oldVideoMemorySelected.restoreState( state.oldVideoMemorySelected );
+            videoMemorySelected.undefine();
+        }
+
+        unsigned int privatePages( void ) {
+            return mainMemory->privatePages() + videoMemory->privatePages();
+        }
+
         // pass through to the appropiate RAM object
         int32_t debugRead( AddressType addr ) {
             bool videoAddr; // are we talking about the video memory or not?
@@ -106,35 +215,28 @@ template <typename AddressType, unsigned int numBytes> class RamAddrTran {
             return ret;
         }
 
-        // send the video buffer to stdout
-        void printBuffer( void ) {
-            // clear the console
-            // source: https://stackoverflow.com/questions/228617/how-do-i-clear-the-console-in-both-windows-and-linux-using-c#228625
-            #ifdef WINDOWS
-                system("cls");
-            #else
-                system("clear");
-            #endif
-
-            for ( unsigned int y = 0; y < 64; y++ ) {
-                for ( unsigned int x = 0; x < 60; x+= 4 ) {
-                    // we are going to use debug reads so that it happens instantly. 
-                    // In an actual computer, actually sending the data to the console output or video adapter etc
-                    // For example, a PCIE video card might have dma access to the video buffer and after receiving this signal
-                    // could print the buffer in it's own time without causing the main processor to stall and wait
-                    // (unless it next wants to write to the video buffer)
-                    // all in all this is just to keep this simple. It is only a few % of a 2nd year module after all 
-                    int32_t fourChars = videoMemory->debugRead( 64*y + x );
-
-                    for ( unsigned int i = 0; i < 4; i++ )
-                        std::cout << ((char*) &fourChars)[i];
-                }
-
-                std::cout << std::endl;
-             }  
-             debug( "Beginning artifitial pause to make the animation nicer" );
-             usleep(100); // make the animation happen slow enough that my terminal can keep up
-             debug( "Finished artificual pause" );
+        // every byte of the main memory and then the video memory, whether it has been written or not
+        void copyOut( int8_t* dest ) {
+            mainMemory->copyOut( dest );
+            videoMemory->copyOut( dest + (numBytes - videoBytes) );
+        }
+
+        // send the video buffer to video
+        void printBuffer( VideoOutput &video ) {
+            int8_t buffer[ videoBytes ];
+            int8_t* frame = video.beginFrame();
+            if ( frame == NULL )
+                frame = buffer;
+
+            // we are going to copy the memory out directly so that it happens instantly.
+            // In an actual computer, actually sending the data to the console output or video adapter etc
+            // For example, a PCIE video card might have dma access to the video buffer and after receiving this signal
+            // could print the buffer in it's own time without causing the main processor to stall and wait
+            // (unless it next wants to write to the video buffer)
+            // all in all this is just to keep this simple. It is only a few % of a 2nd year module after all 
+            videoMemory->copyOut( frame );
+
+            video.showFrame( frame );
         }
 
         // passthrough to appropiate ram object
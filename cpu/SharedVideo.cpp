@@ -0,0 +1,222 @@
+// putting frames in shared memory for other processes. See header file
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "SharedVideo.h"
+#include "../emulator/debug.h"
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <signal.h>
+#include <errno.h>
+#include <chrono>
+#include <thread>
+
+static const char magic[] = "CPUSHM01";
+
+int64_t monotonicNanoseconds( void ) {
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return static_cast<int64_t>( now.tv_sec ) * 1000000000 + now.tv_nsec;
+}
+
+SharedVideo::SharedVideo( const std::string &name ) : name( name ) {
+    int fd = shm_open( name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644 );
+    if ( fd < 0 )
+        errExit( "Could not make the shared memory segment " + name );
+
+    if ( ftruncate( fd, sizeof(SharedFrame) ) != 0 ) {
+        close( fd );
+        shm_unlink( name.c_str() );
+        errExit( "Could not size the shared memory segment " + name );
+    }
+
+    void* mapped = mmap( NULL, sizeof(SharedFrame), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd ); // the mapping keeps the segment
+    if ( mapped == MAP_FAILED ) {
+        shm_unlink( name.c_str() );
+        errExit( "Could not map the shared memory segment " + name );
+    }
+
+    // the segment starts as zeros, which is a valid state for the atomics
+    shared = static_cast<SharedFrame*>( mapped );
+    shared->width = videoWidth;
+    shared->height = videoHeight;
+    shared->writerPid = getpid();
+    memset( shared->frame, 0, videoBytes );
+
+    // the magic goes in last so a reader never sees a half made segment as valid
+    std::atomic_thread_fence( std::memory_order_release );
+    memcpy( shared->magic, magic, sizeof(shared->magic) );
+}
+
+SharedVideo::~SharedVideo( void ) {
+    shared->closed.store( 1, std::memory_order_release );
+    munmap( shared, sizeof(SharedFrame) );
+    shm_unlink( name.c_str() );
+}
+
+int8_t* SharedVideo::beginFrame( void ) {
+    // odd: readers know the frame is being written
+    uint64_t sequence = shared->sequence.load( std::memory_order_relaxed );
+    if ( (sequence & 1) == 0 ) {
+        shared->sequence.store( sequence + 1, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_release );
+    }
+
+    return shared->frame;
+}
+
+void SharedVideo::showFrame( const int8_t* frame ) {
+    // from another CPU type (or a wrapper) which did not ask us where to put it
+    if ( frame != shared->frame )
+        memcpy( beginFrame(), frame, videoBytes );
+
+    shared->shownNanoseconds.store( monotonicNanoseconds(), std::memory_order_relaxed );
+
+    uint64_t sequence = shared->sequence.load( std::memory_order_relaxed );
+    shared->sequence.store( sequence + 1, std::memory_order_release );
+}
+
+uint64_t SharedVideo::getFrames( void ) {
+    return shared->sequence.load( std::memory_order_relaxed ) / 2;
+}
+
+// NULL with the reason in error if it is not there (yet)
+static const SharedFrame* mapShared( const std::string &name, std::string &error ) {
+    int fd = shm_open( name.c_str(), O_RDONLY, 0 );
+    if ( fd < 0 ) {
+        error = "There is no shared memory segment " + name;
+        return NULL;
+    }
+
+    struct stat info;
+    if ( (fstat( fd, &info ) != 0) || (info.st_size < static_cast<off_t>( sizeof(SharedFrame) )) ) {
+        close( fd );
+        error = name + " is not a shared video segment";
+        return NULL;
+    }
+
+    void* mapped = mmap( NULL, sizeof(SharedFrame), PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( mapped == MAP_FAILED ) {
+        error = "Could not map the shared memory segment " + name;
+        return NULL;
+    }
+
+    const SharedFrame* shared = static_cast<const SharedFrame*>( mapped );
+    if ( (memcmp( shared->magic, magic, sizeof(shared->magic) ) != 0) || (shared->width != videoWidth)
+            || (shared->height != videoHeight) ) {
+        munmap( mapped, sizeof(SharedFrame) );
+        error = name + " is not a shared video segment";
+        return NULL;
+    }
+
+    std::atomic_thread_fence( std::memory_order_acquire );
+    return shared;
+}
+
+SharedVideoReader::SharedVideoReader( const std::string &name ) {
+    std::string error;
+    shared = mapShared( name, error );
+    if ( shared == NULL )
+        errExit( error );
+}
+
+bool SharedVideoReader::isReady( const std::string &name ) {
+    std::string error;
+    const SharedFrame* shared = mapShared( name, error );
+    if ( shared == NULL )
+        return false;
+
+    munmap( const_cast<SharedFrame*>( shared ), sizeof(SharedFrame) );
+    return true;
+}
+
+SharedVideoReader::~SharedVideoReader( void ) {
+    munmap( const_cast<SharedFrame*>( shared ), sizeof(SharedFrame) );
+}
+
+const SharedFrame& SharedVideoReader::get( void ) {
+    return *shared;
+}
+
+// read the last finished frame with read (which must not keep any of it until it is known to be
+//      finished) until it was not changed while it was being read
+const unsigned int SharedVideoReader::maxWriteMilliseconds;
+
+static bool writerAlive( const SharedFrame* shared ) {
+    // EPERM means there is a process but it belongs to someone else
+    return (kill( shared->writerPid, 0 ) == 0) || (errno == EPERM);
+}
+
+template <typename Read>
+static uint64_t readFrame( const SharedFrame* shared, int64_t &shownNanoseconds, Read read ) {
+    bool waiting = false;
+    std::chrono::steady_clock::time_point giveUp;
+
+    while ( true ) {
+        uint64_t before = shared->sequence.load( std::memory_order_acquire );
+        if ( before & 1 ) {
+            // being written. The writer gets a turn in case it is on the same core as us
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if ( !waiting ) {
+                waiting = true;
+                giveUp = now + std::chrono::milliseconds( SharedVideoReader::maxWriteMilliseconds );
+                if ( !writerAlive( shared ) )
+                    return 0;
+            } else if ( now > giveUp ) {
+                return 0;
+            }
+
+            std::this_thread::yield();
+            continue;
+        }
+
+        if ( before == 0 )
+            return 0;
+
+        read( shared->frame );
+        shownNanoseconds = shared->shownNanoseconds.load( std::memory_order_relaxed );
+
+        std::atomic_thread_fence( std::memory_order_acquire );
+        if ( shared->sequence.load( std::memory_order_relaxed ) == before )
+            return before / 2;
+    }
+}
+
+uint64_t SharedVideoReader::copyFrame( int8_t* frame, int64_t &shownNanoseconds ) {
+    // a copy made while the frame was being written is copied over again
+    return readFrame( shared, shownNanoseconds,
+            [frame]( const int8_t* inPlace ) { memcpy( frame, inPlace, videoBytes ); } );
+}
+
+uint64_t SharedVideoReader::hashFrame( uint64_t &hash, int64_t &shownNanoseconds ) {
+    return readFrame( shared, shownNanoseconds,
+            [&hash]( const int8_t* inPlace ) { hash = ::hashFrame( inPlace ); } );
+}
+
+uint64_t SharedVideoReader::getFrames( void ) {
+    return shared->sequence.load( std::memory_order_acquire ) / 2;
+}
+
+bool SharedVideoReader::isClosed( void ) {
+    return shared->closed.load( std::memory_order_acquire ) != 0;
+}
+
+bool SharedVideoReader::isWriterAlive( void ) {
+    return writerAlive( shared );
+}
@@ -0,0 +1,108 @@
+// a VideoOutput which puts each frame in a POSIX shared memory segment, so that other processes on
+//      the same machine can map it and read the frames where they are, without a pipe or the terminal
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef SHARED_VIDEO_H
+#define SHARED_VIDEO_H
+
+#include "Video.h"
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+// the layout of the segment. A reader maps it read only (see SharedVideoReader)
+// sequence is a sequence lock: it is odd while a frame is being written and 2n once n frames have
+//      been finished. A reader takes sequence (with acquire ordering), reads frame and shownNanoseconds,
+//      then checks that sequence has not changed. If it has the frame was being written and should be
+//      read again
+// if the writer dies part way through a frame sequence stays odd, so readers should give up on it
+//      (see SharedVideoReader::maxWriteMilliseconds) instead of waiting for ever
+struct SharedFrame {
+    char magic[8];  // "CPUSHM01"
+    uint32_t width;
+    uint32_t height;
+    int32_t writerPid; // so readers can tell whether the writer is still running
+    std::atomic<uint64_t> sequence;
+    std::atomic<int64_t> shownNanoseconds; // CLOCK_MONOTONIC when the last frame was finished
+    std::atomic<uint32_t> closed;          // set once the writer has gone
+    int8_t frame[ videoBytes ];
+};
+
+// the frame is written straight into the segment: printBuffer copies the video memory there itself
+//      (see beginFrame), so there is no other copy of it
+// the segment is removed by the destructor. Readers which already have it mapped keep it until
+//      they unmap it and see closed set
+class SharedVideo : public VideoOutput {
+    private:
+        std::string name;
+        SharedFrame* shared;
+
+        SharedVideo( const SharedVideo& );
+        SharedVideo& operator=( const SharedVideo& );
+
+    public:
+        // name is as for shm_open, e.g. "/cpuEmulator". errExit's if the segment can't be made
+        explicit SharedVideo( const std::string &name );
+        ~SharedVideo( void );
+
+        int8_t* beginFrame( void );
+        void showFrame( const int8_t* frame );
+
+        uint64_t getFrames( void );
+};
+
+// maps a segment made by SharedVideo in another process (or this one)
+class SharedVideoReader {
+    private:
+        const SharedFrame* shared;
+
+        SharedVideoReader( const SharedVideoReader& );
+        SharedVideoReader& operator=( const SharedVideoReader& );
+
+    public:
+        // errExit's if there is no such segment or it was not made by SharedVideo
+        explicit SharedVideoReader( const std::string &name );
+        ~SharedVideoReader( void );
+
+        // whether the segment is there to be read yet, for waiting for the writer to start
+        static bool isReady( const std::string &name );
+
+        // the segment as it is mapped, to be read in place following the sequence lock
+        const SharedFrame& get( void );
+
+        // a frame takes no more than a memcpy to write, so one which has been being written for this
+        //      long has either been abandoned or its writer is not being run. isWriterAlive tells which
+        static const unsigned int maxWriteMilliseconds = 100;
+
+        // copy the last finished frame into frame and return its number, counting from 1. 0 if no
+        //      frame has been shown yet, or if a frame is being written and the writer has died or
+        //      taken more than maxWriteMilliseconds over it. frame may have been written over then
+        uint64_t copyFrame( int8_t* frame, int64_t &shownNanoseconds );
+
+        // the same but the frame is hashed (as hashFrame does) where it is instead of being copied
+        uint64_t hashFrame( uint64_t &hash, int64_t &shownNanoseconds );
+
+        // the number of frames finished so far, without waiting
+        uint64_t getFrames( void );
+        bool isClosed( void );
+
+        // false if the writer has gone without closing the segment (it crashed or was killed)
+        bool isWriterAlive( void );
+};
+
+// CLOCK_MONOTONIC in nanoseconds, the same in every process so that a reader can tell how long ago a
+//      frame was shown
+int64_t monotonicNanoseconds( void );
+
+#endif
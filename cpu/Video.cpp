@@ -0,0 +1,261 @@
+// sending the video frame buffer to the terminal. See header file
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "Video.h"
+#include "../emulator/debug.h"
+#include "../emulator/Hash.h"
+#include <algorithm>
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static_assert( videoWidth == 64, "a row of changed cells is kept in a uint64_t" );
+
+// a cursor move costs up to 8 bytes, so gaps of unchanged cells shorter than this are drawn over
+//      instead of being jumped
+static const unsigned int maxGap = 6;
+
+// bit x is set if row[x] is not the same as screenRow[x]
+static uint64_t changedCells( const int8_t* row, const int8_t* screenRow ) {
+    uint64_t changed = 0;
+
+    #ifdef __SSE2__
+    for ( unsigned int x = 0; x < videoWidth; x += 16 ) {
+        __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( row + x ) );
+        __m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( screenRow + x ) );
+        uint32_t same = _mm_movemask_epi8( _mm_cmpeq_epi8( a, b ) );
+        changed |= static_cast<uint64_t>( ~same & 0xFFFF ) << x;
+    }
+    #else
+    for ( unsigned int x = 0; x < videoWidth; x++ ) {
+        if ( row[x] != screenRow[x] )
+            changed |= UINT64_C(1) << x;
+    }
+    #endif
+
+    return changed;
+}
+
+static char* appendString( char* out, const char* string ) {
+    while ( *string )
+        *out++ = *string++;
+
+    return out;
+}
+
+static char* appendNumber( char* out, unsigned int number ) {
+    char digits[ 10 ];
+    unsigned int count = 0;
+
+    do {
+        digits[ count++ ] = '0' + number % 10;
+        number /= 10;
+    } while ( number );
+
+    while ( count )
+        *out++ = digits[ --count ];
+
+    return out;
+}
+
+// ESC [ row ; column H, counting from 1
+static char* appendMove( char* out, unsigned int y, unsigned int x ) {
+    out = appendString( out, "\x1b[" );
+    out = appendNumber( out, y + 1 );
+    *out++ = ';';
+    out = appendNumber( out, x + 1 );
+    *out++ = 'H';
+    return out;
+}
+
+TerminalVideo::TerminalVideo( int fd ) : fd( fd ), drawn( false ), frames( 0 ), bytesWritten( 0 ) {}
+
+void TerminalVideo::showFrame( const int8_t* frame ) {
+    std::lock_guard<std::mutex> guard( lock );
+
+    char* out = buffer;
+    if ( !drawn )
+        out = appendString( out, "\x1b[H\x1b[2J" ); // cursor to the top left and clear the screen
+
+    const uint64_t shown = ( UINT64_C(1) << terminalColumns ) - 1;
+
+    for ( unsigned int y = 0; y < videoHeight; y++ ) {
+        const int8_t* row = frame + videoWidth * y;
+        int8_t* screenRow = screen + videoWidth * y;
+
+        uint64_t changed = drawn ? changedCells( row, screenRow ) & shown : shown;
+
+        while ( changed ) {
+            unsigned int first = __builtin_ctzll( changed );
+
+            // carry on over short gaps of cells which have not changed
+            unsigned int end = first + 1;
+            uint64_t rest = changed >> end;
+            while ( rest ) {
+                unsigned int gap = __builtin_ctzll( rest );
+                if ( gap > maxGap )
+                    break;
+
+                end += gap + 1;
+                rest >>= gap + 1;
+            }
+
+            out = appendMove( out, y, first );
+            for ( unsigned int x = first; x < end; x++ ) {
+                char c = static_cast<char>( row[x] );
+                *out++ = ( (c >= ' ') && (c != 0x7F) ) ? c : ' ';
+            }
+
+            changed = ( end < 64 ) ? changed & ~( (UINT64_C(1) << end) - 1 ) : 0;
+        }
+
+        memcpy( screenRow, row, videoWidth );
+    }
+
+    drawn = true;
+    frames++;
+
+    // nothing has changed so there is nothing to write
+    if ( out == buffer )
+        return;
+
+    // leave the cursor under the frame so that anything else printed does not go over it
+    out = appendMove( out, videoHeight, 0 );
+
+    const char* next = buffer;
+    while ( next < out ) {
+        ssize_t written = write( fd, next, out - next );
+        if ( written < 0 ) {
+            if ( errno == EINTR )
+                continue;
+
+            debug( "TerminalVideo: could not write a frame" );
+            return;
+        }
+
+        next += written;
+        bytesWritten += written;
+    }
+}
+
+void TerminalVideo::redraw( void ) {
+    std::lock_guard<std::mutex> guard( lock );
+    drawn = false;
+}
+
+uint64_t TerminalVideo::getFrames( void ) {
+    std::lock_guard<std::mutex> guard( lock );
+    return frames;
+}
+
+uint64_t TerminalVideo::getBytesWritten( void ) {
+    std::lock_guard<std::mutex> guard( lock );
+    return bytesWritten;
+}
+
+uint64_t hashFrame( const int8_t* frame ) {
+    return fnv1aWords( frame, videoBytes );
+}
+
+NullVideo::NullVideo( void ) : frames( 0 ) {}
+
+void NullVideo::showFrame( const int8_t* frame ) {
+    (void) frame;
+    frames++;
+}
+
+uint64_t NullVideo::getFrames( void ) {
+    return frames;
+}
+
+FrameHashLog::FrameHashLog( size_t expectedFrames ) {
+    hashes.reserve( expectedFrames );
+}
+
+void FrameHashLog::showFrame( const int8_t* frame ) {
+    hashes.push_back( hashFrame( frame ) );
+}
+
+const std::vector<uint64_t>& FrameHashLog::getHashes( void ) {
+    return hashes;
+}
+
+void FrameHashLog::clear( void ) {
+    hashes.clear();
+}
+
+size_t FrameHashLog::firstDifference( const std::vector<uint64_t> &golden ) {
+    for ( size_t i = 0; i < hashes.size() && i < golden.size(); i++ ) {
+        if ( hashes[i] != golden[i] )
+            return i;
+    }
+
+    if ( hashes.size() != golden.size() )
+        return std::min( hashes.size(), golden.size() );
+
+    return npos;
+}
+
+void writeFrameHashes( const std::string &path, const std::vector<uint64_t> &hashes ) {
+    std::ofstream file( path.c_str() );
+    if ( !file )
+        errExit( "Could not open " + path + " to write frame hashes" );
+
+    for ( size_t i = 0; i < hashes.size(); i++ ) {
+        char line[ 17 ];
+        snprintf( line, sizeof(line), "%016llx", (unsigned long long) hashes[i] );
+        file << line << '\n';
+    }
+
+    if ( !file )
+        errExit( "Could not write the frame hashes " + path );
+}
+
+std::vector<uint64_t> readFrameHashes( const std::string &path ) {
+    std::ifstream file( path.c_str() );
+    if ( !file )
+        errExit( "Could not open the frame hashes " + path );
+
+    std::vector<uint64_t> hashes;
+    std::string line;
+    while ( std::getline( file, line ) ) {
+        if ( line.empty() )
+            continue;
+
+        char* end;
+        unsigned long long hash = strtoull( line.c_str(), &end, 16 );
+        if ( (end == line.c_str()) || ((*end != '\0') && (*end != '\r')) )
+            errExit( path + " is not a list of frame hashes" );
+
+        hashes.push_back( hash );
+    }
+
+    return hashes;
+}
+
+void printFrame( const int8_t* frame ) {
+    terminalVideo().showFrame( frame );
+}
+
+VideoOutput& terminalVideo( void ) {
+    static TerminalVideo video;
+    return video;
+}
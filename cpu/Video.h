@@ -0,0 +1,131 @@
+// the video frame buffer and sending it to the console
+// The frame buffer is just ASCII: 64x64 characters. It is the top 4096 bytes of the address space.
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef VIDEO_H
+#define VIDEO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+const unsigned int videoWidth = 64;
+const unsigned int videoHeight = 64;
+const unsigned int videoBytes = videoWidth * videoHeight;
+
+// the columns of each row which are shown on the terminal. The rest have never been shown
+const unsigned int terminalColumns = 60;
+
+// send a frame (videoBytes characters, one row after another) to stdout with terminalVideo()
+void printFrame( const int8_t* frame );
+
+// where printBuffer sends frames. Every CPU has its own, so CPUs running at the same time in
+//      different threads do not have to share the terminal
+class VideoOutput {
+    public:
+        virtual ~VideoOutput( void ) {}
+
+        // frame is videoBytes characters, one row after another. It is only valid during the call
+        virtual void showFrame( const int8_t* frame ) = 0;
+
+        // where printBuffer should put the next frame, for an output which keeps its frame somewhere
+        //      of its own. The frame is put there and then passed to showFrame. NULL (the default)
+        //      if it should be put anywhere
+        virtual int8_t* beginFrame( void ) { return NULL; }
+};
+
+// draws frames on an ANSI terminal. The frame on the screen is remembered so that only the cells
+//      which have changed are drawn: a cursor move and then the changed characters for each run of
+//      them. Everything for one frame goes in a single write, so frames from different threads
+//      are never mixed up. Control characters are drawn as spaces so they cannot move the cursor
+class TerminalVideo : public VideoOutput {
+    public:
+        // the longest a frame can be: clearing the screen, then every row in runs of one character
+        //      separated by the shortest gap which is not drawn over, then moving the cursor below
+        static const unsigned int maxFrameBytes = 16 + videoHeight * (terminalColumns * 10) + 16;
+
+    private:
+        int fd;
+
+        std::mutex lock;
+        bool drawn; // false until the first frame, which is drawn on a cleared screen
+        int8_t screen[ videoBytes ];
+        char buffer[ maxFrameBytes ];
+
+        uint64_t frames;
+        uint64_t bytesWritten;
+
+        TerminalVideo( const TerminalVideo& );
+        TerminalVideo& operator=( const TerminalVideo& );
+
+    public:
+        // frames are written to fd (stdout by default), which is not closed by us
+        explicit TerminalVideo( int fd = 1 );
+
+        void showFrame( const int8_t* frame );
+
+        // the next frame is drawn in full, for when something else has written on the terminal
+        void redraw( void );
+
+        uint64_t getFrames( void );
+        uint64_t getBytesWritten( void );
+};
+
+// shows nothing. The frames are only counted, for running a program where nobody is watching
+class NullVideo : public VideoOutput {
+    private:
+        uint64_t frames;
+
+    public:
+        NullVideo( void );
+
+        void showFrame( const int8_t* frame );
+
+        uint64_t getFrames( void );
+};
+
+// shows nothing. Instead a hash of each frame (all videoBytes of it) is added to a log, so that a
+//      run can be checked against the frames from a run which was known to be right
+class FrameHashLog : public VideoOutput {
+    private:
+        std::vector<uint64_t> hashes;
+
+    public:
+        // room is made for expectedFrames so that the log does not grow while the CPU runs
+        explicit FrameHashLog( size_t expectedFrames = 0 );
+
+        void showFrame( const int8_t* frame );
+
+        const std::vector<uint64_t>& getHashes( void );
+        void clear( void );
+
+        // the number of the first frame which is not the same as in golden, counting frames missing
+        //      from either log as different. npos if they are all the same
+        static const size_t npos = static_cast<size_t>( -1 );
+        size_t firstDifference( const std::vector<uint64_t> &golden );
+};
+
+// hash of one frame as FrameHashLog works it out
+uint64_t hashFrame( const int8_t* frame );
+
+// frame hashes in a text file, one hexadecimal hash per line
+void writeFrameHashes( const std::string &path, const std::vector<uint64_t> &hashes );
+std::vector<uint64_t> readFrameHashes( const std::string &path );
+
+// the TerminalVideo every CPU starts with
+VideoOutput& terminalVideo( void );
+
+#endif
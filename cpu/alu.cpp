@@ -16,7 +16,8 @@
 #include "alu.h"
 #include "../emulator/debug.h"
 
-void ALU::setFlags( void ) {
+template <typename Checking>
+void BasicALU<Checking>::setFlags( void ) {
     int32_t val = result.getValue();
     
     // defining 0 as positive so that "branch less than" is a less than and not a less than or equal to
@@ -31,7 +32,8 @@ void ALU::setFlags( void ) {
         zeroFlag.setValue( false );
 }
 
-void ALU::updateOutputs( void ) {
+template <typename Checking>
+void BasicALU<Checking>::updateOutputs( void ) {
     if ( !upToDate ) {
         if ( A.isUndefined() || B.isUndefined() || control.isUndefined() ) {
             // not all inputs set
@@ -67,26 +69,31 @@ void ALU::updateOutputs( void ) {
     upToDate = true;
 }
 
-ALU::ALU( void ) {
+template <typename Checking>
+BasicALU<Checking>::BasicALU( void ) {
     upToDate = false;
 }
 
-void ALU::setControl( AluOps controlIn ) {
+template <typename Checking>
+void BasicALU<Checking>::setControl( AluOps controlIn ) {
     upToDate = false;
     control.setValue( controlIn );
 }
 
-void ALU::setA( int32_t Aval ) {
+template <typename Checking>
+void BasicALU<Checking>::setA( int32_t Aval ) {
     upToDate = false;
     A.setValue( Aval );
 }
 
-void ALU::setB( int32_t Bval ) {
+template <typename Checking>
+void BasicALU<Checking>::setB( int32_t Bval ) {
     upToDate = false;
     B.setValue( Bval );
 }
 
-void ALU::undefine( void ) {
+template <typename Checking>
+void BasicALU<Checking>::undefine( void ) {
     upToDate = false;
     control.undefine();
     A.undefine();
@@ -96,17 +103,23 @@ void ALU::undefine( void ) {
     positive.undefine();
 }
 
-int32_t ALU::getResult( void ) {
+template <typename Checking>
+int32_t BasicALU<Checking>::getResult( void ) {
     updateOutputs();
     return result.getValue();
 }
 
-bool ALU::getZeroFlag( void ) {
+template <typename Checking>
+bool BasicALU<Checking>::getZeroFlag( void ) {
     updateOutputs();
     return zeroFlag.getValue();
 }
 
-bool ALU::getPositiveFlag( void ) {
+template <typename Checking>
+bool BasicALU<Checking>::getPositiveFlag( void ) {
     updateOutputs();
     return positive.getValue();
 }
+
+template class BasicALU<Checked>;
+template class BasicALU<Unchecked>;
@@ -29,28 +29,32 @@
 #define ALU_H
 
 #include "../emulator/Signal.h"
+#include "../emulator/CombinationalSignal.h"
 #include <stdint.h>
 #include "aluOps.h"
 
-class ALU {
+// the members are defined in alu.cpp, which instantiates this for Checked and Unchecked
+template <typename Checking>
+class BasicALU {
     private:
-        Signal<AluOps> control;
-        Signal<int32_t> A;
-        Signal<int32_t> B;
+        CombinationalSignal<AluOps, Checking> control;
+        CombinationalSignal<int32_t, Checking> A;
+        CombinationalSignal<int32_t, Checking> B;
         
-        Signal<int32_t> result;
-        Signal<bool> zeroFlag;
-        Signal<bool> positive;
+        CombinationalSignal<int32_t, Checking> result;
+        CombinationalSignal<bool, Checking> zeroFlag;
+        CombinationalSignal<bool, Checking> positive;
 
         // combinational logic
         void setFlags( void );
         void updateOutputs( void );
 
         // have we already calculated the value of the outputs since the last change in inpus
+        // this can stay true over a clock tick: the outputs it refers to are undefined by then anyway
         bool upToDate;
 
     public:
-        ALU( void );
+        BasicALU( void );
         void setControl( AluOps controlIn );
         void setA( int32_t Aval );
         void setB( int32_t Bval );
@@ -61,4 +65,6 @@ class ALU {
         bool getPositiveFlag( void );
 };
 
+typedef BasicALU<DefaultChecking> ALU;
+
 #endif
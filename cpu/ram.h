@@ -24,60 +24,454 @@
 #ifndef RAM_H
 #define RAM_H
 
-#include "../emulator/Register.h"
 #include "../emulator/Signal.h"
 #include "../emulator/debug.h"
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
 #include <vector>
+#include <memory>
+#include <atomic>
 
 #include <endian.h>
 
-template <typename AddressType, unsigned int numBytes>
-class RAM {
+// the memory cells are kept in pages. A page which has not been written is shared with every other
+//      RAM started from the same RAMImage. The RAM also keeps track of which pages have been written
+//      so that snapshots can copy only those
+#define RAM_PAGE_BYTES 256
+
+// each page starts on a cache line
+#define RAM_ALIGNMENT 64
+
+// the contents of one page. Bit (i % 64) of defined[i / 64] is set once byte i has been written
+struct alignas(RAM_ALIGNMENT) RAMPage {
+    int8_t cells[RAM_PAGE_BYTES];
+    uint64_t defined[RAM_PAGE_BYTES / 64];
+};
+
+// memory for count pages, one after another. new does not have to keep to alignas before C++17, so
+//      RAMs and RAMImages get their pages from here. Give them back with free
+inline RAMPage* allocatePages( unsigned int count ) {
+    void* allocated;
+    if ( posix_memalign( &allocated, RAM_ALIGNMENT, count * sizeof(RAMPage) ) != 0 )
+        errExit( "RAM: could not allocate memory pages" );
+
+    return static_cast<RAMPage*>( allocated );
+}
+
+// a RAM as plain data. Bit (i % 64) of defined[i / 64] is set if byte i has been written
+// output is what was read on the last clock tick. A write never waits in between clock ticks so
+//      there is nothing else to save
+// imageId is the RAMImage of the RAM which saved the state. Bit (i % 64) of imagePages[i / 64] is set
+//      if page i is still the same as in that image, so restoring it only has to share the page again
+template <unsigned int numBytes> struct RAMState {
+    int8_t cells[numBytes];
+    uint64_t defined[ (numBytes + 63) / 64 ];
+    SignalState<int32_t> output;
+    uint64_t imageId;
+    uint64_t imagePages[ ((numBytes + RAM_PAGE_BYTES - 1) / RAM_PAGE_BYTES + 63) / 64 ];
+};
+
+// copy page number page between a RAMState and a RAMPage. The last page may be cut short
+template <unsigned int numBytes>
+void readPage( const RAMState<numBytes> &state, unsigned int page, RAMPage &out ) {
+    unsigned int start = page * RAM_PAGE_BYTES;
+    unsigned int length = numBytes - start < RAM_PAGE_BYTES ? numBytes - start : RAM_PAGE_BYTES;
+    unsigned int words = (length + 63) / 64;
+
+    memcpy( out.cells, state.cells + start, length );
+    memcpy( out.defined, state.defined + start / 64, words * sizeof(uint64_t) );
+}
+
+template <unsigned int numBytes>
+void writePage( RAMState<numBytes> &state, unsigned int page, const RAMPage &in ) {
+    unsigned int start = page * RAM_PAGE_BYTES;
+    unsigned int length = numBytes - start < RAM_PAGE_BYTES ? numBytes - start : RAM_PAGE_BYTES;
+    unsigned int words = (length + 63) / 64;
+
+    memcpy( state.cells + start, in.cells, length );
+    memcpy( state.defined + start / 64, in.defined, words * sizeof(uint64_t) );
+    state.imagePages[ page / 64 ] &= ~(UINT64_C(1) << (page % 64));
+}
+
+// what a RAM starts with. This never changes so any number of RAMs (in any number of threads) can
+//      share one. Make it with std::make_shared and give it to each RAM
+template <unsigned int numBytes>
+class RAMImage {
+    public:
+        static const unsigned int numPages = (numBytes + RAM_PAGE_BYTES - 1) / RAM_PAGE_BYTES;
+
     private:
-        Register<int8_t> data[numBytes]; // the ram will behave as a lot faster than real ram 
-        Signal<AddressType> addr;
-        Signal<bool> readingThisCycle;
-        Signal<int32_t> inoutData;
+        RAMPage* pages; // all of them in one allocation
+        uint64_t id;
+
+        RAMImage( const RAMImage& );
+        RAMImage& operator=( const RAMImage& );
 
     public:
-        // constructor to start the ram with some initial data
-        RAM( const std::vector<int32_t> &InitialData ) {
-            if ( InitialData.size() > (numBytes*sizeof(int32_t)) )
+        // initialData is copied in without changing the order of the bytes. The rest is zero
+        //      (and undefined)
+        RAMImage( const std::vector<int32_t> &initialData ) : id( nextId() ) {
+            if ( initialData.size() > (numBytes/sizeof(int32_t)) )
                 errExit( "Initial RAM data does not fit" );
 
-            unsigned int nextRamAddr = 0;
+            pages = allocatePages( numPages );
+            memset( pages, 0, numPages * sizeof(RAMPage) );
 
-            for ( unsigned i = 0; i != InitialData.size(); ++i) {
-                // for each instruction
-                int32_t fullObj = InitialData[i]; 
+            for ( unsigned int i = 0; i < initialData.size(); i++ ) {
+                unsigned int address = i * sizeof(int32_t);
+                RAMPage &page = pages[ address / RAM_PAGE_BYTES ];
+                unsigned int offset = address % RAM_PAGE_BYTES;
 
-                // copy data
-                for ( unsigned int j = 0; j < sizeof(int32_t); ++j ) 
-                    data[nextRamAddr+j].changeDriveSignal( ( (int8_t*) &fullObj )[j] );
-                
-                nextRamAddr += sizeof(int32_t);
+                memcpy( page.cells + offset, &initialData[i], sizeof(int32_t) );
+                page.defined[ offset / 64 ] |= UINT64_C(0xF) << (offset % 64);
             }
-            
-            // we need a clock tick so that the data can be written
-            clockTick();
+        }
+
+        ~RAMImage( void ) {
+            free( pages );
+        }
+
+        const RAMPage& page( unsigned int index ) const {
+            return pages[ index ];
+        }
+
+        // different for every image made by this process, even once an image has been freed
+        uint64_t getId( void ) const {
+            return id;
+        }
+
+    private:
+        static uint64_t nextId( void ) {
+            static std::atomic<uint64_t> count( 0 );
+            return ++count;
+        }
+};
+
+template <typename AddressType, unsigned int numBytes, typename Checking = DefaultChecking>
+class RAM {
+    public:
+        static const unsigned int numPages = RAMImage<numBytes>::numPages;
+
+    private:
+        // the memory cells. pages[i] is either page i of image or our own copy of it
+        // we only get our own copy of a page the first time it is written, so the memory used by
+        //      a RAM depends on how much of it has been written
+        // the ram will behave as a lot faster than real ram 
+        std::shared_ptr< const RAMImage<numBytes> > image;
+        const RAMPage* pages[ numPages ];
+        RAMPage* ownPages[ numPages ]; // NULL where we are still using the page from image
+
+        // pages we have finished with, kept so that reset does not have to free them only for them to
+        //      be allocated again by the next program
+        RAMPage* sparePages[ numPages ];
+        unsigned int numSpare;
+
+        // bit (i % 64) of dirty[i / 64] is set if page i has been written since the last time the
+        //      state was saved or restored. This is kept whatever the checking policy
+        uint64_t dirty[ (numPages + 63) / 64 ];
+
+        // the write which will be committed on the next clock tick
+        // this does the job of QNext in a Register
+        bool writePending;
+        AddressType pendingAddr;
+        int32_t pendingData;
+
+        Signal<AddressType, Checking> addr;
+        // always checked because whether it is defined says if we are doing anything this cycle
+        Signal<bool, Checked> readingThisCycle;
+        Signal<int32_t, Checking> inoutData;
+
+        // not copyable because we own our pages
+        RAM( const RAM& );
+        RAM& operator=( const RAM& );
+
+        // every byte zero and undefined
+        static std::shared_ptr< const RAMImage<numBytes> > emptyImage( void ) {
+            static std::shared_ptr< const RAMImage<numBytes> > empty =
+                std::make_shared< const RAMImage<numBytes> >( std::vector<int32_t>() );
+            return empty;
+        }
+
+        // start using newImage for every page
+        void share( const std::shared_ptr< const RAMImage<numBytes> > &newImage ) {
+            image = newImage;
+
+            for ( unsigned int i = 0; i < numPages; i++ ) {
+                if ( ownPages[i] )
+                    sharePage( i );
+                else
+                    pages[i] = &image->page( i );
+            }
+
+            addr.undefine();
+            readingThisCycle.undefine();
+            inoutData.undefine();
+            writePending = false;
+            memset( dirty, 0, sizeof(dirty) );
+        }
+
+        // write data to the start of memory as if it had been in the image
+        void load( const std::vector<int32_t> &data ) {
+            if ( data.size() > (numBytes/sizeof(int32_t)) )
+                errExit( "Initial RAM data does not fit" );
+
+            for ( unsigned int i = 0; i < data.size(); i++ )
+                writeWord( i * sizeof(int32_t), data[i] );
+
+            memset( dirty, 0, sizeof(dirty) );
+        }
+
+        // our own copy of page index, made now if we don't have one yet
+        RAMPage* writablePage( unsigned int index ) {
+            if ( !ownPages[ index ] ) {
+                if ( numSpare > 0 ) {
+                    ownPages[ index ] = sparePages[ --numSpare ];
+                    *ownPages[ index ] = *pages[ index ];
+                } else {
+                    ownPages[ index ] = allocatePages( 1 );
+                    *ownPages[ index ] = *pages[ index ];
+                }
+
+                pages[ index ] = ownPages[ index ];
+            }
+
+            return ownPages[ index ];
+        }
+
+        // go back to sharing page index with image
+        void sharePage( unsigned int index ) {
+            sparePages[ numSpare++ ] = ownPages[ index ];
+            ownPages[ index ] = NULL;
+            pages[ index ] = &image->page( index );
+        }
+
+        // reading a byte which has never been written is an error, just like reading an undefined Signal
+        // Unchecked RAM does not keep track
+        bool byteDefined( unsigned int index ) {
+            const RAMPage* page = pages[ index / RAM_PAGE_BYTES ];
+            unsigned int offset = index % RAM_PAGE_BYTES;
+
+            return page->defined[ offset / 64 ] & (UINT64_C(1) << (offset % 64));
+        }
+
+        // are all of the bytes starting at address defined?
+        bool wordDefined( AddressType address ) {
+            if ( !Checking::checking )
+                return true;
+
+            unsigned int index = address;
+
+            if ( (index % sizeof(int32_t)) == 0 ) {
+                // word aligned so all four bits are in the same uint64_t of the same page
+                const RAMPage* page = pages[ index / RAM_PAGE_BYTES ];
+                unsigned int offset = index % RAM_PAGE_BYTES;
+                uint64_t mask = UINT64_C(0xF) << (offset % 64);
+                return (page->defined[ offset / 64 ] & mask) == mask;
+            }
+
+            for ( unsigned int i = index; i < index + sizeof(int32_t); i++ ) {
+                if ( !byteDefined( i ) )
+                    return false;
+            }
+
+            return true;
+        }
+
+        // read the bytes at address as they are stored (without changing the endian-ness)
+        int32_t readWord( AddressType address ) {
+            if ( !wordDefined( address ) )
+                errExit( ErrorKind::undefinedValue, "RAM: reading undefined memory at address " + std::to_string( address ) );
+
+            unsigned int index = address;
+            unsigned int offset = index % RAM_PAGE_BYTES;
+            int32_t word;
+
+            // memcpy is turned into a single load by the compiler. It is also fine for unaligned addresses
+            if ( offset <= RAM_PAGE_BYTES - sizeof(int32_t) ) {
+                memcpy( &word, pages[ index / RAM_PAGE_BYTES ]->cells + offset, sizeof(int32_t) );
+                return word;
+            }
+
+            // over the end of a page
+            int8_t bytes[ sizeof(int32_t) ];
+            for ( unsigned int i = 0; i < sizeof(int32_t); i++ )
+                bytes[i] = pages[ (index + i) / RAM_PAGE_BYTES ]->cells[ (index + i) % RAM_PAGE_BYTES ];
+
+            memcpy( &word, bytes, sizeof(int32_t) );
+            return word;
+        }
+
+        // store the bytes of word at address without changing the endian-ness
+        void writeWord( AddressType address, int32_t word ) {
+            unsigned int index = address;
+            unsigned int offset = index % RAM_PAGE_BYTES;
+
+            if ( offset <= RAM_PAGE_BYTES - sizeof(int32_t) ) {
+                RAMPage* page = writablePage( index / RAM_PAGE_BYTES );
+                memcpy( page->cells + offset, &word, sizeof(int32_t) );
+
+                if ( Checking::checking ) {
+                    if ( (offset % sizeof(int32_t)) == 0 ) {
+                        page->defined[ offset / 64 ] |= UINT64_C(0xF) << (offset % 64);
+                    } else {
+                        for ( unsigned int i = offset; i < offset + sizeof(int32_t); i++ )
+                            page->defined[ i / 64 ] |= UINT64_C(1) << (i % 64);
+                    }
+                }
+
+                markPageDirty( index / RAM_PAGE_BYTES );
+                return;
+            }
+
+            // over the end of a page
+            int8_t bytes[ sizeof(int32_t) ];
+            memcpy( bytes, &word, sizeof(int32_t) );
+
+            for ( unsigned int i = index; i < index + sizeof(int32_t); i++ ) {
+                RAMPage* page = writablePage( i / RAM_PAGE_BYTES );
+                unsigned int byteOffset = i % RAM_PAGE_BYTES;
+
+                page->cells[ byteOffset ] = bytes[ i - index ];
+                if ( Checking::checking )
+                    page->defined[ byteOffset / 64 ] |= UINT64_C(1) << (byteOffset % 64);
+
+                markPageDirty( i / RAM_PAGE_BYTES );
+            }
+        }
+
+        void markPageDirty( unsigned int page ) {
+            dirty[ page / 64 ] |= UINT64_C(1) << (page % 64);
+        }
+
+        // copy page index into state. Unchecked RAM does not know what has been written so all of it
+        //      is saved as defined
+        void savePage( RAMState<numBytes> &state, unsigned int index ) {
+            writePage( state, index, *pages[ index ] );
+
+            if ( !ownPages[ index ] )
+                state.imagePages[ index / 64 ] |= UINT64_C(1) << (index % 64);
+
+            if ( !Checking::checking ) {
+                unsigned int start = index * RAM_PAGE_BYTES;
+                unsigned int length = numBytes - start < RAM_PAGE_BYTES ? numBytes - start : RAM_PAGE_BYTES;
+                memset( state.defined + start / 64, 0xFF, (length + 63) / 64 * sizeof(uint64_t) );
+            }
+        }
+
+    public:
+        // constructor to start the ram with some initial data. The pages with the data in are our own
+        RAM( const std::vector<int32_t> &InitialData ) : numSpare( 0 ) {
+            memset( ownPages, 0, sizeof(ownPages) );
+            reset( InitialData );
+        }
+
+        // start with the contents of image, which can be shared with other RAMs
+        RAM( const std::shared_ptr< const RAMImage<numBytes> > &image ) : numSpare( 0 ) {
+            memset( ownPages, 0, sizeof(ownPages) );
+            reset( image );
+        }
+
+        ~RAM( void ) {
+            for ( unsigned int i = 0; i < numPages; i++ )
+                free( ownPages[i] );
+
+            for ( unsigned int i = 0; i < numSpare; i++ )
+                free( sparePages[i] );
+        }
+
+        // start again as if we had just been constructed. The pages we have already got are reused,
+        //      so once a RAM has run a program it can run another like it without allocating anything
+        void reset( const std::vector<int32_t> &InitialData ) {
+            share( emptyImage() );
+            load( InitialData );
+        }
+
+        void reset( const std::shared_ptr< const RAMImage<numBytes> > &newImage ) {
+            share( newImage );
+        }
+
+        void saveState( RAMState<numBytes> &state ) {
+            state.imageId = image->getId();
+
+            for ( unsigned int i = 0; i < numPages; i++ )
+                savePage( state, i );
+
+            inoutData.saveState( state.output );
+            memset( dirty, 0, sizeof(dirty) );
+        }
+
+        // bring a state saved by saveState up to date, copying only the pages which have been written
+        //      since then. The numbers of the pages copied are added to pageNumbers, starting at firstPage
+        void saveDirtyState( RAMState<numBytes> &state, std::vector<unsigned int> &pageNumbers, unsigned int firstPage ) {
+            for ( unsigned int i = 0; i < (numPages + 63) / 64; i++ ) {
+                uint64_t bits = dirty[i];
+
+                while ( bits ) {
+                    unsigned int page = i * 64 + __builtin_ctzll( bits );
+                    bits &= bits - 1;
+
+                    savePage( state, page );
+                    pageNumbers.push_back( firstPage + page );
+                }
+            }
+
+            inoutData.saveState( state.output );
+            memset( dirty, 0, sizeof(dirty) );
+        }
+
+        // pages which were shared with our image when the state was saved are shared again. Only the
+        //      others are copied. A state saved by a RAM with a different image is copied in full
+        void restoreState( const RAMState<numBytes> &state ) {
+            bool sameImage = state.imageId == image->getId();
+
+            for ( unsigned int i = 0; i < numPages; i++ ) {
+                if ( sameImage && (state.imagePages[ i / 64 ] & (UINT64_C(1) << (i % 64))) ) {
+                    if ( ownPages[i] )
+                        sharePage( i );
+                } else {
+                    readPage( state, i, *writablePage( i ) );
+                }
+            }
+
+            inoutData.restoreState( state.output );
+            addr.undefine();
+            readingThisCycle.undefine();
+            writePending = false;
+            memset( dirty, 0, sizeof(dirty) );
+        }
+
+        // the number of pages we have our own copy of, rather than sharing with the image
+        unsigned int privatePages( void ) {
+            unsigned int count = 0;
+
+            for ( unsigned int i = 0; i < numPages; i++ ) {
+                if ( ownPages[i] )
+                    count++;
+            }
+
+            return count;
         }
 
         // not to be used in hardware modeling. This does a read in a C++ way
         int32_t debugRead( AddressType addr ) {
-            // read the data one byte at a time
-            int8_t readData[ sizeof( int32_t ) ];
+            return readWord( addr );
+        }
 
-            for ( size_t i = 0; i < sizeof( int32_t ); i++ ) {
-                readData[i] = data[ addr + i ].getOutput();
+        // every byte, a page at a time, whether it is defined or not
+        void copyOut( int8_t* dest ) {
+            for ( unsigned int i = 0; i < numPages; i++ ) {
+                unsigned int start = i * RAM_PAGE_BYTES;
+                unsigned int bytes = ( numBytes - start < RAM_PAGE_BYTES ) ? numBytes - start : RAM_PAGE_BYTES;
+                memcpy( dest + start, pages[i]->cells, bytes );
             }
-
-            return  *((int32_t*) &readData) ;
         }
 
         void setAddress( AddressType address ) {
-            if ( address > static_cast<AddressType>(numBytes-1) ) {
-                errExit( "RAM: specified address does not exist" );
+            // the cast makes negative addresses huge so that they are caught too
+            if ( static_cast<unsigned long long>(address) > numBytes - sizeof(int32_t) ) {
+                errExit( ErrorKind::badAddress, "RAM: specified address does not exist" );
             }
 
             addr.setValue( address );
@@ -100,31 +494,21 @@ class RAM {
                 if ( addr.isDefined() ) { // if we got all of our inputs for reading
                     if ( readingThisCycle.getValue() ) { // we are reading
                         // nobody can drive inoutData while we are
-                        if ( inoutData.isDefined() )
+                        if ( Checking::checking && inoutData.isDefined() )
                             errExit( "RAM and RAM input driving inOutData at the same time!" );
 
-                        // read the data one byte at a time
-                        int8_t readData[ sizeof( int32_t ) ];
-                        for ( size_t i = 0; i < sizeof( int32_t ); i++ ) {
-                            readData[i] = data[ addr.getValue() + i ].getOutput();
-                        }
-                        // interpret readData's bits as a int32_t
-                        // this breaks strict aliasing so this file must have
-                        // -fstrict-aliasing as a compiler option
-                        // an alternative would be to mess about with unions 
-                        inoutData.setValue( be32toh( *( (int32_t*) &readData ) ) );
+                        inoutData.setValue( be32toh( readWord( addr.getValue() ) ) );
 
                     } else { // writing
                         if ( inoutData.isDefined() ) { // we have all inputs for write
-                            // write one byte at a time
-                            // interpret the input's bits as an array of bytes
-                            int32_t inData = inoutData.getValue();
-                            int8_t* dataToWrite = (int8_t*) &inData; // treat as an array of int8_t
-                            for ( size_t i = 0; i < sizeof( int32_t ); i++ ) {
-                                data[ addr.getValue() + i ].changeDriveSignal( dataToWrite[i] );
-                            }
+                            // the write happens at the end of the clock tick
+                            writePending = true;
+                            pendingAddr = addr.getValue();
+                            pendingData = inoutData.getValue();
 
+                            #ifdef SIGNAL_DEBUG
                             debugSignal( "ram at address " + std::to_string(addr.getValue()), inoutData.getValue());
+                            #endif
 
                             // outData should not remember it's value
                             inoutData.undefine();
@@ -145,8 +529,11 @@ class RAM {
             readingThisCycle.undefine();
             
             // clock tick for memory cells
-            for (unsigned int i = 0; i < (numBytes-1); i++)
-                data[i].clockTick();
+            // only the cells which were written this cycle can change
+            if ( writePending ) {
+                writeWord( pendingAddr, pendingData );
+                writePending = false;
+            }
         }
 };
 
@@ -0,0 +1,291 @@
+// runs the cycle accurate CPU forwards and backwards (see ReverseDebugger.h)
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "ReverseDebugger.h"
+#include "../emulator/debug.h"
+#include <string.h>
+
+using namespace std;
+
+template <typename Checking>
+BasicReverseDebugger<Checking>::BasicReverseDebugger( BasicCPU<Checking> &cpu, uint64_t interval, size_t maxBytes )
+        : cpu( cpu ), interval( interval ), maxBytes( maxBytes ),
+          oldest( new CPUState ), newest( new CPUState ), scratch( new CPUState ), deltaBytes( 0 ),
+          pageWanted( ramAddrTranPages<ramBytes>(), false ) {
+    if ( interval == 0 )
+        errExit( "ReverseDebugger: the interval between snapshots must be at least one cycle" );
+
+    memset( &stats, 0, sizeof(stats) );
+
+    cpu.snapshot( *oldest );
+    memcpy( newest.get(), oldest.get(), sizeof(CPUState) );
+}
+
+template <typename Checking>
+unsigned int BasicReverseDebugger<Checking>::numSnapshots( void ) {
+    return deltas.size() + 1;
+}
+
+template <typename Checking>
+uint64_t BasicReverseDebugger<Checking>::snapshotCycle( unsigned int index ) {
+    if ( index == 0 )
+        return oldest->core.cycleCount;
+
+    return deltas[ index - 1 ].core.cycleCount;
+}
+
+template <typename Checking>
+size_t BasicReverseDebugger<Checking>::deltaSize( const Delta &delta ) {
+    return sizeof(Delta) + delta.pages.capacity() * sizeof(unsigned int) + delta.contents.capacity() * sizeof(RAMPage);
+}
+
+template <typename Checking>
+void BasicReverseDebugger<Checking>::takeSnapshot( void ) {
+    dirtyPages.clear();
+    cpu.snapshotDirty( *newest, dirtyPages );
+
+    deltas.push_back( Delta() );
+    Delta &delta = deltas.back();
+
+    delta.core = newest->core;
+    readOutputs( newest->ram, delta.outputs );
+
+    delta.pages = dirtyPages;
+    delta.contents.resize( dirtyPages.size() );
+    for ( unsigned int i = 0; i < dirtyPages.size(); i++ )
+        readPage( newest->ram, dirtyPages[i], delta.contents[i] );
+
+    deltaBytes += deltaSize( delta );
+    stats.snapshotsTaken++;
+    stats.pagesSaved += dirtyPages.size();
+
+    while ( (deltaBytes > maxBytes) && !deltas.empty() )
+        mergeOldest();
+}
+
+template <typename Checking>
+void BasicReverseDebugger<Checking>::applyDelta( CPUState &state, const Delta &delta ) {
+    for ( unsigned int i = 0; i < delta.pages.size(); i++ )
+        writePage( state.ram, delta.pages[i], delta.contents[i] );
+
+    writeOutputs( state.ram, delta.outputs );
+    state.core = delta.core;
+}
+
+template <typename Checking>
+void BasicReverseDebugger<Checking>::mergeOldest( void ) {
+    applyDelta( *oldest, deltas.front() );
+
+    deltaBytes -= deltaSize( deltas.front() );
+    deltas.pop_front();
+    stats.merged++;
+}
+
+template <typename Checking>
+void BasicReverseDebugger<Checking>::load( unsigned int index ) {
+    if ( index == numSnapshots() - 1 ) {
+        cpu.restore( *newest );
+        return;
+    }
+
+    // start from the newest snapshot. Only the pages written since snapshot index are different.
+    //      Usually we are going back to one of the last few snapshots, so there are not many of them
+    memcpy( scratch.get(), newest.get(), sizeof(CPUState) );
+
+    unsigned int missing = 0;
+    for ( unsigned int i = index; i < deltas.size(); i++ ) {
+        for ( unsigned int j = 0; j < deltas[i].pages.size(); j++ ) {
+            if ( !pageWanted[ deltas[i].pages[j] ] ) {
+                pageWanted[ deltas[i].pages[j] ] = true;
+                missing++;
+            }
+        }
+    }
+
+    // each of them is as it was in the last snapshot up to index which has it, or the oldest
+    for ( int i = index - 1; (i >= 0) && (missing > 0); i-- ) {
+        for ( unsigned int j = 0; j < deltas[i].pages.size(); j++ ) {
+            unsigned int page = deltas[i].pages[j];
+
+            if ( pageWanted[ page ] ) {
+                writePage( scratch->ram, page, deltas[i].contents[j] );
+                pageWanted[ page ] = false;
+                missing--;
+            }
+        }
+    }
+
+    RAMPage contents;
+    for ( unsigned int page = 0; (page < pageWanted.size()) && (missing > 0); page++ ) {
+        if ( pageWanted[ page ] ) {
+            readPage( oldest->ram, page, contents );
+            writePage( scratch->ram, page, contents );
+            pageWanted[ page ] = false;
+            missing--;
+        }
+    }
+
+    if ( index == 0 ) {
+        scratch->core = oldest->core;
+        RamAddrTranOutputs outputs;
+        readOutputs( oldest->ram, outputs );
+        writeOutputs( scratch->ram, outputs );
+    } else {
+        scratch->core = deltas[ index - 1 ].core;
+        writeOutputs( scratch->ram, deltas[ index - 1 ].outputs );
+    }
+
+    cpu.restore( *scratch );
+}
+
+template <typename Checking>
+void BasicReverseDebugger<Checking>::goTo( unsigned int index, uint64_t cycle ) {
+    load( index );
+
+    // the CPU is now the same as snapshot index, so that has to be the newest one
+    if ( index != numSnapshots() - 1 ) {
+        memcpy( newest.get(), scratch.get(), sizeof(CPUState) );
+
+        while ( deltas.size() > index ) {
+            deltaBytes -= deltaSize( deltas.back() );
+            deltas.pop_back();
+        }
+    }
+
+    VideoOutput &video = cpu.getVideoOutput();
+    cpu.setVideoOutput( nullVideo );
+
+    while ( cpu.getCycleCount() < cycle ) {
+        stats.cyclesReplayed++;
+
+        if ( cpu.clockTick() )
+            break;
+    }
+
+    cpu.setVideoOutput( video );
+}
+
+template <typename Checking>
+bool BasicReverseDebugger<Checking>::reverseToInstruction( int32_t breakpoint ) {
+    // so that we can come back here if there is nothing to find
+    if ( snapshotCycle( numSnapshots() - 1 ) != cpu.getCycleCount() )
+        takeSnapshot();
+
+    VideoOutput &video = cpu.getVideoOutput();
+    cpu.setVideoOutput( nullVideo );
+
+    // look through the time between each snapshot and the next, newest first
+    for ( int index = numSnapshots() - 2; index >= 0; index-- ) {
+        uint64_t end = snapshotCycle( index + 1 );
+        bool found = false;
+        uint64_t foundCycle = 0;
+
+        load( index );
+
+        while ( true ) {
+            if ( (cpu.getControlUnitState() == ControlUnitStateEnum::Fetch) &&
+                    ((breakpoint == anyInstruction) || (cpu.getProgramCounter() == breakpoint)) ) {
+                found = true;
+                foundCycle = cpu.getCycleCount();
+            }
+
+            // end is the start of the next snapshot, which we have already looked at
+            if ( cpu.getCycleCount() + 1 >= end )
+                break;
+
+            stats.cyclesReplayed++;
+            if ( cpu.clockTick() )
+                break;
+        }
+
+        if ( found ) {
+            cpu.setVideoOutput( video );
+            goTo( index, foundCycle );
+            return true;
+        }
+    }
+
+    load( numSnapshots() - 1 );
+    cpu.setVideoOutput( video );
+    return false;
+}
+
+template <typename Checking>
+bool BasicReverseDebugger<Checking>::step( void ) {
+    bool halted = cpu.clockTick();
+
+    if ( cpu.getCycleCount() >= snapshotCycle( numSnapshots() - 1 ) + interval )
+        takeSnapshot();
+
+    return halted;
+}
+
+template <typename Checking>
+bool BasicReverseDebugger<Checking>::stepInstruction( void ) {
+    do {
+        if ( step() )
+            return true;
+    } while ( cpu.getControlUnitState() != ControlUnitStateEnum::Fetch );
+
+    return false;
+}
+
+template <typename Checking>
+bool BasicReverseDebugger<Checking>::run( uint64_t maxCycles ) {
+    for ( uint64_t i = 0; i < maxCycles; i++ ) {
+        if ( step() )
+            return true;
+    }
+
+    return false;
+}
+
+template <typename Checking>
+bool BasicReverseDebugger<Checking>::reverseStep( void ) {
+    return reverseToInstruction( anyInstruction );
+}
+
+template <typename Checking>
+bool BasicReverseDebugger<Checking>::reverseStepCycles( uint64_t cycles ) {
+    uint64_t now = cpu.getCycleCount();
+
+    if ( cycles > now - snapshotCycle( 0 ) )
+        return false;
+
+    uint64_t target = now - cycles;
+
+    unsigned int index = numSnapshots() - 1;
+    while ( snapshotCycle( index ) > target )
+        index--;
+
+    goTo( index, target );
+    return true;
+}
+
+template <typename Checking>
+bool BasicReverseDebugger<Checking>::reverseContinue( int32_t breakpoint ) {
+    return reverseToInstruction( breakpoint );
+}
+
+template <typename Checking>
+ReverseStats BasicReverseDebugger<Checking>::getStats( void ) {
+    stats.snapshots = numSnapshots();
+    stats.bytes = deltaBytes + 3 * sizeof(CPUState);
+    stats.oldestCycle = snapshotCycle( 0 );
+
+    return stats;
+}
+
+template class BasicReverseDebugger<Checked>;
+template class BasicReverseDebugger<Unchecked>;
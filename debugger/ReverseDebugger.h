@@ -0,0 +1,113 @@
+// runs the cycle accurate CPU forwards and backwards
+// a snapshot is taken every so often, keeping only the RAM pages written since the one before. Going
+//     backwards restores the nearest snapshot and runs forwards again to the cycle we want
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef REVERSE_DEBUGGER_H
+#define REVERSE_DEBUGGER_H
+
+#include "../cpu/CPU.h"
+#include "../cpu/Video.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <memory>
+#include <vector>
+
+struct ReverseStats {
+    unsigned int snapshots;  // held at the moment, including the oldest one (which is kept in full)
+    size_t bytes;            // memory used by the snapshots
+    uint64_t oldestCycle;    // we cannot go back before this
+    uint64_t snapshotsTaken; // since construction
+    uint64_t pagesSaved;     // RAM pages copied into those snapshots
+    uint64_t merged;         // snapshots merged into the oldest one to stay under maxBytes
+    uint64_t cyclesReplayed; // cycles run again to go backwards
+};
+
+// Checking is the checking policy of the CPU we are debugging
+template <typename Checking>
+class BasicReverseDebugger {
+    private:
+        // a snapshot after the oldest one. Only the pages written since the snapshot before are kept
+        struct Delta {
+            CPUCoreState core;
+            RamAddrTranOutputs outputs;
+            std::vector<unsigned int> pages;
+            std::vector<RAMPage> contents;
+        };
+
+        BasicCPU<Checking> &cpu;
+        uint64_t interval;
+        size_t maxBytes;
+
+        std::unique_ptr<CPUState> oldest;  // the first snapshot, in full
+        std::unique_ptr<CPUState> newest;  // the last snapshot, in full. The dirty pages in the CPU are since this one
+        std::unique_ptr<CPUState> scratch; // for putting together a snapshot from the middle
+        std::deque<Delta> deltas;          // every snapshot after the oldest, in order
+        size_t deltaBytes;
+
+        std::vector<unsigned int> dirtyPages;
+        std::vector<bool> pageWanted; // for load. All false in between
+        NullVideo nullVideo; // frames shown while running forwards again are thrown away
+        ReverseStats stats;
+
+        // not copyable
+        BasicReverseDebugger( const BasicReverseDebugger& );
+        BasicReverseDebugger& operator=( const BasicReverseDebugger& );
+
+        unsigned int numSnapshots( void );
+        uint64_t snapshotCycle( unsigned int index );
+
+        void takeSnapshot( void );
+        size_t deltaSize( const Delta &delta );
+        void applyDelta( CPUState &state, const Delta &delta );
+        void mergeOldest( void );
+
+        // put snapshot number index into the CPU. Later snapshots are kept
+        void load( unsigned int index );
+
+        // put snapshot number index into the CPU, forget the ones after it and run forwards to cycle
+        void goTo( unsigned int index, uint64_t cycle );
+
+        // the last instruction before now which starts at breakpoint (or any instruction)
+        bool reverseToInstruction( int32_t breakpoint );
+
+    public:
+        // for reverseContinue: stop at any instruction
+        static const int32_t anyInstruction = -1;
+
+        // cpu must outlive us. Everything which runs it from now on should be done through us
+        // a snapshot is taken every interval cycles. When the snapshots take up more than maxBytes
+        //      the oldest ones are merged together, so we can't go back so far
+        BasicReverseDebugger( BasicCPU<Checking> &cpu, uint64_t interval, size_t maxBytes );
+
+        // forwards. These return whether or not the CPU has halted
+        bool step( void ); // one clock tick
+        bool stepInstruction( void ); // to the start of the next instruction
+        bool run( uint64_t maxCycles ); // until halt or maxCycles clock ticks
+
+        // backwards. If we can't go back far enough these return false without doing anything
+        // to the start of the previous instruction
+        bool reverseStep( void );
+        // back cycles clock ticks
+        bool reverseStepCycles( uint64_t cycles );
+        // to the last time the instruction at breakpoint was about to start (before now)
+        bool reverseContinue( int32_t breakpoint );
+
+        ReverseStats getStats( void );
+};
+
+typedef BasicReverseDebugger<DefaultChecking> ReverseDebugger;
+
+#endif
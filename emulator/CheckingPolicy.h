@@ -0,0 +1,37 @@
+// policies choosing whether Signal (and everything built out of Signals) checks for undefined values
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef CHECKING_POLICY_H
+#define CHECKING_POLICY_H
+
+// Signals remember whether they have been given a value and reading an undefined Signal is an error.
+//      This catches mistakes in the datapath and is what the tests are written against
+struct Checked {
+    static const bool checking = true;
+};
+
+// Signals are plain values. They are always defined so undefine() does nothing and any
+//      diagnostics which need to know whether something was set are skipped
+struct Unchecked {
+    static const bool checking = false;
+};
+
+// compile with -DUNCHECKED_SIGNALS to use Unchecked wherever a policy is not given explicitly
+#ifdef UNCHECKED_SIGNALS
+typedef Unchecked DefaultChecking;
+#else
+typedef Checked DefaultChecking;
+#endif
+
+#endif
@@ -0,0 +1,86 @@
+// A Signal for combinational logic which becomes undefined on every clock tick without being told
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef COMBINATIONAL_SIGNAL_H
+#define COMBINATIONAL_SIGNAL_H
+
+#include "debug.h"
+#include "CheckingPolicy.h"
+#include "Signal.h"
+#include <stdint.h>
+
+// A value is only defined during the epoch it was set in. Advancing the epoch (once per clock tick)
+//      undefines every CombinationalSignal at once instead of calling undefine() on each of them
+// Epoch 0 is never current so it is used for signals which have been undefined explicitly
+// thread_local so that CPUs in different threads don't undefine each other's signals
+inline uint64_t& combinationalEpoch( void ) {
+    static thread_local uint64_t epoch = 1;
+    return epoch;
+}
+
+inline void advanceCombinationalEpoch( void ) {
+    combinationalEpoch()++;
+}
+
+// the same interface as Signal
+template <typename Type, typename Checking = DefaultChecking> class CombinationalSignal {
+    private:
+        uint64_t epoch; // when Value was set
+        Type Value;
+
+    public:
+        CombinationalSignal( void ) {
+            epoch = 0;
+            Value = Type();
+        }
+
+        CombinationalSignal( Type GivenValue ) {
+            setValue( GivenValue );
+        }
+
+        void undefine( void ) {
+            epoch = 0;
+        }
+
+        bool isUndefined( void ) {
+            return epoch != combinationalEpoch();
+        }
+
+        bool isDefined( void ) {
+            return epoch == combinationalEpoch();
+        }
+
+        void setValue( Type GivenValue ) {
+            epoch = combinationalEpoch();
+            Value = GivenValue;
+        }
+
+        Type getValue( void ) {
+            if ( isUndefined() ) {
+                errExit( ErrorKind::undefinedValue, "getting the value of an undefined signal" );
+            }
+
+            return Value;
+        }
+};
+
+// with nothing to check there is nothing to undefine either
+template <typename Type> class CombinationalSignal<Type, Unchecked> : public Signal<Type, Unchecked> {
+    public:
+        CombinationalSignal( void ) : Signal<Type, Unchecked>() {}
+
+        CombinationalSignal( Type GivenValue ) : Signal<Type, Unchecked>( GivenValue ) {}
+};
+
+#endif
@@ -0,0 +1,54 @@
+// a quick hash for comparing memory contents
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+const uint64_t fnv1aOffsetBasis = UINT64_C(0xcbf29ce484222325);
+const uint64_t fnv1aPrime = UINT64_C(0x100000001b3);
+
+// 64 bit FNV-1a of bytes bytes at data. Pass the result back in as hash to carry on hashing more data
+// this is not cryptographic. It is only for noticing when two memories or frames are different
+inline uint64_t fnv1a( const void* data, size_t bytes, uint64_t hash = fnv1aOffsetBasis ) {
+    const uint8_t* p = static_cast<const uint8_t*>( data );
+
+    for ( size_t i = 0; i < bytes; i++ ) {
+        hash ^= p[i];
+        hash *= fnv1aPrime;
+    }
+
+    return hash;
+}
+
+// the same as fnv1a but taking 8 bytes at a time, so it is about 8 times faster. The hashes are
+//      not the same as fnv1a's
+inline uint64_t fnv1aWords( const void* data, size_t bytes, uint64_t hash = fnv1aOffsetBasis ) {
+    const uint8_t* p = static_cast<const uint8_t*>( data );
+    size_t i = 0;
+
+    for ( ; i + sizeof(uint64_t) <= bytes; i += sizeof(uint64_t) ) {
+        uint64_t word;
+        memcpy( &word, p + i, sizeof(word) );
+        hash ^= word;
+        hash *= fnv1aPrime;
+    }
+
+    return fnv1a( p + i, bytes - i, hash );
+}
+
+#endif
@@ -19,7 +19,13 @@
 
 #include "Signal.h"
 
-template <typename Type> class Register {
+// a Register as plain data: what it outputs now and what it will output after the next clock tick
+template <typename Type> struct RegisterState {
+    SignalState<Type> Q;
+    SignalState<Type> QNext;
+};
+
+template <typename Type, typename Checking = DefaultChecking> class Register {
     public:
         void changeDriveSignal( Type signalValue ) {
             QNext.setValue( signalValue );
@@ -30,8 +36,11 @@ template <typename Type> class Register {
         }
 
         Type getOutput( void ) {
-            Q.getValue();
-            return Q.getValue();
+            return Q.getValue(); // checking done in Signal
+        }
+
+        bool isDefined( void ) {
+            return Q.isDefined();
         }
 
         void reset( void ) {
@@ -39,9 +48,19 @@ template <typename Type> class Register {
             QNext.undefine();
         }
 
+        void saveState( RegisterState<Type> &state ) {
+            Q.saveState( state.Q );
+            QNext.saveState( state.QNext );
+        }
+
+        void restoreState( const RegisterState<Type> &state ) {
+            Q.restoreState( state.Q );
+            QNext.restoreState( state.QNext );
+        }
+
     private:
-        Signal<Type> Q;
-        Signal<Type> QNext;
+        Signal<Type, Checking> Q;
+        Signal<Type, Checking> QNext;
 };
 
 #endif
@@ -30,31 +30,41 @@
 #include "../emulator/debug.h"
 #include <string>
 
-template <typename DataType, typename IndexType, unsigned int numRegisters> 
+// a RegisterFile as plain data. The inputs are left out because they are always undefined in between
+//      clock ticks, which is the only time that the state is saved or restored
+template <typename DataType, unsigned int numRegisters> struct RegisterFileState {
+    RegisterState<DataType> registers[numRegisters];
+    SignalState<DataType> out1;
+    SignalState<DataType> out2;
+};
+
+template <typename DataType, typename IndexType, unsigned int numRegisters, typename Checking = DefaultChecking>
 class RegisterFile {
     private:
         // representing values on the IO to the Register File on the clock edge
         // everything is a Signal so that undefined in will mean undefined out
-        Signal<IndexType> readSelect1;
-        Signal<IndexType> readSelect2;
+        Signal<IndexType, Checking> readSelect1;
+        Signal<IndexType, Checking> readSelect2;
 
-        Signal<DataType> out1;
-        Signal<DataType> out2;
+        Signal<DataType, Checking> out1;
+        Signal<DataType, Checking> out2;
 
-        Signal<bool> readThisCycle;
+        // these two are always checked because whether they are defined says what to do this cycle
+        //      (nothing, or no write for register 0)
+        Signal<bool, Checked> readThisCycle;
+        Signal<IndexType, Checked> writeSelect;
 
-        Signal<IndexType> writeSelect;
-        Signal<DataType> writeData;
+        Signal<DataType, Checking> writeData;
 
         // private utility function for checking that input register indexes are sane
         // not actually part of the hardware. This is to get error messages for debugging
         void validateRegisterIndex( IndexType regIndex ) {
-            if ( regIndex > numRegisters-1 )
+            if ( Checking::checking && (regIndex > numRegisters-1) )
                 errExit( "invalid register index" );
         }
 
         // The registers
-        Register<DataType> registers[numRegisters]; 
+        Register<DataType, Checking> registers[numRegisters]; 
 
     public:
         RegisterFile( void ) {
@@ -65,6 +75,22 @@ class RegisterFile {
             registers[0].changeDriveSignal( 0 );
         }
 
+        // back to how the constructor left us
+        void reset( void ) {
+            for ( unsigned int i = 0; i < numRegisters; i++ )
+                registers[i].reset();
+
+            out1.undefine();
+            out2.undefine();
+            readSelect1.undefine();
+            readSelect2.undefine();
+            readThisCycle.undefine();
+            writeSelect.undefine();
+            writeData.undefine();
+
+            registers[0].changeDriveSignal( 0 );
+        }
+
         void clockTick( void ){
             if ( readThisCycle.isDefined() ) { // if we are doing anything this cycle
                 if ( readThisCycle.getValue() ) { // we are reading
@@ -99,7 +125,9 @@ class RegisterFile {
                         registers[ writeSelect.getValue() ].changeDriveSignal( 
                             writeData.getValue() );
 
+                        #ifdef SIGNAL_DEBUG
                         debugSignal( "general purpouse register " + std::to_string((int) writeSelect.getValue()), writeData.getValue() );
+                        #endif
                     } else { // something is wrong
                         debug( "incomplete input to RegistersFile on write" );
                     }
@@ -117,7 +145,7 @@ class RegisterFile {
             writeData.undefine();
 
             // registers all need a clock
-            for (unsigned int i = 0; i < numRegisters-1; i++)
+            for (unsigned int i = 0; i < numRegisters; i++)
                 registers[i].clockTick();
 
         } // end of clockTick()
@@ -152,6 +180,28 @@ class RegisterFile {
             writeData.setValue( data );
         }
 
+        void saveState( RegisterFileState<DataType, numRegisters> &state ) {
+            for ( unsigned int i = 0; i < numRegisters; i++ )
+                registers[i].saveState( state.registers[i] );
+
+            out1.saveState( state.out1 );
+            out2.saveState( state.out2 );
+        }
+
+        void restoreState( const RegisterFileState<DataType, numRegisters> &state ) {
+            for ( unsigned int i = 0; i < numRegisters; i++ )
+                registers[i].restoreState( state.registers[i] );
+
+            out1.restoreState( state.out1 );
+            out2.restoreState( state.out2 );
+
+            readSelect1.undefine();
+            readSelect2.undefine();
+            readThisCycle.undefine();
+            writeSelect.undefine();
+            writeData.undefine();
+        }
+
         // outputs
         DataType getOut1( void ) {
             return out1.getValue(); // checking done in Signal
@@ -16,8 +16,15 @@
 #define SIGNAL_H
 
 #include "debug.h"
+#include "CheckingPolicy.h"
 
-template <typename Type> class Signal {
+// a Signal as plain data, for saving and restoring the state of a CPU
+template <typename Type> struct SignalState {
+    Type value;
+    bool defined;
+};
+
+template <typename Type, typename Checking = DefaultChecking> class Signal {
     private:
         bool undefined;
         Type Value;
@@ -51,11 +58,59 @@ template <typename Type> class Signal {
 
         Type getValue( void ) {
             if ( undefined ) {
-                errExit( "getting the value of an undefined signal" );
+                errExit( ErrorKind::undefinedValue, "getting the value of an undefined signal" );
             }
 
             return Value;
         }
+
+        void saveState( SignalState<Type> &state ) {
+            state.value = Value;
+            state.defined = !undefined;
+        }
+
+        void restoreState( const SignalState<Type> &state ) {
+            Value = state.value;
+            undefined = !state.defined;
+        }
+};
+
+// a Signal which is just a value. There is nowhere to store whether it is defined so it always is
+template <typename Type> class Signal<Type, Unchecked> {
+    private:
+        Type Value;
+
+    public:
+        Signal( void ) : Value() {}
+
+        Signal( Type GivenValue ) : Value( GivenValue ) {}
+
+        void undefine( void ) {}
+
+        bool isUndefined( void ) {
+            return false;
+        }
+
+        bool isDefined( void ) {
+            return true;
+        }
+
+        void setValue( Type GivenValue ) {
+            Value = GivenValue;
+        }
+
+        Type getValue( void ) {
+            return Value;
+        }
+
+        void saveState( SignalState<Type> &state ) {
+            state.value = Value;
+            state.defined = true;
+        }
+
+        void restoreState( const SignalState<Type> &state ) {
+            Value = state.value;
+        }
 };
 
 #endif
@@ -15,10 +15,51 @@
 #include "debug.h"
 #include <stdlib.h>
 #include <iostream>
+#include <mutex>
+
+// the handler and debug stream belong to the thread so that CPUs in different threads can each have their own
+static thread_local ErrorHandler errorHandler = NULL;
+static thread_local void* errorContext = NULL;
+static thread_local std::ostream* debugStream = &std::cerr;
+
+// stops messages from different threads being mixed up on stderr
+static std::mutex& stderrMutex( void ) {
+    static std::mutex m;
+    return m;
+}
+
+static void writeMessage( std::ostream &stream, const char* prefix, const std::string &message ) {
+    if ( &stream == &std::cerr ) {
+        std::lock_guard<std::mutex> lock( stderrMutex() );
+        stream << prefix << message << std::endl;
+    } else {
+        stream << prefix << message << std::endl;
+    }
+}
+
+const char* errorKindName( ErrorKind kind ) {
+    switch ( kind ) {
+        case ( ErrorKind::invalidOpcode ):
+            return "invalidOpcode";
+        case ( ErrorKind::badAddress ):
+            return "badAddress";
+        case ( ErrorKind::undefinedValue ):
+            return "undefinedValue";
+        default:
+            return "general";
+    }
+}
 
 // prints message and then exits: returning to indicate something bad hapened
 void errExit( std::string message ) {
-    std::cerr << "FATAL: " << message << std::endl;
+    errExit( ErrorKind::general, message );
+}
+
+void errExit( ErrorKind kind, std::string message ) {
+    if ( errorHandler )
+        errorHandler( kind, message, errorContext );
+
+    writeMessage( std::cerr, "FATAL: ", message );
 
     exit( EXIT_FAILURE );
 }
@@ -26,10 +67,41 @@ void errExit( std::string message ) {
 // if debugging is enabled, print a message to stderr
 void debug( std::string message ) {
     #ifdef DEBUG
-        std::cerr << "DEBUG: " << message << std::endl;
+        if ( debugStream )
+            writeMessage( *debugStream, "DEBUG: ", message );
     #else
         // do something with message so the compiler does not complain that it is unused
         message.length();
     #endif
 }
 
+void signalDebug( const std::string &message ) {
+    if ( debugStream )
+        writeMessage( *debugStream, "SIGNAL DEBUG: ", message );
+}
+
+bool signalDebugEnabled( void ) {
+    return debugStream != NULL;
+}
+
+ScopedErrorHandler::ScopedErrorHandler( ErrorHandler handler, void* context ) {
+    oldHandler = errorHandler;
+    oldContext = errorContext;
+
+    errorHandler = handler;
+    errorContext = context;
+}
+
+ScopedErrorHandler::~ScopedErrorHandler( void ) {
+    errorHandler = oldHandler;
+    errorContext = oldContext;
+}
+
+ScopedDebugStream::ScopedDebugStream( std::ostream* stream ) {
+    oldStream = debugStream;
+    debugStream = stream;
+}
+
+ScopedDebugStream::~ScopedDebugStream( void ) {
+    debugStream = oldStream;
+}
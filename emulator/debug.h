@@ -17,17 +17,78 @@
 
 #include <string>
 #include <iostream>
+#include <sstream>
+
+// what went wrong, so that a fault in the emulated program can be told apart from a mistake in the
+//      emulator or in how it is being used
+enum class ErrorKind {
+    general,        // anything else
+    invalidOpcode,  // the program ran something which is not an instruction
+    badAddress,     // the program used an address which does not exist
+    undefinedValue  // the program read something before it was given a value
+};
+
+// the name of kind as it is written above, for reports
+const char* errorKindName( ErrorKind kind );
 
 // prints message and then exits execution: indicating an error condition
+// if this thread has a ScopedErrorHandler then that gets the message instead. errExit still exits
+//      if the handler returns, so the handler has to throw to carry on
 void errExit( std::string message );
+void errExit( ErrorKind kind, std::string message );
 
-// if debugging is enabled, print a debug message to stderr
+// if debugging is enabled, print a debug message to stderr (or this thread's ScopedDebugStream)
 void debug( std::string message );
 
+typedef void (*ErrorHandler)( ErrorKind kind, const std::string &message, void* context );
+
+// while this exists, errExit in this thread calls handler( kind, message, context )
+// this lets one CPU instance fail without stopping the other CPUs in the process
+class ScopedErrorHandler {
+    private:
+        ErrorHandler oldHandler;
+        void* oldContext;
+
+        ScopedErrorHandler( const ScopedErrorHandler& );
+        ScopedErrorHandler& operator=( const ScopedErrorHandler& );
+
+    public:
+        ScopedErrorHandler( ErrorHandler handler, void* context );
+        ~ScopedErrorHandler( void );
+};
+
+// while this exists, debug messages from this thread go to stream. NULL throws them away
+class ScopedDebugStream {
+    private:
+        std::ostream* oldStream;
+
+        ScopedDebugStream( const ScopedDebugStream& );
+        ScopedDebugStream& operator=( const ScopedDebugStream& );
+
+    public:
+        explicit ScopedDebugStream( std::ostream* stream );
+        ~ScopedDebugStream( void );
+};
+
+// print a message from debugSignal to stderr (or this thread's ScopedDebugStream)
+void signalDebug( const std::string &message );
+
+// false if this thread's debug messages are being thrown away
+bool signalDebugEnabled( void );
+
 // if signal debugging is enabled, print signal changes to stderr
-template <typename Type> void debugSignal( std::string name, Type newVal ) {
+// name is taken as it is given (usually a string literal) so that nothing is allocated when this is disabled
+template <typename NameType, typename Type> void debugSignal( const NameType &name, Type newVal ) {
     #ifdef SIGNAL_DEBUG
-    std::cerr << "SIGNAL DEBUG: " << name << " changed to " << newVal << std::endl;
+    if ( !signalDebugEnabled() )
+        return;
+
+    std::ostringstream message;
+    message << name << " changed to " << newVal;
+    signalDebug( message.str() );
+    #else
+    (void) name;
+    (void) newVal;
     #endif 
 }
 
@@ -1,5 +1,6 @@
 // n-way multiplexer with arbitary types
 // this is pretty much just a wrapper for std::unordered_map and Signal
+// FixedMux is the same thing for bool and enum class selects, backed by an array instead
 
 /*  This file is part of cpuEmulator.
     cpuEmulator is free software: you can redistribute it and/or modify
@@ -18,7 +19,7 @@
 
 #include <unordered_map>
 #include "Signal.h"
-#include <stdexcept>
+#include "CombinationalSignal.h"
 #include "debug.h"
 #include <type_traits> // magic
 
@@ -31,22 +32,25 @@ struct EnumClassHash {
     }
 };
 
-template <typename KeyType, typename DataType > class Mux {
+// the inputs and the select are combinational signals so they are all undefined by the next clock tick
+//      (see CombinationalSignal.h). Inputs are never removed from Data so after the first cycle
+//      setInput does not allocate
+template <typename KeyType, typename DataType, typename Checking = DefaultChecking> class Mux {
     private:
         /* the third template parameter to this is the hashing function to use
             when building the hash table. std::hash does not know how to deal
             with enums and so we need to specify EnumClassHash *only* when KeyType
             is an enum
         */
-        std::unordered_map<KeyType, DataType, typename
+        std::unordered_map<KeyType, CombinationalSignal<DataType, Checking>, typename
             std::conditional< std::is_enum<KeyType>::value, EnumClassHash,
             std::hash<KeyType> >::type> Data;
 
-        Signal<KeyType> Select;
+        CombinationalSignal<KeyType, Checking> Select;
 
     public:
         void setInput( KeyType InputSelect, DataType inData ) {
-               Data[InputSelect] = inData;
+               Data[InputSelect].setValue( inData );
         }
 
         void setSelect( KeyType InputSelect ) {
@@ -54,16 +58,14 @@ template <typename KeyType, typename DataType > class Mux {
         }
 
         DataType getOutput( void ) {
-            DataType Output;
+            // checks done in Signal
+            typename decltype(Data)::iterator input = Data.find( Select.getValue() );
 
-            try {
-                Output = Data.at( Select.getValue() ); // checks done in Signal
-            } catch (const std::out_of_range& err) {
+            // an input left over from an earlier cycle is not an input any more
+            if ( (input == Data.end()) || input->second.isUndefined() )
                 errExit( "Mux selecting an unrecognised input" );
-            }
 
-            // gcc will complain that Output might be uninitialised here. This is because it does not know that errExit can never return. Ignore this error.
-            return Output; 
+            return input->second.getValue();
         }
 
         void undefine( void ) {
@@ -71,5 +73,54 @@ template <typename KeyType, typename DataType > class Mux {
             Data.clear();
         }
 };
+
+// a Mux for selects which are bool or an enum class with numInputs values (0 to numInputs - 1)
+// the inputs are kept in an array indexed by the select so nothing is allocated and selecting
+//      is a single index rather than a hash table lookup
+template <typename KeyType, typename DataType, unsigned int numInputs, typename Checking = DefaultChecking>
+class FixedMux {
+    static_assert( std::is_enum<KeyType>::value || std::is_same<KeyType, bool>::value,
+            "FixedMux selects must be bool or an enum" );
+    static_assert( !std::is_same<KeyType, bool>::value || numInputs == 2,
+            "a FixedMux with a bool select has exactly two inputs" );
+
+    private:
+        CombinationalSignal<DataType, Checking> Data[ numInputs ];
+        CombinationalSignal<KeyType, Checking> Select;
+
+        static unsigned int index( KeyType InputSelect ) {
+            unsigned int i = static_cast<unsigned int>( InputSelect );
+
+            if ( Checking::checking && (i >= numInputs) )
+                errExit( "FixedMux select out of range" );
+
+            return i;
+        }
+
+    public:
+        void setInput( KeyType InputSelect, DataType inData ) {
+            Data[ index( InputSelect ) ].setValue( inData );
+        }
+
+        void setSelect( KeyType InputSelect ) {
+            Select.setValue( InputSelect );
+        }
+
+        DataType getOutput( void ) {
+            CombinationalSignal<DataType, Checking> &input = Data[ index( Select.getValue() ) ];
+
+            if ( input.isUndefined() )
+                errExit( "Mux selecting an unrecognised input" );
+
+            return input.getValue();
+        }
+
+        void undefine( void ) {
+            Select.undefine();
+
+            for ( unsigned int i = 0; i < numInputs; i++ )
+                Data[i].undefine();
+        }
+};
     
 #endif
@@ -0,0 +1,169 @@
+// counts heap allocations while the cycle accurate CPU runs branch heavy code
+// once it has warmed up, a clock tick should not touch the heap at all
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../cpu/CPU.h"
+#include "../cpu/CPUPool.h"
+#include "../emulator/debug.h"
+#include "../assembler/Instruction.h"
+#include "../cpu/Opcodes.h"
+#include "demoProgram.h"
+#include <vector>
+#include <new>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+
+using namespace std;
+
+// every heap allocation in the program goes through these
+static unsigned long long allocations = 0;
+
+void* operator new( size_t size ) {
+    allocations++;
+
+    void* p = malloc( size ? size : 1 );
+    if ( !p )
+        throw bad_alloc();
+
+    return p;
+}
+
+void* operator new[]( size_t size ) {
+    return operator new( size );
+}
+
+void operator delete( void* p ) noexcept {
+    free( p );
+}
+
+void operator delete[]( void* p ) noexcept {
+    free( p );
+}
+
+void operator delete( void* p, size_t ) noexcept {
+    free( p );
+}
+
+void operator delete[]( void* p, size_t ) noexcept {
+    free( p );
+}
+
+// cycles run before we start counting. By then anything which is allocated lazily has been
+const unsigned int warmUpCycles = 1000;
+
+// counts down from iterations to 0 using both branch instructions every time around the loop
+vector<int32_t> branchProgram( int32_t iterations ) {
+    const int32_t loop = 7;
+    const int32_t end = 12;
+
+    vector<Instruction> program;
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, iterations ) );
+    program.push_back( Instruction( Opcode::add, 0, 1, 2 ) ); // r2 is the counter
+    // a RAM page is copied the first time it is written (see ram.h), so write to the page the
+    //      result goes in during warm up
+    program.push_back( Instruction( Opcode::store, (uint8_t) 0, (uint8_t) 2 ) );
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, loop * 4 ) );
+    program.push_back( Instruction( Opcode::add, 0, 1, 3 ) ); // r3 = address of loop
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, end * 4 ) );
+    program.push_back( Instruction( Opcode::add, 0, 1, 4 ) ); // r4 = address of end
+
+    // loop:
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 1 ) );
+    program.push_back( Instruction( Opcode::sub, 2, 1, 2 ) ); // r2 = r2 - r1
+    program.push_back( Instruction( Opcode::branchIfZero, 4 ) );
+    program.push_back( Instruction( Opcode::branchIfPositive, 3 ) );
+    program.push_back( Instruction( Opcode::halt ) ); // not reached
+
+    // end: store the counter over word 0 so that we can check it
+    program.push_back( Instruction( Opcode::store, (uint8_t) 0, (uint8_t) 2 ) );
+    program.push_back( Instruction( Opcode::halt ) );
+
+    return assemble( program );
+}
+
+template <typename CPUType>
+void allocationTest( const vector<int32_t> &machineCode, const string &name ) {
+    CPUType DUT( machineCode );
+
+    for ( unsigned int i = 0; i < warmUpCycles; i++ ) {
+        if ( DUT.clockTick() )
+            errExit( name + ": halted during warm up" );
+    }
+
+    unsigned long long before = allocations;
+    unsigned long long cycles = 0;
+    do {
+        cycles++;
+    } while ( !DUT.clockTick() );
+    unsigned long long after = allocations;
+
+    if ( DUT.debugRamRead( 0 ) != 0 )
+        errExit( name + ": the loop did not count down to 0" );
+
+    if ( after != before )
+        errExit( name + ": " + to_string( after - before ) + " heap allocations in "
+                + to_string( cycles ) + " steady state cycles" );
+
+    debug( name + ": no heap allocations in " + to_string( cycles ) + " steady state cycles" );
+}
+
+// CPUs taken from a pool, run and given back, over and over. Once each CPU in the pool has run the
+//      program once, none of this should allocate
+template <typename Checking>
+void poolTest( const vector<int32_t> &machineCode, const string &name ) {
+    const unsigned int poolSize = 2;
+    const unsigned int jobs = 20;
+
+    BasicCPUPool<Checking> pool( poolSize );
+
+    unsigned long long before = 0;
+    for ( unsigned int job = 0; job < jobs; job++ ) {
+        if ( job == poolSize )
+            before = allocations;
+
+        BasicPooledCPU<Checking> first( pool, machineCode );
+        BasicPooledCPU<Checking> second( pool, machineCode );
+        while ( !first->clockTick() );
+        while ( !second->clockTick() );
+
+        if ( (first->debugRamRead( 0 ) != 0) || (second->debugRamRead( 0 ) != 0) )
+            errExit( name + ": the loop did not count down to 0" );
+    }
+    unsigned long long after = allocations;
+
+    if ( pool.size() != poolSize )
+        errExit( name + ": the pool grew" );
+
+    if ( after != before )
+        errExit( name + ": " + to_string( after - before ) + " heap allocations in "
+                + to_string( jobs - poolSize ) + " rounds of jobs" );
+
+    debug( name + ": no heap allocations in " + to_string( jobs - poolSize ) + " rounds of jobs" );
+}
+
+int main( void ) {
+    vector<int32_t> machineCode = branchProgram( 2000 );
+
+    allocationTest< BasicCPU<Checked> >( machineCode, "CPU (Checked)" );
+    allocationTest< BasicCPU<Unchecked> >( machineCode, "CPU (Unchecked)" );
+
+    // shorter so that running it over and over does not take long
+    vector<int32_t> shortProgram = branchProgram( 20 );
+    poolTest<Checked>( shortProgram, "CPUPool (Checked)" );
+    poolTest<Unchecked>( shortProgram, "CPUPool (Unchecked)" );
+
+    debug( "All allocation tests passed" );
+    return EXIT_SUCCESS;
+}
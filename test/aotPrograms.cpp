@@ -0,0 +1,74 @@
+// small programs for testing AotCPU. See header file
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "aotPrograms.h"
+#include "demoProgram.h"
+#include "../assembler/Instruction.h"
+#include "../cpu/Opcodes.h"
+
+using namespace std;
+
+vector<int32_t> selfModifyingProgram( void ) {
+    vector<Instruction> I;
+    I.push_back( Instruction( Opcode::addImmediate, 0, 17*4 ) );     // r5 = the new instruction
+    I.push_back( Instruction( Opcode::load, 1, (uint8_t) 5 ) );
+    I.push_back( Instruction( Opcode::addImmediate, 0, 8*4 ) );      // r6 = address of TARGET
+    I.push_back( Instruction( Opcode::add, 1, 0, 6 ) );
+    I.push_back( Instruction( Opcode::addImmediate, 0, 200 ) );      // r7 = where to store the results
+    I.push_back( Instruction( Opcode::add, 1, 0, 7 ) );
+    I.push_back( Instruction( Opcode::addImmediate, 0, 16*4 ) );     // r9 = address of halt
+    I.push_back( Instruction( Opcode::add, 1, 0, 9 ) );
+
+    I.push_back( Instruction( Opcode::addImmediate, 0, 11 ) );       // TARGET: r1 = 11, then 77
+    I.push_back( Instruction( Opcode::store, (uint8_t) 7, (uint8_t) 1 ) );
+    I.push_back( Instruction( Opcode::subImmediate, 1, 77 ) );       // halt if this was the second time
+    I.push_back( Instruction( Opcode::branchIfZero, 9 ) );
+
+    I.push_back( Instruction( Opcode::store, (uint8_t) 6, (uint8_t) 5 ) ); // write over TARGET
+    I.push_back( Instruction( Opcode::addImmediate, 7, 4 ) );
+    I.push_back( Instruction( Opcode::add, 1, 0, 7 ) );
+    I.push_back( Instruction( Opcode::jumpToReg, 6 ) );
+
+    I.push_back( Instruction( Opcode::halt ) );
+    // loading byte swaps and storing does not so this is swapped in advance
+    I.push_back( Instruction( static_cast<int32_t>( Instruction( Opcode::addImmediate, 0, 77 ).getObjectCode() ) ) );
+
+    return assemble( I );
+}
+
+vector<int32_t> computedJumpProgram( void ) {
+    vector<Instruction> I;
+    I.push_back( Instruction( Opcode::addImmediate, 0, 3 ) );        // r5 = 3 (loop counter)
+    I.push_back( Instruction( Opcode::add, 1, 0, 5 ) );
+    I.push_back( Instruction( Opcode::addImmediate, 0, 5*4 ) );      // r6 = LOOP
+    I.push_back( Instruction( Opcode::add, 1, 0, 6 ) );
+    I.push_back( Instruction( Opcode::jumpToReg, 6 ) );
+
+    I.push_back( Instruction( Opcode::addImmediate, 0, 15*4 ) );     // LOOP: r2 = ram[ DATA ] = TARGET
+    I.push_back( Instruction( Opcode::load, 1, (uint8_t) 2 ) );
+    I.push_back( Instruction( Opcode::jumpToReg, 2 ) );
+
+    I.push_back( Instruction( Opcode::halt ) );                      // HALT
+
+    I.push_back( Instruction( Opcode::addImmediate, 0, 8*4 ) );      // TARGET: r7 = HALT
+    I.push_back( Instruction( Opcode::add, 1, 0, 7 ) );
+    I.push_back( Instruction( Opcode::subImmediate, 5, 1 ) );        // r5--
+    I.push_back( Instruction( Opcode::add, 1, 0, 5 ) );
+    I.push_back( Instruction( Opcode::branchIfPositive, 6 ) );       // go round again while r5 >= 0
+    I.push_back( Instruction( Opcode::jumpToReg, 7 ) );
+
+    I.push_back( Instruction( 9*4 ) );                               // DATA
+
+    return assemble( I );
+}
@@ -0,0 +1,29 @@
+// small programs which exercise the parts of AotCPU that the demo program does not
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef AOT_PROGRAMS_H
+#define AOT_PROGRAMS_H
+
+#include <stdint.h>
+#include <vector>
+
+// writes over an instruction which has already been translated and then runs it again
+// the results are at 200 (11) and 204 (77)
+std::vector<int32_t> selfModifyingProgram( void );
+
+// jumps to an address loaded from memory so aotTranslate cannot know where it goes
+// the code there is only run by the interpreter, which then jumps back into translated code
+std::vector<int32_t> computedJumpProgram( void );
+
+#endif
@@ -0,0 +1,110 @@
+// tests that programs translated by aotTranslate get the same results as CPU in the same number of cycles
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../cpu/CPU.h"
+#include "../cpu/AotCPU.h"
+#include "../emulator/debug.h"
+#include "demoProgram.h"
+#include "aotPrograms.h"
+#include <vector>
+#include <string>
+#include <stdlib.h>
+#include <stdint.h>
+
+using namespace std;
+
+// made by aotTranslate from the images written by makeImages
+extern const AotProgram demoNoFramesAot;
+extern const AotProgram selfModifyingAot;
+extern const AotProgram computedJumpAot;
+
+// run machineCode on CPU and program on AotCPU and check they halt after the same number of cycles
+//      with the same memory
+static AotStats compareWithCPU( const vector<int32_t> &machineCode, const AotProgram &program, const string &name ) {
+    CPU reference( machineCode );
+    while ( !reference.clockTick() );
+
+    AotCPU DUT( program );
+    if ( !DUT.run( 10 * reference.getCycleCount() ) )
+        errExit( "AotCPU did not halt running " + name );
+
+    if ( DUT.getCycleCount() != reference.getCycleCount() )
+        errExit( "AotCPU counted " + to_string( DUT.getCycleCount() ) + " cycles running " + name
+                + " but CPU counted " + to_string( reference.getCycleCount() ) );
+
+    for ( unsigned int addr = 0; addr < machineCode.size() * sizeof(int32_t); addr += sizeof(int32_t) ) {
+        if ( reference.debugRamRead( addr ) != DUT.debugRamRead( addr ) )
+            errExit( "AotCPU main memory is different to CPU after running " + name );
+    }
+
+    for ( unsigned int addr = mainMemoryBytes; addr < ramBytes; addr += sizeof(int32_t) ) {
+        if ( reference.debugRamRead( addr ) != DUT.debugRamRead( addr ) )
+            errExit( "AotCPU video memory is different to CPU after running " + name );
+    }
+
+    debug( "AotCPU matches CPU running " + name );
+    return DUT.getStats();
+}
+
+int main( void ) {
+    debug( "Beginning AotCPU tests" );
+
+    vector<int32_t> machineCode = demoProgram( false );
+    AotStats stats = compareWithCPU( machineCode, demoNoFramesAot, "the demo program" );
+
+    // every jump in the demo program goes to a constant address so nothing should be interpreted
+    if ( (stats.interpretedInstructions != 0) || (stats.translatedRuns != 1) )
+        errExit( "AotCPU did not run all of the demo program as translated code" );
+
+    // stopping at the cycle limit and carrying on should not change anything
+    AotCPU whole( demoNoFramesAot );
+    whole.run();
+    AotCPU stopStart( demoNoFramesAot );
+    uint64_t limit = 0;
+    unsigned int stops = 0;
+    while ( !stopStart.run( limit ) ) {
+        if ( stopStart.getCycleCount() < limit )
+            errExit( "AotCPU::run stopped before the cycle limit" );
+
+        limit += 997;
+        stops++;
+    }
+
+    if ( stopStart.getCycleCount() != whole.getCycleCount() )
+        errExit( "AotCPU counted different cycles when stopped and started" );
+
+    for ( unsigned int addr = mainMemoryBytes; addr < ramBytes; addr += sizeof(int32_t) ) {
+        if ( stopStart.debugRamRead( addr ) != whole.debugRamRead( addr ) )
+            errExit( "AotCPU video memory is different when stopped and started" );
+    }
+    debug( "AotCPU stopped and started " + to_string( stops ) + " times" );
+
+    // the translation has to be abandoned once it is written over
+    stats = compareWithCPU( selfModifyingProgram(), selfModifyingAot, "self modifying code" );
+    if ( !stats.codeWritten )
+        errExit( "AotCPU did not notice the translated code being written over" );
+
+    AotCPU selfModifying( selfModifyingAot );
+    selfModifying.run();
+    if ( (selfModifying.debugRamRead( 200 ) != 11) || (selfModifying.debugRamRead( 204 ) != 77) )
+        errExit( "AotCPU ran the old translation of self modifying code" );
+
+    // the interpreter runs the code at the computed address and then goes back to the translation
+    stats = compareWithCPU( computedJumpProgram(), computedJumpAot, "a computed jump" );
+    if ( (stats.interpretedInstructions == 0) || (stats.translatedRuns < 2) )
+        errExit( "AotCPU did not go between translated code and the interpreter" );
+
+    debug( "All AotCPU tests passed" );
+    return EXIT_SUCCESS;
+}
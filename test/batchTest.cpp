@@ -0,0 +1,219 @@
+// tests for the batch runner and the per-thread error handlers it uses
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../batch/BatchRunner.h"
+#include "../assembler/Instruction.h"
+#include "../assembler/ProgramImage.h"
+#include "../cpu/Opcodes.h"
+#include "../emulator/debug.h"
+#include "demoProgram.h"
+#include "aotPrograms.h"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+
+using namespace std;
+
+const uint64_t maxCycles = 200000;
+
+static BatchJob job( const string &name, const vector<int32_t> &image ) {
+    BatchJob ret;
+    ret.name = name;
+    ret.image = image;
+    return ret;
+}
+
+static bool sameResult( const BatchResult &a, const BatchResult &b ) {
+    return (a.ok == b.ok) && (a.error == b.error) && (a.halted == b.halted) && (a.cycles == b.cycles)
+        && (a.frames == b.frames) && (a.ramDigest == b.ramDigest) && (a.frameHash == b.frameHash);
+}
+
+struct HandlerError {
+    string message;
+};
+
+static void throwHandlerError( ErrorKind kind, const string &message, void* context ) {
+    (void) kind;
+    HandlerError error = { message + static_cast<const char*>( context ) };
+    throw error;
+}
+
+static void errorHandlerTests( void ) {
+    ScopedErrorHandler outer( throwHandlerError, (void*) " (outer)" );
+
+    try {
+        ScopedErrorHandler inner( throwHandlerError, (void*) " (inner)" );
+        errExit( "test" );
+    } catch ( const HandlerError &error ) {
+        if ( error.message != "test (inner)" )
+            errExit( "the inner error handler was not used" );
+    }
+
+    try {
+        errExit( "test" );
+    } catch ( const HandlerError &error ) {
+        if ( error.message != "test (outer)" )
+            errExit( "the outer error handler was not put back" );
+    }
+}
+
+int main( void ) {
+    debug( "Beginning batch runner tests" );
+
+    errorHandlerTests();
+    debug( "error handler tests passed" );
+
+    // the different ways a job can end
+    vector<BatchJob> jobs;
+    jobs.push_back( job( "demo", demoProgram( true ) ) );
+    jobs.push_back( job( "selfModifying", selfModifyingProgram() ) );
+    jobs.push_back( job( "computedJump", computedJumpProgram() ) );
+
+    vector<Instruction> forever;
+    forever.push_back( Instruction( Opcode::jumpToReg, 0 ) );
+    jobs.push_back( job( "forever", assemble( forever ) ) );
+
+    vector<Instruction> invalid;
+    invalid.push_back( Instruction( Opcode::nop ) );
+    invalid.push_back( Instruction( (int32_t) 0x1F ) );
+    jobs.push_back( job( "invalid", assemble( invalid ) ) );
+
+    BatchJob missing;
+    missing.name = "missing";
+    missing.path = "/nonexistent/missing.img";
+    jobs.push_back( missing );
+
+    // one at a time in this thread, on both engines. They should agree about everything except the errors
+    vector<BatchResult> cpuResults;
+    for ( unsigned int i = 0; i < jobs.size(); i++ ) {
+        BatchResult cpu = runJob( jobs[i], BatchEngine::cpu, maxCycles );
+        BatchResult fast = runJob( jobs[i], BatchEngine::fast, maxCycles );
+        BatchResult unchecked = runJob( jobs[i], BatchEngine::cpuUnchecked, maxCycles );
+
+        if ( !sameResult( cpu, unchecked ) )
+            errExit( "the checked and unchecked CPUs got different results for " + jobs[i].name );
+
+        if ( cpu.ok != fast.ok )
+            errExit( "CPU and FastCPU disagree about whether " + jobs[i].name + " fails" );
+
+        if ( cpu.ok && cpu.halted && !sameResult( cpu, fast ) )
+            errExit( "CPU and FastCPU got different results for " + jobs[i].name );
+
+        if ( (cpu.errorKind != fast.errorKind) || (cpu.faultPC != fast.faultPC) || (!cpu.ok && (cpu.cycles != fast.cycles)) )
+            errExit( "CPU and FastCPU reported different faults for " + jobs[i].name );
+
+        cpuResults.push_back( cpu );
+    }
+
+    if ( !cpuResults[0].ok || !cpuResults[0].halted || (cpuResults[0].frames == 0) )
+        errExit( "the demo program did not run properly" );
+
+    if ( !cpuResults[3].ok || cpuResults[3].halted || (cpuResults[3].cycles != maxCycles) )
+        errExit( "a program which never halts was not stopped at maxCycles" );
+
+    if ( cpuResults[4].ok || cpuResults[4].error.empty() )
+        errExit( "an invalid opcode did not fail the job" );
+
+    if ( (cpuResults[4].errorKind != ErrorKind::invalidOpcode) || (cpuResults[4].faultPC != 4) ||
+            (cpuResults[4].cycles == 0) )
+        errExit( "the invalid opcode was not reported as a fault" );
+
+    if ( cpuResults[5].ok || cpuResults[5].error.empty() )
+        errExit( "a missing image did not fail the job" );
+
+    debug( "single job tests passed" );
+
+    // reading memory which was never written fails on the cpu engine. Only it checks: FastCPU and the
+    //      unchecked CPU read it as zero
+    vector<Instruction> undefined;
+    undefined.push_back( Instruction( Opcode::addImmediate, 0, 1000 ) );
+    undefined.push_back( Instruction( Opcode::add, 1, 0, 5 ) );
+    undefined.push_back( Instruction( Opcode::load, 5, (uint8_t) 6 ) );
+    undefined.push_back( Instruction( Opcode::halt ) );
+    BatchJob undefinedJob = job( "undefined", assemble( undefined ) );
+
+    BatchResult checked = runJob( undefinedJob, BatchEngine::cpu, maxCycles );
+    if ( checked.ok || (checked.errorKind != ErrorKind::undefinedValue) || (checked.faultPC != 8) )
+        errExit( "reading undefined memory did not fail the job" );
+
+    BatchResult unchecked = runJob( undefinedJob, BatchEngine::cpuUnchecked, maxCycles );
+    if ( !unchecked.ok || !unchecked.halted )
+        errExit( "the unchecked CPU did not run a program which reads undefined memory" );
+
+    BatchResult fast = runJob( undefinedJob, BatchEngine::fast, maxCycles );
+    if ( !fast.ok || !sameResult( fast, unchecked ) )
+        errExit( "FastCPU did not run a program which reads undefined memory like the unchecked CPU" );
+
+    debug( "undefined read test passed" );
+
+    // lots of copies on lots of threads should give the same results as one at a time
+    vector<BatchJob> many;
+    for ( unsigned int i = 0; i < 60; i++ )
+        many.push_back( jobs[ i % jobs.size() ] );
+
+    BatchOptions options;
+    options.threads = 4;
+    options.engine = BatchEngine::cpu;
+    options.maxCycles = maxCycles;
+
+    BatchStats stats;
+    vector<BatchResult> results = runBatch( many, options, stats );
+
+    if ( (results.size() != many.size()) || (stats.threads != 4) )
+        errExit( "runBatch did not run every job" );
+
+    for ( unsigned int i = 0; i < results.size(); i++ ) {
+        if ( !sameResult( results[i], cpuResults[ i % jobs.size() ] ) )
+            errExit( "runBatch got a different result for " + many[i].name );
+    }
+
+    debug( "runBatch ran " + to_string( many.size() ) + " jobs on " + to_string( stats.threads )
+            + " threads with " + to_string( stats.steals ) + " stolen" );
+
+    // the same jobs from a manifest
+    char directory[] = "/tmp/batchTestXXXXXX";
+    if ( !mkdtemp( directory ) )
+        errExit( "could not make a directory for the manifest" );
+    string dir = directory;
+
+    ofstream manifest( (dir + "/manifest").c_str() );
+    manifest << "# the jobs from the start of the test\n\n";
+    for ( unsigned int i = 0; i < 5; i++ ) {
+        writeProgramImage( dir + "/" + jobs[i].name + ".img", jobs[i].image );
+        manifest << jobs[i].name << ".img\r\n";
+    }
+    manifest.close();
+
+    vector<BatchJob> fromManifest = readManifest( dir + "/manifest" );
+    if ( fromManifest.size() != 5 )
+        errExit( "readManifest found " + to_string( fromManifest.size() ) + " jobs instead of 5" );
+
+    options.engine = BatchEngine::fast;
+    results = runBatch( fromManifest, options, stats );
+    for ( unsigned int i = 0; i < results.size(); i++ ) {
+        if ( (results[i].ok != cpuResults[i].ok) || (cpuResults[i].halted && !sameResult( results[i], cpuResults[i] )) )
+            errExit( "the manifest job " + fromManifest[i].name + " got a different result" );
+
+        unlink( fromManifest[i].path.c_str() );
+    }
+
+    unlink( (dir + "/manifest").c_str() );
+    rmdir( directory );
+
+    debug( "All batch runner tests passed" );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,72 @@
+// tests for CombinationalSignal
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../emulator/CombinationalSignal.h"
+#include "../emulator/mux.h"
+#include "../emulator/debug.h"
+#include <stdlib.h>
+#include <stdint.h>
+
+int main( void ) {
+    debug( "Beginning CombinationalSignal tests" );
+
+    CombinationalSignal<int32_t, Checked> DUT;
+    if ( DUT.isDefined() )
+        errExit( "CombinationalSignal started defined" );
+
+    DUT.setValue( 5 );
+    if ( DUT.isUndefined() || (DUT.getValue() != 5) )
+        errExit( "CombinationalSignal did not take its value" );
+
+    // a new clock tick undefines it without touching it
+    advanceCombinationalEpoch();
+    if ( DUT.isDefined() )
+        errExit( "CombinationalSignal was still defined in the next epoch" );
+
+    DUT.setValue( 6 );
+    if ( DUT.isUndefined() || (DUT.getValue() != 6) )
+        errExit( "CombinationalSignal could not be set again in a new epoch" );
+
+    DUT.undefine();
+    if ( DUT.isDefined() )
+        errExit( "CombinationalSignal::undefine did not work" );
+
+    // every signal is undefined by the same tick
+    CombinationalSignal<bool, Checked> other( true );
+    DUT.setValue( 7 );
+    advanceCombinationalEpoch();
+    if ( DUT.isDefined() || other.isDefined() )
+        errExit( "advancing the epoch did not undefine every CombinationalSignal" );
+
+    // a mux input from the previous tick is not an input any more
+    Mux<int, int, Checked> mux;
+    mux.setInput( 1, 10 );
+    mux.setInput( 2, 20 );
+    advanceCombinationalEpoch();
+    mux.setInput( 2, 21 );
+    mux.setSelect( 2 );
+    if ( mux.getOutput() != 21 )
+        errExit( "Mux gave the wrong value after a new epoch" );
+
+    // unchecked signals are plain values which stay put
+    static_assert( sizeof(CombinationalSignal<int32_t, Unchecked>) == sizeof(int32_t),
+            "Unchecked CombinationalSignal has an epoch" );
+    CombinationalSignal<int32_t, Unchecked> unchecked( 3 );
+    advanceCombinationalEpoch();
+    if ( unchecked.getValue() != 3 )
+        errExit( "Unchecked CombinationalSignal lost its value" );
+
+    debug( "All CombinationalSignal tests passed" );
+    return EXIT_SUCCESS;
+}
@@ -13,116 +13,134 @@
     along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
 
 #include "../cpu/CPU.h"
+#include "../cpu/AsyncVideo.h"
+#include "../cpu/PacedVideo.h"
+#include "../cpu/FrameRecording.h"
+#include "../cpu/SharedVideo.h"
 #include "../emulator/debug.h"
-#include "../assembler/Instruction.h"
-#include "../cpu/Opcodes.h"
+#include "demoProgram.h"
 #include <vector>
+#include <string>
 #include <stdlib.h>
 #include <stdint.h>
-#include <endian.h>
 
 using namespace std;
 
-void runInstructions( vector<Instruction> &instructions ) {
-    vector<int32_t> machineCode;
-    
-    for ( unsigned int i = 0; i < instructions.size(); i++ )
-        machineCode.push_back( instructions.at(i).getObjectCode() );
-
+// at most framesPerSecond frames are drawn. If wait is set the CPU is slowed down to that speed
+//      instead of frames being skipped
+void runInstructions( const vector<int32_t> &machineCode, double framesPerSecond, bool wait ) {
     CPU DUT( machineCode );
 
+    // the terminal is drawn on in another thread so that the CPU does not wait for it
+    AsyncVideo video( DUT.getVideoOutput() );
+    PacedVideo paced( video, framesPerSecond, wait );
+    DUT.setVideoOutput( paced );
+
     while ( !DUT.clockTick() ); // run until halt
+
+    paced.flush();
+    video.flush();
+
+    PacingStats stats = paced.getStats();
+    debug( to_string( stats.presented ) + " frames presented, " + to_string( stats.skipped ) + " skipped, "
+            + to_string( stats.stallSeconds ) + "s waiting. " + to_string( video.getFramesDropped() )
+            + " dropped by the terminal thread" );
 }
 
-int main( void ) {
-    debug( "Begginning cpu demo" );
-    
-    // does this: (note that the strings here are not null terminated)
-    /*
-     * for (i=6144; i < 10227; i++) { // 6144 is the base address of the video memory
-     *      ram[i] = "____";
-     *      ram[i+1] = "Hell";
-     *      ram[i+1+4] = "o Wo";
-     *      ram[i+1+4+4] ="rld!";
-     *      printBuffer();
-     * }
-     *
-     * Once information is loaded, the registers will contain
-     * r10 = "    "
-     * r11 = "Hell"
-     * r12 = "o Wo"
-     * r13 = "rld!"
-     * r14 = (no longer used)
-     * r15 = 10227
-     * r16 = i
-     * r17 = addr of start of loop
-     * r18 addr of halt
-     */
-
-    vector<Instruction> I;
-
-    I.push_back( Instruction( Opcode::addImmediate, 0, (int32_t) 6*4 ) );
-    I.push_back( Instruction( Opcode::jumpToReg, (uint8_t) 1 ) ); // jump to address 6 (over the data in interveining addresses)
-
-    // data (starts at addr 2)
-    I.push_back( Instruction( static_cast<int32_t>(          0x5F5F5F5F   ) ) ); // "____" symetric so endian-ness does not matter
-    I.push_back( Instruction( static_cast<int32_t>( htobe32( 0x48656C6C ) ) ) ); // "Hell" 
-    I.push_back( Instruction( static_cast<int32_t>( htobe32( 0x6F20576F ) ) ) ); // "o Wo"
-    I.push_back( Instruction( static_cast<int32_t>( htobe32( 0x726C6421 ) ) ) ); // "rld!"
-
-    // preload stuff into registers (starts at addr 6)
-    I.push_back( Instruction( Opcode::addImmediate, 0, (int32_t) 2*4 ) ); // addr 1 jumped to here
-    I.push_back( Instruction( Opcode::load, 1, (uint8_t) 10 ) );       // r10 = ram[2] = "    "
-
-    I.push_back( Instruction( Opcode::addImmediate, 0, (int32_t) 3*4 ) );
-    I.push_back( Instruction( Opcode::load, 1, (uint8_t) 11 ) );       // r11 = ram[3] = "Hell"
-
-    I.push_back( Instruction( Opcode::addImmediate, 0, (int32_t) 4*4 ) );
-    I.push_back( Instruction( Opcode::load, 1, (uint8_t) 12 ) );       // r12 = ram[4] = "o Wo"
-
-    I.push_back( Instruction( Opcode::addImmediate, 0,  (int32_t) 5*4 ) );
-    I.push_back( Instruction( Opcode::load, 1, (uint8_t) 13 ) );        // r13 = ram[5] = "rld!"
-
-    I.push_back( Instruction( Opcode::addImmediate, 0, (int32_t) 6144 ) );
-    I.push_back( Instruction( Opcode::add, 1, 0, 16 ) );               // i = r16 = 6114
-
-    I.push_back( Instruction( Opcode::addImmediate, 0, (int32_t) 10224 ) );
-    I.push_back( Instruction( Opcode::add, 1, 0, 15 ) );               // r15 = 10227
-
-    I.push_back( Instruction( Opcode::addImmediate, 0, (int32_t) 22*4 ) ); // start of the loop is at address 22
-    I.push_back( Instruction( Opcode::add, 1, 0, 17 ) );               // r17 = 22 = start of loop
-
-    I.push_back( Instruction( Opcode::addImmediate, 0, (int32_t) 34*4 ) ); // halt address is 34
-    I.push_back( Instruction( Opcode::add, 1, 0, 18 ) );               // r18 = 34 = halt addr
-
-    // addr 22: start of loop
-    // loop condition
-    I.push_back( Instruction( Opcode::sub, 15, 16, (int8_t) 1 ) );              // r1 = 10227-i
-    I.push_back( Instruction( Opcode::branchIfZero, 18 ) );            // if that subtraction made 0 then i=10227 so jump to the halt
-
-    // loop content
-    I.push_back( Instruction( Opcode::store, 16, (uint8_t) 10 ) );     // ram[i] = r10 = "____"
-
-    I.push_back( Instruction( Opcode::addImmediate, 16, (int32_t) 1 ) );   // r1 = i+1 
-    I.push_back( Instruction( Opcode::add, 1, 0, (uint8_t) 16 ) );         // (while we have i+1 calculated) i = i+1
-    I.push_back( Instruction( Opcode::store, 1, (uint8_t) 11 ) );          // ram[r1] = r11 = "Hell"
-    
-    I.push_back( Instruction( Opcode::addImmediate, 1, (int32_t) 4 ) );    // r1 = r1+4 = i+1+4
-    I.push_back( Instruction( Opcode::store, 1, (uint8_t) 12 ) );          // ram[r1] = r12 = "o Wo"
+// without a terminal, giving every frame to output (keeping a hash of each one or recording them)
+void runHeadless( const vector<int32_t> &machineCode, VideoOutput &output ) {
+    CPU DUT( machineCode );
+    DUT.setVideoOutput( output );
 
-    I.push_back( Instruction( Opcode::addImmediate, 1, (int32_t) 4 ) );    // r1 = r1+4 = i+1+4+4
-    I.push_back( Instruction( Opcode::store, 1, (uint8_t) 13 ) );          // ram[r1] = r13 = "rld!"
+    while ( !DUT.clockTick() );
+}
 
-    I.push_back( Instruction( Opcode::printBuffer ) );
+static void usage( const char* name ) {
+    errExit( string( "usage: " ) + name + " [--fps framesPerSecond] [--wait] [--shared name] | --hashes file | --check file | --record file" );
+}
 
-    // go back to the beginning of the loop
-    I.push_back( Instruction( Opcode::jumpToReg, 17 ) );                   // jump back to the start of the loop
+int main( int argc, char** argv ) {
+    double framesPerSecond = 60;
+    bool wait = false;
+
+    // --shared, --record, --hashes or --check and its file, if one was given
+    string mode;
+    string file;
+
+    // every option is read before anything is run, so they can come in any order
+    for ( int i = 1; i < argc; i++ ) {
+        string option = argv[i];
+
+        if ( option == "--wait" ) {
+            wait = true;
+            continue;
+        }
+
+        if ( i + 1 >= argc )
+            usage( argv[0] );
+        string value = argv[++i];
+
+        if ( option == "--fps" ) {
+            framesPerSecond = atof( value.c_str() );
+        } else if ( (option == "--shared") || (option == "--record") || (option == "--hashes") || (option == "--check") ) {
+            if ( !mode.empty() )
+                usage( argv[0] );
+
+            mode = option;
+            file = value;
+        } else {
+            usage( argv[0] );
+        }
+    }
+
+    // cpuDemo --shared name puts the frames in a shared memory segment instead of on the terminal, for
+    //      frameLatency or another program to read. --wait slows it to --fps
+    if ( mode == "--shared" ) {
+        SharedVideo shared( file );
+        if ( wait ) {
+            PacedVideo paced( shared, framesPerSecond, true );
+            runHeadless( demoProgram( true ), paced );
+        } else {
+            runHeadless( demoProgram( true ), shared );
+        }
+
+        debug( to_string( shared.getFrames() ) + " frames shown in " + file );
+        return EXIT_SUCCESS;
+    }
+
+    // cpuDemo --record file writes every frame to file, to be played back with playFrames
+    if ( mode == "--record" ) {
+        FrameRecorder recorder( file );
+        runHeadless( demoProgram( true ), recorder );
+        recorder.close();
+
+        debug( to_string( recorder.getFrames() ) + " frames recorded in " + to_string( recorder.getBytes() )
+                + " bytes" );
+        return EXIT_SUCCESS;
+    }
+
+    // cpuDemo --hashes file writes the frame hashes to file. cpuDemo --check file compares them with file
+    if ( (mode == "--hashes") || (mode == "--check") ) {
+        FrameHashLog log;
+        runHeadless( demoProgram( true ), log );
+
+        if ( mode == "--hashes" ) {
+            writeFrameHashes( file, log.getHashes() );
+            return EXIT_SUCCESS;
+        }
+
+        size_t difference = log.firstDifference( readFrameHashes( file ) );
+        if ( difference != FrameHashLog::npos )
+            errExit( "frame " + to_string( difference ) + " is not the same as in " + file );
+
+        debug( "all " + to_string( log.getHashes().size() ) + " frames are the same as in " + file );
+        return EXIT_SUCCESS;
+    }
 
-    // the previously mentioned halt instruction
-    I.push_back( Instruction( Opcode::halt ) );
+    debug( "Begginning cpu demo" );
 
     // emulate the processor
-    runInstructions( I );
+    runInstructions( demoProgram( true ), framesPerSecond, wait );
     
     debug( "End of CPU demo" );
     return EXIT_SUCCESS;
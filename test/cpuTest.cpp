@@ -13,42 +13,250 @@
     along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
 
 #include "../cpu/CPU.h"
+#include "../cpu/FastCPU.h"
 #include "../emulator/debug.h"
 #include "../assembler/Instruction.h"
 #include "../cpu/Opcodes.h"
+#include "demoProgram.h"
 #include <vector>
 #include <stdlib.h>
 #include <stdint.h>
+#include <memory>
 
 using namespace std;
 
-// yes returning a CPU is *really* slow but it is the neetest way I can see 
-//      of doing this without refactoring
-// and this still runs in no time at all for the ram sizes we are emulating
-// this function only exists to reduce the amount of repeted code. If we were
-//      using huge ram sizes then it would be better to just write the code out 
-//      long-hand so that the CPU object is not copied around the stack 
-CPU runInstructions( vector<Instruction> &instructions ) {
-    vector<int32_t> machineCode;
-    
-    for ( unsigned int i = 0; i < instructions.size(); i++ )
-        machineCode.push_back( instructions.at(i).getObjectCode() );
+// the CPU is returned in a unique_ptr because CPU cannot be copied (it owns it's RAM)
+// CPUType is CPU (with either checking policy) or FastCPU. They should give the same results
+template <typename CPUType>
+unique_ptr<CPUType> runInstructions( vector<Instruction> &instructions ) {
+    vector<int32_t> machineCode = assemble( instructions );
 
-    CPU DUT( machineCode );
+    unique_ptr<CPUType> DUT( new CPUType( machineCode ) );
 
-    while ( !DUT.clockTick() ); // run until halt
+    while ( !DUT->clockTick() ); // run until halt
 
     return DUT;
 }
 
-int main( void ) {
-    debug( "Begginning cpu tests" );
+// the instruction at TARGET is run, written over with a different instruction and then run again.
+//      the second run must not use the old instruction. The results are stored at 200 (11) and 204 (77)
+vector<Instruction> selfModifyingProgram( void ) {
+    vector<Instruction> selfModifying;
+    // r5 = the new instruction (data at word 17)
+    selfModifying.push_back( Instruction( Opcode::addImmediate, 0, 17*4 ) );
+    selfModifying.push_back( Instruction( Opcode::load, 1, (uint8_t) 5 ) );
+    // r6 = address of TARGET (word 8)
+    selfModifying.push_back( Instruction( Opcode::addImmediate, 0, 8*4 ) );
+    selfModifying.push_back( Instruction( Opcode::add, 1, 0, 6 ) );
+    // r7 = where to store the results
+    selfModifying.push_back( Instruction( Opcode::addImmediate, 0, 200 ) );
+    selfModifying.push_back( Instruction( Opcode::add, 1, 0, 7 ) );
+    // r9 = address of the halt (word 16)
+    selfModifying.push_back( Instruction( Opcode::addImmediate, 0, 16*4 ) );
+    selfModifying.push_back( Instruction( Opcode::add, 1, 0, 9 ) );
+
+    // TARGET: r1 = 11 the first time and 77 the second time
+    selfModifying.push_back( Instruction( Opcode::addImmediate, 0, 11 ) );
+    selfModifying.push_back( Instruction( Opcode::store, (uint8_t) 7, (uint8_t) 1 ) );
+    // halt if this was the second time
+    selfModifying.push_back( Instruction( Opcode::subImmediate, 1, 77 ) );
+    selfModifying.push_back( Instruction( Opcode::branchIfZero, 9 ) );
+
+    // write the new instruction over TARGET, move on to the next result address and go again
+    selfModifying.push_back( Instruction( Opcode::store, (uint8_t) 6, (uint8_t) 5 ) );
+    selfModifying.push_back( Instruction( Opcode::addImmediate, 7, 4 ) );
+    selfModifying.push_back( Instruction( Opcode::add, 1, 0, 7 ) );
+    selfModifying.push_back( Instruction( Opcode::jumpToReg, 6 ) );
+
+    selfModifying.push_back( Instruction( Opcode::halt ) );
+
+    // the new instruction. Loading byte swaps and storing does not so this is swapped in advance
+    selfModifying.push_back( Instruction( static_cast<int32_t>(
+                Instruction( Opcode::addImmediate, 0, 77 ).getObjectCode() ) ) );
+
+    return selfModifying;
+}
+
+// snapshot and restore. FastCPU does not have these
+// the snapshot is taken before TARGET in selfModifyingProgram has run, so after the restore the
+//      old instruction is back in memory and must be run instead of the one which replaced it
+template <typename CPUType>
+void snapshotTests( void ) {
+    vector<Instruction> selfModifying = selfModifyingProgram();
+    vector<int32_t> machineCode = assemble( selfModifying );
+
+    // uninterrupted run to compare against
+    unique_ptr<CPUType> reference = runInstructions<CPUType>( selfModifying );
+
+    unique_ptr<CPUType> DUT( new CPUType( machineCode ) );
+    for ( unsigned int i = 0; i < 20; i++ )
+        DUT->clockTick();
+
+    unique_ptr<CPUState> state( new CPUState );
+    DUT->snapshot( *state );
+
+    while ( !DUT->clockTick() );
+    if ( DUT->getCycleCount() != reference->getCycleCount() )
+        errExit( "snapshot test: taking a snapshot changed the run" );
+
+    // go back and run the rest again
+    DUT->restore( *state );
+    if ( DUT->getCycleCount() != 20 )
+        errExit( "snapshot test: cycle count not restored" );
+
+    while ( !DUT->clockTick() );
+    if ( (DUT->getCycleCount() != reference->getCycleCount()) ||
+            (DUT->debugRamRead( 200 ) != 11) || (DUT->debugRamRead( 204 ) != 77) )
+        errExit( "snapshot test: restoring into the same CPU" );
+    debug( "snapshot test 1 passed" );
+
+    // a CPU which has run a different program is made the same as the one we took the snapshot from
+    vector<int32_t> haltOnly( 1, Instruction( Opcode::halt ).getObjectCode() );
+    CPUType other( haltOnly );
+    while ( !other.clockTick() );
+
+    other.restore( *state );
+    while ( !other.clockTick() );
+    if ( (other.getCycleCount() != reference->getCycleCount()) ||
+            (other.debugRamRead( 200 ) != 11) || (other.debugRamRead( 204 ) != 77) )
+        errExit( "snapshot test: restoring into a different CPU" );
+    debug( "snapshot test 2 passed" );
+
+    // halted CPUs can be restored too
+    other.snapshot( *state );
+    DUT->restore( *state );
+    if ( !DUT->clockTick() || (DUT->getCycleCount() != other.getCycleCount()) )
+        errExit( "snapshot test: restoring a halted CPU" );
+    debug( "snapshot test 3 passed" );
     debug( "" );
+}
+
+// selfModifyingProgram ended the same way in both: the same cycle count, the same program (with
+//      TARGET written over) and the same results
+template <typename CPUType>
+bool sameRun( CPUType &DUT, CPUType &reference, unsigned int programWords ) {
+    if ( DUT.getCycleCount() != reference.getCycleCount() )
+        return false;
+
+    for ( unsigned int i = 0; i < programWords; i++ ) {
+        if ( DUT.debugRamRead( i * 4 ) != reference.debugRamRead( i * 4 ) )
+            return false;
+    }
+
+    return (DUT.debugRamRead( 200 ) == 11) && (DUT.debugRamRead( 204 ) == 77);
+}
+
+// a CPU which has been reset runs a program exactly as one which has just been made
+template <typename CPUType>
+void resetTests( void ) {
+    vector<Instruction> selfModifying = selfModifyingProgram();
+    vector<int32_t> machineCode = assemble( selfModifying );
+
+    unique_ptr<CPUType> reference = runInstructions<CPUType>( selfModifying );
+
+    // selfModifyingProgram writes over itself, so the second run only works if that is undone
+    unique_ptr<CPUType> DUT( new CPUType( machineCode ) );
+    while ( !DUT->clockTick() );
+    DUT->reset( machineCode );
+    if ( (DUT->getCycleCount() != 0) || (DUT->getDecodeCacheHits() != 0) || (DUT->getDecodeCacheMisses() != 0) )
+        errExit( "reset test: counters not reset" );
+
+    while ( !DUT->clockTick() );
+    if ( !sameRun( *DUT, *reference, machineCode.size() ) || (DUT->getDecodeCacheHits() != reference->getDecodeCacheHits()) )
+        errExit( "reset test: running the same program again" );
+    debug( "reset test 1 passed" );
+
+    // part way through a different program, in the middle of an instruction
+    vector<int32_t> haltOnly( 1, Instruction( Opcode::halt ).getObjectCode() );
+    CPUType halter( haltOnly );
+    while ( !halter.clockTick() );
+
+    DUT->reset( machineCode );
+    for ( unsigned int i = 0; i < 21; i++ )
+        DUT->clockTick();
+    DUT->reset( haltOnly );
+    while ( !DUT->clockTick() );
+    if ( DUT->getCycleCount() != halter.getCycleCount() )
+        errExit( "reset test: reset part way through a program" );
+    debug( "reset test 2 passed" );
+
+    // from an image shared with other CPUs. Only the pages written are private again
+    shared_ptr<const MainMemoryImage> image = make_shared<const MainMemoryImage>( machineCode );
+    CPUType fromImage( image );
+    DUT->reset( image );
+    if ( DUT->privateRamPages() != fromImage.privateRamPages() )
+        errExit( "reset test: pages not shared with the image" );
+
+    while ( !DUT->clockTick() );
+    if ( !sameRun( *DUT, *reference, machineCode.size() ) )
+        errExit( "reset test: running from a shared image" );
+    debug( "reset test 3 passed" );
+    debug( "" );
+}
+
+// run returns faults in the program instead of exiting
+template <typename CPUType>
+void faultTests( void ) {
+    vector<int32_t> invalid;
+    invalid.push_back( Instruction( Opcode::nop ).getObjectCode() );
+    invalid.push_back( Instruction( (int32_t) 0x1F ).getObjectCode() ); // not an opcode
+    CPUType DUT( invalid );
+
+    if ( (DUT.run() != RunStatus::faulted) || !DUT.hasFaulted() )
+        errExit( "fault test: invalid opcode did not fault" );
+    if ( (DUT.getFault().kind != ErrorKind::invalidOpcode) || (DUT.getFault().pc != 4) ||
+            (DUT.getFault().cycle != DUT.getCycleCount()) )
+        errExit( "fault test: wrong fault for an invalid opcode" );
+    if ( DUT.run() != RunStatus::faulted )
+        errExit( "fault test: carried on after a fault" );
+    debug( "fault test 1 passed" );
+
+    // a load from past the end of memory in the third instruction
+    vector<Instruction> badLoad;
+    badLoad.push_back( Instruction( Opcode::addImmediate, 0, 20000 ) );
+    badLoad.push_back( Instruction( Opcode::add, 1, 0, 5 ) );
+    badLoad.push_back( Instruction( Opcode::load, 5, (uint8_t) 6 ) );
+    badLoad.push_back( Instruction( Opcode::halt ) );
+    vector<int32_t> machineCode = assemble( badLoad );
+
+    DUT.reset( machineCode );
+    if ( (DUT.run() != RunStatus::faulted) || (DUT.getFault().kind != ErrorKind::badAddress) ||
+            (DUT.getFault().pc != 8) )
+        errExit( "fault test: wrong fault for a bad address" );
+    debug( "fault test 2 passed" );
+
+    // a CPU which has faulted is fine once it has been reset
+    vector<int32_t> haltOnly( 1, Instruction( Opcode::halt ).getObjectCode() );
+    DUT.reset( haltOnly );
+    if ( DUT.hasFaulted() || (DUT.run( 1 ) != RunStatus::cycleLimit) || (DUT.run() != RunStatus::halted) )
+        errExit( "fault test: reset after a fault" );
+    debug( "fault test 3 passed" );
+    debug( "" );
+}
+
+// only Checked signals know that memory has not been written
+void undefinedReadTest( void ) {
+    vector<Instruction> program;
+    program.push_back( Instruction( Opcode::addImmediate, 0, 1000 ) );
+    program.push_back( Instruction( Opcode::add, 1, 0, 5 ) );
+    program.push_back( Instruction( Opcode::load, 5, (uint8_t) 6 ) );
+    program.push_back( Instruction( Opcode::halt ) );
+    vector<int32_t> machineCode = assemble( program );
+
+    BasicCPU<Checked> DUT( machineCode );
+    if ( (DUT.run() != RunStatus::faulted) || (DUT.getFault().kind != ErrorKind::undefinedValue) )
+        errExit( "fault test: reading memory which was never written" );
+    debug( "undefined read test passed" );
+    debug( "" );
+}
+
+template <typename CPUType>
+void cpuTests( void ) {
 
     // test halt
     vector<Instruction> haltTest;
     haltTest.push_back( Instruction( Opcode::halt ) );
-    runInstructions( haltTest );
+    runInstructions<CPUType>( haltTest );
     debug ( "halt test passed" );
     debug( "" );
 
@@ -59,7 +267,7 @@ int main( void ) {
     vector<Instruction> nopTest;
     nopTest.push_back( Instruction( Opcode::nop ) );
     nopTest.push_back( Instruction( Opcode::halt ) );
-    runInstructions( nopTest );
+    runInstructions<CPUType>( nopTest );
     debug( "nop test passed" );
     debug( "" );
 
@@ -74,9 +282,9 @@ int main( void ) {
     // store the contents of register 1 in ram location 0
     test3.push_back( Instruction( Opcode::store, (uint8_t) 0, (uint8_t) 1 ) );
     test3.push_back( Opcode::halt );
-    CPU test3CPU = runInstructions( test3 );
+    unique_ptr<CPUType> test3CPU = runInstructions<CPUType>( test3 );
     
-    if ( test3CPU.debugRamRead( 0 ) != 50 )
+    if ( test3CPU->debugRamRead( 0 ) != 50 )
         errExit( "test3" );
     else
         debug( "test 3 passed" );
@@ -97,9 +305,9 @@ int main( void ) {
     // save this to ram[0]
     test4.push_back( Instruction( Opcode::store, (uint8_t) 0, (uint8_t) 3 ) );
     test4.push_back( Instruction( Opcode::halt ) );
-    CPU test4CPU = runInstructions( test4 );
+    unique_ptr<CPUType> test4CPU = runInstructions<CPUType>( test4 );
     
-    if ( test4CPU.debugRamRead( 0 ) != 0 )
+    if ( test4CPU->debugRamRead( 0 ) != 0 )
         errExit( "test4" );
     else
         debug( "test 4 passed" );
@@ -137,9 +345,9 @@ int main( void ) {
     testLoad.push_back( Instruction( Opcode::store, (uint8_t) 1, (uint8_t) 10 ) );
     testLoad.push_back( Instruction( Opcode::halt ) );
 
-    CPU testLoadCPU = runInstructions( testLoad );
+    unique_ptr<CPUType> testLoadCPU = runInstructions<CPUType>( testLoad );
 
-    if ( testLoadCPU.debugRamRead( 10 ) != 1234 )
+    if ( testLoadCPU->debugRamRead( 10 ) != 1234 )
         errExit( "loadTest" );
     else
         debug( "load test passed" );
@@ -186,15 +394,25 @@ int main( void ) {
 
     condBranch.push_back( Instruction( Opcode::halt ) );
 
-    CPU condBranchCPU = runInstructions( condBranch );
+    unique_ptr<CPUType> condBranchCPU = runInstructions<CPUType>( condBranch );
 
-    if ( condBranchCPU.debugRamRead( 100 ) != 0 )
+    if ( condBranchCPU->debugRamRead( 100 ) != 0 )
         errExit( "cond branch test" );
     else
         debug( "conditional branch test passed" );
 
     debug( "" );
 
+    // self modifying code test
+    vector<Instruction> selfModifying = selfModifyingProgram();
+    unique_ptr<CPUType> selfModifyingCPU = runInstructions<CPUType>( selfModifying );
+
+    if ( (selfModifyingCPU->debugRamRead( 200 ) != 11) || (selfModifyingCPU->debugRamRead( 204 ) != 77) )
+        errExit( "self modifying code test" );
+    else
+        debug( "self modifying code test passed" );
+    debug( "" );
+
     // if add and sub work then nand and lshift definately work because the alu is 
     //      fully tested and the instructions work the same way
 
@@ -206,10 +424,33 @@ int main( void ) {
     printBuffer.push_back( Instruction( Opcode::printBuffer ) );
     printBuffer.push_back( Instruction( Opcode::halt ) );
 
-    runInstructions( printBuffer ); // we are just checking that this manages to return
+    runInstructions<CPUType>( printBuffer ); // we are just checking that this manages to return
     debug( "printBuffer test 1 passed" );
+}
 
+int main( void ) {
+    debug( "Begginning cpu tests" );
+    debug( "" );
 
+    cpuTests<CPU>();
+    snapshotTests<CPU>();
+    resetTests<CPU>();
+    faultTests<CPU>();
+    undefinedReadTest();
     debug( "All tests passed for CPU" );
+    debug( "" );
+
+    debug( "Running the same tests on FastCPU" );
+    cpuTests<FastCPU>();
+    debug( "All tests passed for FastCPU" );
+    debug( "" );
+
+    debug( "Running the same tests on CPU with Unchecked signals" );
+    cpuTests< BasicCPU<Unchecked> >();
+    snapshotTests< BasicCPU<Unchecked> >();
+    resetTests< BasicCPU<Unchecked> >();
+    faultTests< BasicCPU<Unchecked> >();
+    debug( "All tests passed for CPU with Unchecked signals" );
+
     return EXIT_SUCCESS;
 }
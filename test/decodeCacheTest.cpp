@@ -0,0 +1,81 @@
+// tests for DecodeCache
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../cpu/DecodeCache.h"
+#include "../cpu/CPU.h"
+#include "../emulator/debug.h"
+#include "demoProgram.h"
+#include <stdlib.h>
+#include <stdint.h>
+
+int main( void ) {
+    debug( "Beginning DecodeCache tests" );
+
+    DecodeCache<64> DUT;
+    DecodedInstruction inst;
+    inst.op = Opcode::add;
+    inst.A = 1;
+    inst.B = 2;
+    inst.result = 3;
+    inst.immediate = 0;
+
+    if ( DUT.lookup( 8, inst ) )
+        errExit( "empty cache hit" );
+
+    DUT.fill( 8, inst );
+    DecodedInstruction got;
+    if ( !DUT.lookup( 8, got ) )
+        errExit( "cache missed after fill" );
+
+    if ( (got.op != Opcode::add) || (got.A != 1) || (got.B != 2) || (got.result != 3) )
+        errExit( "cache returned the wrong instruction" );
+
+    // unaligned addresses are never cached
+    DUT.fill( 13, inst );
+    if ( DUT.lookup( 13, got ) )
+        errExit( "unaligned address hit" );
+
+    // addresses past the end are ignored
+    DUT.fill( 64, inst );
+    if ( DUT.lookup( 64, got ) )
+        errExit( "address past the end hit" );
+
+    // an unaligned write covers two words
+    DUT.fill( 12, inst );
+    DUT.invalidate( 10 );
+    if ( DUT.lookup( 8, got ) || DUT.lookup( 12, got ) )
+        errExit( "unaligned invalidate missed an entry" );
+
+    if ( (DUT.getHits() != 1) || (DUT.getMisses() != 5) )
+        errExit( "hit and miss counters are wrong" );
+
+    debug( "DecodeCache unit tests passed" );
+
+    // the demo program spends nearly all of its time in one loop so nearly everything should hit
+    CPU cpu( demoProgram( false ) );
+    while ( !cpu.clockTick() );
+
+    uint64_t hits = cpu.getDecodeCacheHits();
+    uint64_t misses = cpu.getDecodeCacheMisses();
+    debug( "demo program decode cache hits: " + std::to_string( hits ) + " misses: " + std::to_string( misses ) );
+
+    if ( misses > 40 ) // one per instruction in the program
+        errExit( "decode cache missed on the same instruction more than once" );
+
+    if ( hits < 100 * misses )
+        errExit( "decode cache is not being used" );
+
+    debug( "All DecodeCache tests passed" );
+    return EXIT_SUCCESS;
+}
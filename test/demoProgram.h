@@ -0,0 +1,31 @@
+// builds the machine code for the "Hello World!" demo so that it can be shared between 
+//      the demo and the benchmarks, and assembles the programs the tests write themselves
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#ifndef DEMO_PROGRAM_H
+#define DEMO_PROGRAM_H
+
+#include <stdint.h>
+#include <vector>
+
+class Instruction;
+
+// if printFrames is false then printBuffer is replaced by a nop. This takes the same number
+//      of cycles so it is useful for timing the cpu without timing the terminal
+std::vector<int32_t> demoProgram( bool printFrames );
+
+// the machine code for program, one word for each instruction
+std::vector<int32_t> assemble( const std::vector<Instruction> &program );
+
+#endif
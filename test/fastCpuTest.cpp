@@ -0,0 +1,213 @@
+// tests that FastCPU gets the same results as CPU in the same number of cycles
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../cpu/CPU.h"
+#include "../cpu/FastCPU.h"
+#include "../emulator/debug.h"
+#include "demoProgram.h"
+#include "../assembler/Instruction.h"
+#include <vector>
+#include <string>
+#include <stdlib.h>
+#include <stdint.h>
+
+using namespace std;
+
+// FastCPU::run should give the same fault as CPU::run (apart from reading registers or memory which
+//      were never written, which only CPU notices)
+static void faultTest( const char* name, const vector<Instruction> &program ) {
+    vector<int32_t> machineCode = assemble( program );
+
+    CPU reference( machineCode );
+    FastCPU DUT( machineCode );
+    if ( (reference.run() != RunStatus::faulted) || (DUT.run() != RunStatus::faulted) )
+        errExit( string( "fault test " ) + name + ": did not fault" );
+
+    const CPUFault &expected = reference.getFault();
+    const CPUFault &fault = DUT.getFault();
+    if ( (fault.kind != expected.kind) || (fault.pc != expected.pc) || (fault.cycle != expected.cycle) ||
+            (DUT.getCycleCount() != fault.cycle) )
+        errExit( string( "fault test " ) + name + ": FastCPU faulted at pc " + to_string( fault.pc ) + " cycle "
+                + to_string( fault.cycle ) + ", CPU at pc " + to_string( expected.pc ) + " cycle "
+                + to_string( expected.cycle ) );
+
+    if ( !DUT.hasFaulted() || (DUT.run() != RunStatus::faulted) )
+        errExit( string( "fault test " ) + name + ": carried on after a fault" );
+
+    debug( string( "fault test " ) + name + " passed" );
+}
+
+static void faultTests( void ) {
+    vector<Instruction> invalid;
+    invalid.push_back( Instruction( Opcode::nop ) );
+    invalid.push_back( Instruction( (int32_t) 0x1F ) ); // not an opcode
+    faultTest( "invalid opcode", invalid );
+
+    vector<Instruction> badLoad;
+    badLoad.push_back( Instruction( Opcode::addImmediate, 0, 20000 ) );
+    badLoad.push_back( Instruction( Opcode::add, 1, 0, 5 ) );
+    badLoad.push_back( Instruction( Opcode::load, 5, (uint8_t) 6 ) );
+    badLoad.push_back( Instruction( Opcode::halt ) );
+    faultTest( "bad load", badLoad );
+
+    // the second half of a fused pair
+    vector<Instruction> fusedLoad;
+    fusedLoad.push_back( Instruction( Opcode::nop ) );
+    fusedLoad.push_back( Instruction( Opcode::addImmediate, 0, 20000 ) );
+    fusedLoad.push_back( Instruction( Opcode::load, 1, (uint8_t) 6 ) );
+    fusedLoad.push_back( Instruction( Opcode::halt ) );
+    faultTest( "fused bad load", fusedLoad );
+
+    // storing r2 to address -8. r2 is written first so that CPU does not find it undefined
+    vector<Instruction> fusedStore;
+    fusedStore.push_back( Instruction( Opcode::addImmediate, 0, 9000 ) );
+    fusedStore.push_back( Instruction( Opcode::add, 1, 0, 2 ) );
+    fusedStore.push_back( Instruction( Opcode::addImmediate, 0, -8 ) );
+    fusedStore.push_back( Instruction( Opcode::store, 1, (uint8_t) 2 ) );
+    fusedStore.push_back( Instruction( Opcode::halt ) );
+    faultTest( "fused bad store", fusedStore );
+
+    vector<Instruction> badJump;
+    badJump.push_back( Instruction( Opcode::addImmediate, 0, 20000 ) );
+    badJump.push_back( Instruction( Opcode::jumpToReg, 1 ) );
+    faultTest( "bad jump", badJump );
+
+    vector<Instruction> noFlags;
+    noFlags.push_back( Instruction( Opcode::nop ) );
+    noFlags.push_back( Instruction( Opcode::branchIfZero, 0 ) );
+    faultTest( "branch before the flags are set", noFlags );
+}
+
+int main( void ) {
+    debug( "Beginning FastCPU tests" );
+
+    vector<int32_t> machineCode = demoProgram( false );
+
+    // clock both cpus together. They should halt on the same cycle
+    CPU reference( machineCode );
+    FastCPU DUT( machineCode );
+
+    bool referenceHalted = false;
+    bool DUTHalted = false;
+    while ( !referenceHalted ) {
+        referenceHalted = reference.clockTick();
+        DUTHalted = DUT.clockTick();
+
+        if ( referenceHalted != DUTHalted )
+            errExit( "FastCPU::clockTick did not halt on the same cycle as CPU" );
+    }
+
+    if ( reference.getCycleCount() != DUT.getCycleCount() )
+        errExit( "FastCPU counted a different number of cycles" );
+
+    // the program and all of the video memory
+    for ( unsigned int addr = 0; addr < machineCode.size() * sizeof(int32_t); addr += sizeof(int32_t) ) {
+        if ( reference.debugRamRead( addr ) != DUT.debugRamRead( addr ) )
+            errExit( "FastCPU main memory is different to CPU" );
+    }
+
+    for ( unsigned int addr = mainMemoryBytes; addr < ramBytes; addr += sizeof(int32_t) ) {
+        if ( reference.debugRamRead( addr ) != DUT.debugRamRead( addr ) )
+            errExit( "FastCPU video memory is different to CPU" );
+    }
+    debug( "FastCPU::clockTick matches CPU" );
+
+    // running whole instructions should count the same cycles
+    FastCPU DUT2( machineCode );
+    if ( DUT2.run() != RunStatus::halted )
+        errExit( "FastCPU::run did not halt" );
+
+    if ( DUT2.getCycleCount() != reference.getCycleCount() )
+        errExit( "FastCPU::run counted a different number of cycles" );
+
+    for ( unsigned int addr = mainMemoryBytes; addr < ramBytes; addr += sizeof(int32_t) ) {
+        if ( DUT2.debugRamRead( addr ) != reference.debugRamRead( addr ) )
+            errExit( "FastCPU::run video memory is different to CPU" );
+    }
+    debug( "FastCPU::run matches CPU" );
+
+    // every frame printed by the demo program should be the same
+    vector<int32_t> withFrames = demoProgram( true );
+    CPU framesReference( withFrames );
+    FrameHashLog referenceLog;
+    framesReference.setVideoOutput( referenceLog );
+    while ( !framesReference.clockTick() );
+
+    FastCPU framesDUT( withFrames );
+    FrameHashLog log;
+    framesDUT.setVideoOutput( log );
+    framesDUT.run();
+
+    if ( referenceLog.getHashes().empty() || (log.firstDifference( referenceLog.getHashes() ) != FrameHashLog::npos) )
+        errExit( "FastCPU printed different frames to CPU" );
+
+    // a log with a frame missing is different from the frame which is missing
+    vector<uint64_t> shorter( referenceLog.getHashes().begin(), referenceLog.getHashes().end() - 1 );
+    if ( log.firstDifference( shorter ) != shorter.size() )
+        errExit( "FrameHashLog::firstDifference did not notice a missing frame" );
+    debug( "FastCPU printed the same " + std::to_string( log.getHashes().size() ) + " frames as CPU" );
+
+    // the demo program is mostly made of things which can be fused
+    FusionStats stats = DUT2.getFusionStats();
+    uint64_t fusedInstructions = 0;
+    for ( unsigned int i = 0; i < static_cast<unsigned int>(Fusion::numFusions); i++ )
+        fusedInstructions += 2 * stats.fused[i];
+
+    debug( "demo program fused " + std::to_string( fusedInstructions ) + " of "
+            + std::to_string( stats.instructions ) + " instructions" );
+
+    if ( (stats.fused[ static_cast<unsigned int>(Fusion::addImmediateCopy) ] == 0)
+            || (stats.fused[ static_cast<unsigned int>(Fusion::addImmediateLoad) ] == 0)
+            || (stats.fused[ static_cast<unsigned int>(Fusion::addImmediateStore) ] == 0) )
+        errExit( "FastCPU::run did not fuse the demo program" );
+
+    // write over the second half of a fused pair after it has been run
+    vector<Instruction> I;
+    I.push_back( Instruction( Opcode::addImmediate, 0, 15*4 ) );     // r5 = new instruction
+    I.push_back( Instruction( Opcode::load, 1, (uint8_t) 5 ) );
+    I.push_back( Instruction( Opcode::addImmediate, 0, 8*4 ) );      // r6 = address of TARGET
+    I.push_back( Instruction( Opcode::add, 1, 0, 6 ) );
+    I.push_back( Instruction( Opcode::addImmediate, 0, 9*4 ) );      // r10 = address of TARGET + 4
+    I.push_back( Instruction( Opcode::add, 1, 0, 10 ) );
+    I.push_back( Instruction( Opcode::addImmediate, 0, 14*4 ) );     // r9 = address of halt
+    I.push_back( Instruction( Opcode::add, 1, 0, 9 ) );
+
+    I.push_back( Instruction( Opcode::addImmediate, 0, 300 ) );      // TARGET: r7 = 300, then r7 = 0
+    I.push_back( Instruction( Opcode::add, 1, 0, 7 ) );
+    I.push_back( Instruction( Opcode::subImmediate, 7, 0 ) );        // halt if r7 == 0
+    I.push_back( Instruction( Opcode::branchIfZero, 9 ) );
+    I.push_back( Instruction( Opcode::store, (uint8_t) 10, (uint8_t) 5 ) ); // TARGET + 4 = add r0, r0 -> r7
+    I.push_back( Instruction( Opcode::jumpToReg, 6 ) );
+    I.push_back( Instruction( Opcode::halt ) );
+    // loading byte swaps and storing does not so this is swapped in advance
+    I.push_back( Instruction( static_cast<int32_t>( Instruction( Opcode::add, 0, 0, 7 ).getObjectCode() ) ) );
+
+    vector<int32_t> selfModifying = assemble( I );
+
+    CPU selfModifyingReference( selfModifying );
+    while ( !selfModifyingReference.clockTick() );
+
+    FastCPU selfModifyingDUT( selfModifying );
+    if ( selfModifyingDUT.run( 10 * selfModifyingReference.getCycleCount() ) != RunStatus::halted )
+        errExit( "FastCPU::run used a fused instruction after it was written over" );
+
+    if ( selfModifyingDUT.getCycleCount() != selfModifyingReference.getCycleCount() )
+        errExit( "FastCPU::run counted a different number of cycles for self modifying code" );
+    debug( "FastCPU::run works with self modifying code" );
+
+    faultTests();
+
+    debug( "All FastCPU tests passed" );
+    return EXIT_SUCCESS;
+}
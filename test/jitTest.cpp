@@ -0,0 +1,170 @@
+// tests that JitCPU gets the same results as CPU in the same number of cycles
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../cpu/CPU.h"
+#include "../cpu/JitCPU.h"
+#include "../emulator/debug.h"
+#include "demoProgram.h"
+#include "../assembler/Instruction.h"
+#include <vector>
+#include <string>
+#include <stdlib.h>
+#include <stdint.h>
+
+using namespace std;
+
+// run machineCode on CPU and JitCPU and check they halt after the same number of cycles with the same memory
+static void compareWithCPU( const vector<int32_t> &machineCode, const string &name ) {
+    CPU reference( machineCode );
+    while ( !reference.clockTick() );
+
+    JitCPU DUT( machineCode );
+    if ( !DUT.run( 10 * reference.getCycleCount() ) )
+        errExit( "JitCPU did not halt running " + name );
+
+    if ( DUT.getCycleCount() != reference.getCycleCount() )
+        errExit( "JitCPU counted " + to_string( DUT.getCycleCount() ) + " cycles running " + name
+                + " but CPU counted " + to_string( reference.getCycleCount() ) );
+
+    for ( unsigned int addr = 0; addr < machineCode.size() * sizeof(int32_t); addr += sizeof(int32_t) ) {
+        if ( reference.debugRamRead( addr ) != DUT.debugRamRead( addr ) )
+            errExit( "JitCPU main memory is different to CPU after running " + name );
+    }
+
+    for ( unsigned int addr = mainMemoryBytes; addr < ramBytes; addr += sizeof(int32_t) ) {
+        if ( reference.debugRamRead( addr ) != DUT.debugRamRead( addr ) )
+            errExit( "JitCPU video memory is different to CPU after running " + name );
+    }
+
+    debug( "JitCPU matches CPU running " + name );
+}
+
+int main( void ) {
+    debug( "Beginning JitCPU tests" );
+
+    if ( !JitCPU::isSupported() ) {
+        debug( "JitCPU is not supported on this host. Skipping" );
+        return EXIT_SUCCESS;
+    }
+
+    vector<int32_t> machineCode = demoProgram( false );
+    compareWithCPU( machineCode, "the demo program" );
+
+    // blocks should be chained together so we hardly ever come back out to run()
+    JitCPU chained( machineCode );
+    chained.run();
+    JitStats stats = chained.getStats();
+    debug( "demo program: " + to_string( stats.blocksTranslated ) + " blocks, "
+            + to_string( stats.chainsPatched ) + " chains, " + to_string( stats.exits ) + " exits" );
+
+    if ( (stats.chainsPatched == 0) || (stats.exits > 10 * stats.blocksTranslated) )
+        errExit( "JitCPU did not chain the blocks of the demo program" );
+
+    // stopping at the cycle limit and carrying on should not change anything
+    JitCPU stopStart( machineCode );
+    uint64_t limit = 0;
+    unsigned int stops = 0;
+    while ( !stopStart.run( limit ) ) {
+        if ( stopStart.getCycleCount() < limit )
+            errExit( "JitCPU::run stopped before the cycle limit" );
+
+        limit += 997;
+        stops++;
+    }
+
+    if ( stopStart.getCycleCount() != chained.getCycleCount() )
+        errExit( "JitCPU counted different cycles when stopped and started" );
+
+    for ( unsigned int addr = mainMemoryBytes; addr < ramBytes; addr += sizeof(int32_t) ) {
+        if ( stopStart.debugRamRead( addr ) != chained.debugRamRead( addr ) )
+            errExit( "JitCPU video memory is different when stopped and started" );
+    }
+    debug( "JitCPU stopped and started " + to_string( stops ) + " times" );
+
+    // the instruction at TARGET is run, written over with a different instruction and then run again.
+    //      the second run must not use the old translation
+    vector<Instruction> I;
+    I.push_back( Instruction( Opcode::addImmediate, 0, 17*4 ) );     // r5 = the new instruction
+    I.push_back( Instruction( Opcode::load, 1, (uint8_t) 5 ) );
+    I.push_back( Instruction( Opcode::addImmediate, 0, 8*4 ) );      // r6 = address of TARGET
+    I.push_back( Instruction( Opcode::add, 1, 0, 6 ) );
+    I.push_back( Instruction( Opcode::addImmediate, 0, 200 ) );      // r7 = where to store the results
+    I.push_back( Instruction( Opcode::add, 1, 0, 7 ) );
+    I.push_back( Instruction( Opcode::addImmediate, 0, 16*4 ) );     // r9 = address of halt
+    I.push_back( Instruction( Opcode::add, 1, 0, 9 ) );
+
+    I.push_back( Instruction( Opcode::addImmediate, 0, 11 ) );       // TARGET: r1 = 11, then 77
+    I.push_back( Instruction( Opcode::store, (uint8_t) 7, (uint8_t) 1 ) );
+    I.push_back( Instruction( Opcode::subImmediate, 1, 77 ) );       // halt if this was the second time
+    I.push_back( Instruction( Opcode::branchIfZero, 9 ) );
+
+    I.push_back( Instruction( Opcode::store, (uint8_t) 6, (uint8_t) 5 ) ); // write over TARGET
+    I.push_back( Instruction( Opcode::addImmediate, 7, 4 ) );
+    I.push_back( Instruction( Opcode::add, 1, 0, 7 ) );
+    I.push_back( Instruction( Opcode::jumpToReg, 6 ) );
+
+    I.push_back( Instruction( Opcode::halt ) );
+    // loading byte swaps and storing does not so this is swapped in advance
+    I.push_back( Instruction( static_cast<int32_t>( Instruction( Opcode::addImmediate, 0, 77 ).getObjectCode() ) ) );
+
+    vector<int32_t> selfModifying = assemble( I );
+    compareWithCPU( selfModifying, "self modifying code" );
+
+    JitCPU selfModifyingDUT( selfModifying );
+    selfModifyingDUT.run();
+    if ( (selfModifyingDUT.debugRamRead( 200 ) != 11) || (selfModifyingDUT.debugRamRead( 204 ) != 77) )
+        errExit( "JitCPU ran an old translation of self modifying code" );
+
+    // a store to the instruction straight after it, in the same block
+    vector<Instruction> sameBlock;
+    sameBlock.push_back( Instruction( Opcode::addImmediate, 0, 7*4 ) );  // r5 = the new instruction
+    sameBlock.push_back( Instruction( Opcode::load, 1, (uint8_t) 5 ) );
+    sameBlock.push_back( Instruction( Opcode::addImmediate, 0, 5*4 ) );  // r6 = address of NEXT
+    sameBlock.push_back( Instruction( Opcode::add, 1, 0, 6 ) );
+    sameBlock.push_back( Instruction( Opcode::store, (uint8_t) 6, (uint8_t) 5 ) );
+    sameBlock.push_back( Instruction( Opcode::addImmediate, 0, 1 ) );    // NEXT: becomes r1 = 99
+    sameBlock.push_back( Instruction( Opcode::halt ) );
+    sameBlock.push_back( Instruction( static_cast<int32_t>( Instruction( Opcode::addImmediate, 0, 99 ).getObjectCode() ) ) );
+    compareWithCPU( assemble( sameBlock ), "a store to the next instruction" );
+
+    // every kind of instruction and both ways through a branch
+    vector<Instruction> everything;
+    everything.push_back( Instruction( Opcode::addImmediate, 0, 5 ) );
+    everything.push_back( Instruction( Opcode::add, 1, 0, 2 ) );        // r2 = 5
+    everything.push_back( Instruction( Opcode::subImmediate, 0, 9 ) );
+    everything.push_back( Instruction( Opcode::add, 1, 0, 3 ) );        // r3 = -9
+    everything.push_back( Instruction( Opcode::sub, 2, 3, 4 ) );        // r4 = 14
+    everything.push_back( Instruction( Opcode::nand, 3, 4, 5 ) );
+    everything.push_back( Instruction( Opcode::lshift, 3, 2, 6 ) );
+    everything.push_back( Instruction( Opcode::nop ) );
+    everything.push_back( Instruction( Opcode::addImmediate, 0, 400 ) );
+    everything.push_back( Instruction( Opcode::store, (uint8_t) 1, (uint8_t) 6 ) );
+    everything.push_back( Instruction( Opcode::load, 1, (uint8_t) 7 ) );
+    everything.push_back( Instruction( Opcode::addImmediate, 0, 16*4 ) ); // r8 = address of halt
+    everything.push_back( Instruction( Opcode::add, 1, 0, 8 ) );
+    everything.push_back( Instruction( Opcode::subImmediate, 2, 1 ) );  // positive so not zero
+    everything.push_back( Instruction( Opcode::branchIfZero, 8 ) );
+    everything.push_back( Instruction( Opcode::branchIfPositive, 8 ) );
+    everything.push_back( Instruction( Opcode::halt ) );
+    compareWithCPU( assemble( everything ), "every instruction" );
+
+    // check that printBuffer manages to return
+    vector<Instruction> printBuffer;
+    printBuffer.push_back( Instruction( Opcode::printBuffer ) );
+    printBuffer.push_back( Instruction( Opcode::halt ) );
+    compareWithCPU( assemble( printBuffer ), "printBuffer" );
+
+    debug( "All JitCPU tests passed" );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+// checks LevelizedCPU against CPU one clock tick at a time
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../cpu/CPU.h"
+#include "../cpu/LevelizedCPU.h"
+#include "../emulator/debug.h"
+#include "../assembler/Instruction.h"
+#include "../cpu/Opcodes.h"
+#include "demoProgram.h"
+#include "aotPrograms.h"
+#include <vector>
+#include <string>
+#include <stdlib.h>
+#include <stdint.h>
+
+using namespace std;
+
+// uses every instruction, including loads from video memory and writes to r0
+static vector<int32_t> everyInstructionProgram( void ) {
+    vector<Instruction> program;
+    program.push_back( Instruction( Opcode::nop ) );
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 12 ) );
+    program.push_back( Instruction( Opcode::add, 0, 1, 2 ) );                           // r2 = 12
+    program.push_back( Instruction( Opcode::subImmediate, (uint8_t) 2, (int32_t) 5 ) ); // r1 = 7
+    program.push_back( Instruction( Opcode::sub, 2, 1, 3 ) );                           // r3 = 5
+    program.push_back( Instruction( Opcode::nand, 2, 3, 4 ) );
+    program.push_back( Instruction( Opcode::lshift, 3, 1, 5 ) );
+    program.push_back( Instruction( Opcode::add, 2, 3, 0 ) );                           // ignored
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 6144 ) );
+    program.push_back( Instruction( Opcode::load, (uint8_t) 1, (uint8_t) 6 ) );         // video memory
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 31 * 4 ) );
+    program.push_back( Instruction( Opcode::store, (uint8_t) 1, (uint8_t) 4 ) );
+    program.push_back( Instruction( Opcode::store, (uint8_t) 1, (uint8_t) 5 ) );
+    program.push_back( Instruction( Opcode::load, (uint8_t) 1, (uint8_t) 7 ) );
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 32 * 4 ) );
+    program.push_back( Instruction( Opcode::store, (uint8_t) 1, (uint8_t) 7 ) );
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 33 * 4 ) );
+    program.push_back( Instruction( Opcode::store, (uint8_t) 1, (uint8_t) 6 ) );
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 24 * 4 ) );
+    program.push_back( Instruction( Opcode::add, 0, 1, 8 ) );                           // r8 = skip
+    program.push_back( Instruction( Opcode::sub, 2, 2, 9 ) );                           // zero
+    program.push_back( Instruction( Opcode::branchIfPositive, 8 ) );                    // taken
+    program.push_back( Instruction( Opcode::halt ) );                                   // not reached
+    program.push_back( Instruction( Opcode::halt ) );                                   // not reached
+    // skip:
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 29 * 4 ) );
+    program.push_back( Instruction( Opcode::branchIfZero, 1 ) );                        // not taken
+    program.push_back( Instruction( Opcode::sub, 2, 2, 9 ) );
+    program.push_back( Instruction( Opcode::branchIfZero, 1 ) );                        // taken
+    program.push_back( Instruction( Opcode::halt ) );                                   // not reached
+    program.push_back( Instruction( Opcode::printBuffer ) );
+    program.push_back( Instruction( Opcode::halt ) );
+
+    // data written by the stores
+    program.push_back( Instruction( (int32_t) 0 ) );
+    program.push_back( Instruction( (int32_t) 0 ) );
+    program.push_back( Instruction( (int32_t) 0 ) );
+
+    return assemble( program );
+}
+
+// run CPU and LevelizedCPU side by side and check they agree after every clock tick
+static void lockstep( const vector<int32_t> &machineCode, const string &name ) {
+    CPU reference( machineCode );
+    LevelizedCPU DUT( machineCode );
+
+    bool halted = false;
+    while ( !halted ) {
+        halted = reference.clockTick();
+        string cycle = to_string( reference.getCycleCount() );
+
+        if ( DUT.clockTick() != halted )
+            errExit( "LevelizedCPU halted at a different time to CPU running " + name + " (cycle " + cycle + ")" );
+
+        if ( DUT.getCycleCount() != reference.getCycleCount() )
+            errExit( "LevelizedCPU counted different cycles to CPU running " + name );
+
+        if ( DUT.getControlUnitState() != reference.getControlUnitState() )
+            errExit( "LevelizedCPU is in a different state to CPU running " + name + " (cycle " + cycle + ")" );
+
+        if ( !halted && (DUT.getProgramCounter() != reference.getProgramCounter()) )
+            errExit( "LevelizedCPU has a different program counter to CPU running " + name + " (cycle " + cycle + ")" );
+    }
+
+    for ( unsigned int addr = 0; addr < machineCode.size() * sizeof(int32_t); addr += sizeof(int32_t) ) {
+        if ( reference.debugRamRead( addr ) != DUT.debugRamRead( addr ) )
+            errExit( "LevelizedCPU main memory is different to CPU after running " + name );
+    }
+
+    for ( unsigned int addr = mainMemoryBytes; addr < ramBytes; addr += sizeof(int32_t) ) {
+        if ( reference.debugRamRead( addr ) != DUT.debugRamRead( addr ) )
+            errExit( "LevelizedCPU video memory is different to CPU after running " + name );
+    }
+
+    debug( "LevelizedCPU matches CPU for " + to_string( reference.getCycleCount() ) + " cycles running " + name );
+}
+
+int main( void ) {
+    debug( "Beginning LevelizedCPU tests" );
+
+    lockstep( everyInstructionProgram(), "every instruction" );
+    lockstep( demoProgram( false ), "the demo program" );
+    lockstep( selfModifyingProgram(), "self modifying code" );
+    lockstep( computedJumpProgram(), "a computed jump" );
+
+    debug( "All LevelizedCPU tests passed" );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,268 @@
+// tests for LockstepCPU: every lane must end up the same as FastCPU running that lane on its own
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../cpu/LockstepCPU.h"
+#include "../cpu/FastCPU.h"
+#include "../emulator/debug.h"
+#include "../assembler/Instruction.h"
+#include "../cpu/Opcodes.h"
+#include "demoProgram.h"
+#include "aotPrograms.h"
+#include <memory>
+#include <vector>
+#include <string>
+#include <stdlib.h>
+#include <stdint.h>
+
+using namespace std;
+
+// word addresses in loopProgram
+const unsigned int loopData = 22;
+const unsigned int loopAccumulate = 13;
+
+// loops for as many times as the word at loopData says, using every ALU operation
+// lanes given a different count go round a different number of times
+static vector<int32_t> loopProgram( int32_t count ) {
+    vector<Instruction> I;
+    I.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) loopData * 4 ) );
+    I.push_back( Instruction( Opcode::load, 1, (uint8_t) 5 ) );                          // r5 = count
+    I.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 8 * 4 ) );    // r6 = LOOP
+    I.push_back( Instruction( Opcode::add, 1, 0, 6 ) );
+    I.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 17 * 4 ) );   // r7 = END
+    I.push_back( Instruction( Opcode::add, 1, 0, 7 ) );
+    I.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 3 ) );        // r8 = 3
+    I.push_back( Instruction( Opcode::add, 1, 0, 8 ) );
+
+    I.push_back( Instruction( Opcode::sub, 0, 5, 0 ) );                                  // LOOP: done if r5 <= 0
+    I.push_back( Instruction( Opcode::branchIfPositive, 7 ) );
+    I.push_back( Instruction( Opcode::add, 9, 5, 9 ) );
+    I.push_back( Instruction( Opcode::nand, 9, 8, 10 ) );
+    I.push_back( Instruction( Opcode::lshift, 10, 5, 11 ) );
+    I.push_back( Instruction( Opcode::add, 12, 11, 12 ) );                               // loopAccumulate
+    I.push_back( Instruction( Opcode::subImmediate, (uint8_t) 5, (int32_t) 1 ) );
+    I.push_back( Instruction( Opcode::add, 1, 0, 5 ) );
+    I.push_back( Instruction( Opcode::jumpToReg, 6 ) );
+
+    I.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 23 * 4 ) );   // END: store results
+    I.push_back( Instruction( Opcode::store, (uint8_t) 1, (uint8_t) 12 ) );
+    I.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 24 * 4 ) );
+    I.push_back( Instruction( Opcode::store, (uint8_t) 1, (uint8_t) 9 ) );
+    I.push_back( Instruction( Opcode::halt ) );
+
+    I.push_back( Instruction( count ) );                                                 // loopData
+    I.push_back( Instruction( (int32_t) 0 ) );
+    I.push_back( Instruction( (int32_t) 0 ) );
+
+    return assemble( I );
+}
+
+// run images on LockstepCPU and check every lane against FastCPU
+// returns the stats so that the caller can check how well the lanes stayed together
+template <unsigned int numLanes>
+static LockstepStats checkLanes( const vector< vector<int32_t> > &images, bool useSimd, const string &name ) {
+    unique_ptr< LockstepCPU<numLanes> > DUT( new LockstepCPU<numLanes>( images, useSimd ) );
+    NullVideo video;
+    DUT->setVideoOutput( video );
+
+    if ( DUT->run() != RunStatus::halted )
+        errExit( "LockstepCPU did not halt running " + name );
+
+    NullVideo referenceVideo;
+    for ( unsigned int lane = 0; lane < numLanes; lane++ ) {
+        if ( lane >= images.size() ) {
+            if ( DUT->getCycleCount( lane ) != 0 )
+                errExit( "LockstepCPU ran a lane without an image running " + name );
+            continue;
+        }
+
+        string where = name + " (lane " + to_string( lane ) + ")";
+        unique_ptr<FastCPU> reference( new FastCPU( images[lane] ) );
+        reference->setVideoOutput( referenceVideo );
+        reference->run();
+
+        if ( !DUT->isHalted( lane ) )
+            errExit( "LockstepCPU lane did not halt running " + where );
+
+        if ( DUT->getCycleCount( lane ) != reference->getCycleCount() )
+            errExit( "LockstepCPU counted different cycles to FastCPU running " + where );
+
+        for ( unsigned int addr = 0; addr < ramBytes; addr += sizeof(int32_t) ) {
+            if ( (addr > mainMemoryBytes - sizeof(int32_t)) && (addr < mainMemoryBytes) )
+                continue;
+
+            if ( DUT->debugRamRead( lane, addr ) != reference->debugRamRead( addr ) )
+                errExit( "LockstepCPU memory is different to FastCPU at " + to_string( addr ) + " running " + where );
+        }
+    }
+
+    if ( video.getFrames() != referenceVideo.getFrames() )
+        errExit( "LockstepCPU printed a different number of frames to FastCPU running " + name );
+
+    if ( DUT->usingSimd() != useSimd )
+        errExit( "LockstepCPU did not use AVX2 when it was asked to running " + name );
+
+    LockstepStats stats = DUT->getStats();
+
+    debug( "LockstepCPU<" + to_string( numLanes ) + "> matches FastCPU running " + name
+           + ( DUT->usingSimd() ? " with AVX2" : " without AVX2" ) );
+    return stats;
+}
+
+template <unsigned int numLanes>
+static void testCopies( const vector<int32_t> &image, bool useSimd, const string &name ) {
+    vector< vector<int32_t> > images( numLanes, image );
+    LockstepStats stats = checkLanes<numLanes>( images, useSimd, name );
+
+    // nothing makes the lanes go different ways
+    if ( stats.laneInstructions != stats.issues * numLanes )
+        errExit( "LockstepCPU lanes did not stay together running copies of " + name );
+}
+
+static void testLanes( bool useSimd ) {
+    testCopies<8>( demoProgram( false ), useSimd, "the demo program" );
+    testCopies<8>( demoProgram( true ), useSimd, "the demo program with frames" );
+    testCopies<8>( selfModifyingProgram(), useSimd, "self modifying code" );
+    testCopies<16>( computedJumpProgram(), useSimd, "a computed jump" );
+
+    // each lane goes round the loop a different number of times
+    const int32_t counts[] = { 0, 1, 2, 3, 5, 8, 13, -4, 40, 7, 7, 1, 100, 2, 31, 33 };
+    vector< vector<int32_t> > images;
+    for ( unsigned int i = 0; i < 16; i++ )
+        images.push_back( loopProgram( counts[i] ) );
+
+    LockstepStats stats = checkLanes<16>( images, useSimd, "loops of different lengths" );
+    if ( stats.laneInstructions == stats.issues * 16 )
+        errExit( "LockstepCPU lanes did not diverge running loops of different lengths" );
+
+    // fewer images than lanes
+    images.resize( 5 );
+    checkLanes<8>( images, useSimd, "five lanes out of eight" );
+
+    // the odd lanes subtract instead of adding, so the lanes do not have the same code
+    images.clear();
+    for ( unsigned int i = 0; i < 8; i++ )
+        images.push_back( loopProgram( counts[i] ) );
+    for ( unsigned int i = 1; i < 8; i += 2 )
+        images[i][loopAccumulate] = Instruction( Opcode::sub, 12, 11, 12 ).getObjectCode();
+    checkLanes<8>( images, useSimd, "lanes with different code" );
+}
+
+// lanes stop at maxCycles if they do not halt
+static void testMaxCycles( void ) {
+    vector< vector<int32_t> > images;
+    images.push_back( loopProgram( 3 ) );
+    images.push_back( vector<int32_t>( 1, Instruction( Opcode::jumpToReg, 0 ).getObjectCode() ) ); // forever
+    images.push_back( loopProgram( 10 ) );
+
+    unique_ptr< LockstepCPU<8> > DUT( new LockstepCPU<8>( images ) );
+    const uint64_t maxCycles = 10000;
+    if ( DUT->run( maxCycles ) != RunStatus::cycleLimit )
+        errExit( "LockstepCPU halted with a lane which runs forever" );
+
+    if ( DUT->isHalted( 1 ) || (DUT->getCycleCount( 1 ) < maxCycles) || (DUT->getCycleCount( 1 ) > maxCycles + 4) )
+        errExit( "LockstepCPU did not stop the lane which runs forever at maxCycles" );
+
+    for ( unsigned int lane = 0; lane < 3; lane += 2 ) {
+        unique_ptr<FastCPU> reference( new FastCPU( images[lane] ) );
+        reference->run();
+
+        if ( !DUT->isHalted( lane ) || (DUT->getCycleCount( lane ) != reference->getCycleCount()) )
+            errExit( "LockstepCPU lanes were held up by a lane which runs forever" );
+    }
+
+    debug( "LockstepCPU stops at maxCycles" );
+}
+
+// the lanes which fault stop with the same fault as FastCPU::run gives. The others carry on
+static void testFaults( bool useSimd ) {
+    vector< vector<int32_t> > images;
+    for ( unsigned int lane = 0; lane < 8; lane++ )
+        images.push_back( loopProgram( lane + 1 ) );
+
+    // lane 2 stores to address -8
+    vector<Instruction> badStore;
+    badStore.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) -8 ) );
+    badStore.push_back( Instruction( Opcode::store, (uint8_t) 1, (uint8_t) 1 ) );
+    badStore.push_back( Instruction( Opcode::halt ) );
+    images[2] = assemble( badStore );
+
+    // lane 3 finds something which is not an instruction once it has been round its loop
+    images[3][17] = Instruction( (int32_t) 0x1F ).getObjectCode();
+
+    // lane 5 loads from the address at loopData, which is in between main memory and video memory
+    images[5][loopData] = Instruction( (int32_t) mainMemoryBytes - 2 ).getObjectCode();
+    images[5][2] = Instruction( Opcode::load, 5, (uint8_t) 5 ).getObjectCode();
+
+    // lane 6 branches before the flags are set
+    images[6][0] = Instruction( Opcode::branchIfZero, 0 ).getObjectCode();
+
+    // lane 7 jumps past the end of memory
+    images[7][1] = Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 20000 ).getObjectCode();
+    images[7][2] = Instruction( Opcode::jumpToReg, 1 ).getObjectCode();
+
+    unique_ptr< LockstepCPU<8> > DUT( new LockstepCPU<8>( images, useSimd ) );
+    if ( DUT->run() != RunStatus::faulted )
+        errExit( "LockstepCPU did not report that lanes faulted" );
+
+    unsigned int faulted = 0;
+    for ( unsigned int lane = 0; lane < 8; lane++ ) {
+        string where = "lane " + to_string( lane ) + " of the fault test";
+        unique_ptr<FastCPU> reference( new FastCPU( images[lane] ) );
+
+        if ( reference->run() == RunStatus::halted ) {
+            if ( DUT->hasFaulted( lane ) || !DUT->isHalted( lane ) ||
+                    (DUT->getCycleCount( lane ) != reference->getCycleCount()) )
+                errExit( "LockstepCPU did not finish " + where );
+            continue;
+        }
+
+        const CPUFault &expected = reference->getFault();
+        if ( !DUT->hasFaulted( lane ) )
+            errExit( "LockstepCPU did not fault in " + where );
+
+        const CPUFault &fault = DUT->getFault( lane );
+        faulted++;
+        if ( (fault.kind != expected.kind) || (fault.pc != expected.pc) || (fault.cycle != expected.cycle) ||
+                (DUT->getCycleCount( lane ) != fault.cycle) )
+            errExit( "LockstepCPU faulted at pc " + to_string( fault.pc ) + " cycle " + to_string( fault.cycle )
+                     + " in " + where + ", FastCPU at pc " + to_string( expected.pc ) + " cycle "
+                     + to_string( expected.cycle ) );
+    }
+
+    if ( faulted != 5 )
+        errExit( "the fault test has " + to_string( faulted ) + " lanes which fault instead of 5" );
+
+    if ( DUT->run() != RunStatus::faulted )
+        errExit( "LockstepCPU carried on after the lanes faulted" );
+
+    debug( "LockstepCPU stopped the lanes which faulted and finished the others" );
+}
+
+int main( void ) {
+    debug( "Beginning LockstepCPU tests" );
+
+    testLanes( false );
+    testFaults( false );
+
+    if ( LockstepCPU<8>::simdSupported() ) {
+        testLanes( true );
+        testFaults( true );
+    } else
+        debug( "This host does not have AVX2 so only the portable ALU was tested" );
+
+    testMaxCycles();
+
+    debug( "All LockstepCPU tests passed" );
+    return EXIT_SUCCESS;
+}
@@ -56,6 +56,40 @@ int main( void ) {
 
     if (DUT2.getOutput() != 1 )
         errExit( "int 1" );
+
+    // the array backed version for enums
+    FixedMux<Key, int, 3> DUT3;
+    DUT3.setInput( Key::one, 1 );
+    DUT3.setInput( Key::two, 2 );
+    DUT3.setInput( Key::three, 3 );
+
+    DUT3.setSelect( Key::two );
+    if ( DUT3.getOutput() != 2 )
+        errExit( "fixed 2" );
+
+    DUT3.setSelect( Key::three );
+    if ( DUT3.getOutput() != 3 )
+        errExit( "fixed 3" );
+
+    // and for bools
+    FixedMux<bool, int, 2> DUT4;
+    DUT4.setInput( true, 10 );
+    DUT4.setInput( false, 20 );
+
+    DUT4.setSelect( true );
+    if ( DUT4.getOutput() != 10 )
+        errExit( "fixed true" );
+
+    DUT4.setSelect( false );
+    if ( DUT4.getOutput() != 20 )
+        errExit( "fixed false" );
+
+    // the inputs are combinational so they are gone by the next clock tick
+    advanceCombinationalEpoch();
+    DUT4.setInput( true, 30 );
+    DUT4.setSelect( true );
+    if ( DUT4.getOutput() != 30 )
+        errExit( "fixed next cycle" );
     
     debug( "All mux tests passed" );
     return EXIT_SUCCESS;
@@ -23,6 +23,23 @@
 
 #include <endian.h>
 
+// keeps the frame in a buffer of its own, like SharedVideo
+class DestinationVideo : public VideoOutput {
+    public:
+        int8_t buffer[ videoBytes ];
+        const int8_t* shown;
+
+        DestinationVideo( void ) : shown( NULL ) {}
+
+        int8_t* beginFrame( void ) {
+            return buffer;
+        }
+
+        void showFrame( const int8_t* frame ) {
+            shown = frame;
+        }
+};
+
 int main( void ) {
     debug( "Starting RamAddrTran test" );
 
@@ -80,6 +97,12 @@ int main( void ) {
         errExit( "RamAddrTran test failed. We did not read back what we wrote to video memory" );
     }
 
+    // printBuffer copies the video memory to where the output asks for it
+    DestinationVideo video;
+    DUT.printBuffer( video );
+    if ( (video.shown != video.buffer) || (memcmp( video.buffer, testData, 4 ) != 0) || (video.buffer[4] != '#') )
+        errExit( "RamAddrTran test failed. printBuffer did not put the frame where it was asked to" );
+
 
     debug( "All test passed for RamAddrTran" );
     return EXIT_SUCCESS;
@@ -17,11 +17,71 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <vector>
+#include <memory>
 #include "../assembler/Instruction.h"
 #include "../cpu/Opcodes.h"
 
 #include <endian.h>
 
+typedef RAM<uint32_t, 1024> TestRAM;
+
+static void write( TestRAM &DUT, uint32_t address, int32_t value ) {
+    DUT.setReadingThisCycle( false );
+    DUT.setAddress( address );
+    DUT.setDataIn( value );
+    DUT.clockTick();
+}
+
+// RAMs started from the same image only get their own copy of a page when they write to it
+static void sharedImageTests( void ) {
+    std::vector<int32_t> StartingData;
+    for ( unsigned int i = 0; i < 256; i++ )
+        StartingData.push_back( i );
+
+    std::shared_ptr< const RAMImage<1024> > image = std::make_shared< const RAMImage<1024> >( StartingData );
+    TestRAM first( image );
+    TestRAM second( image );
+
+    if ( (first.privatePages() != 0) || (second.privatePages() != 0) )
+        errExit( "a RAM copied a page before writing to it" );
+
+    write( first, 8, 1234 );
+    if ( (first.debugRead( 8 ) != 1234) || (second.debugRead( 8 ) != 2) || (first.privatePages() != 1) ||
+            (second.privatePages() != 0) )
+        errExit( "writing to one RAM changed another started from the same image" );
+
+    // over the end of the first page
+    write( second, RAM_PAGE_BYTES - 2, 5678 );
+    if ( (second.debugRead( RAM_PAGE_BYTES - 2 ) != 5678) || (second.privatePages() != 2) ||
+            (first.debugRead( RAM_PAGE_BYTES ) != static_cast<int32_t>(RAM_PAGE_BYTES / 4)) )
+        errExit( "unaligned write over the end of a page" );
+
+    // restoring the state from before the writes shares the pages again
+    std::unique_ptr< RAMState<1024> > state( new RAMState<1024> );
+    TestRAM fresh( image );
+    fresh.saveState( *state );
+    second.restoreState( *state );
+    if ( (second.privatePages() != 0) || (second.debugRead( RAM_PAGE_BYTES - 4 ) != 63) )
+        errExit( "restoring did not go back to sharing pages with the image" );
+
+    // the page written before saving is copied, the others are shared
+    write( first, 4, 99 );
+    first.saveState( *state );
+    second.restoreState( *state );
+    if ( (second.privatePages() != 1) || (second.debugRead( 4 ) != 99) || (second.debugRead( 8 ) != 1234) )
+        errExit( "restoring did not copy the pages which had been written" );
+
+    // a RAM with a different image cannot share any of them
+    std::shared_ptr< const RAMImage<1024> > otherImage =
+        std::make_shared< const RAMImage<1024> >( std::vector<int32_t>( 256, 7 ) );
+    TestRAM other( otherImage );
+    other.restoreState( *state );
+    if ( (other.privatePages() != TestRAM::numPages) || (other.debugRead( RAM_PAGE_BYTES * 2 ) != 128) )
+        errExit( "restoring a state from a RAM with a different image" );
+
+    debug( "shared image tests passed" );
+}
+
 int main( void ) {
     debug( "Starting RAM test" );
 
@@ -58,6 +118,8 @@ int main( void ) {
     if ( result != static_cast<int32_t>(htobe32(100)) )
         errExit( " RAM test failed. We did not read back what we wrote" );
 
+    sharedImageTests();
+
     debug( "All test passed for RAM" );
     return EXIT_SUCCESS;
 }
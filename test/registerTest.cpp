@@ -15,10 +15,12 @@
 #include "../emulator/Register.h"
 #include "../emulator/debug.h"
 #include <stdlib.h>
+#include <stdint.h>
 
-int main( void ) {
-    debug( "Beginning tests of Register Class" );
-    Register<bool> DUT;
+// the same tests for either checking policy
+template <typename Checking>
+void registerTests( void ) {
+    Register<bool, Checking> DUT;
 
     DUT.changeDriveSignal( true );
     DUT.clockTick();
@@ -34,6 +36,26 @@ int main( void ) {
     if ( DUT.getOutput() != true ) {
         errExit( "Register output changed too soon" );
     }
+}
+
+int main( void ) {
+    debug( "Beginning tests of Register Class" );
+    registerTests<Checked>();
+
+    debug( "Running the same tests with Unchecked signals" );
+    registerTests<Unchecked>();
+
+    // unchecked signals should not store anything but the value
+    static_assert( sizeof(Signal<int32_t, Unchecked>) == sizeof(int32_t), "Unchecked Signal has a defined flag" );
+    static_assert( sizeof(Register<int32_t, Unchecked>) == 2 * sizeof(int32_t), "Unchecked Register has defined flags" );
+
+    // nothing to check so reset and then reading gives whatever was there before
+    Register<int32_t, Unchecked> unchecked;
+    unchecked.changeDriveSignal( 7 );
+    unchecked.clockTick();
+    unchecked.reset();
+    if ( unchecked.getOutput() != 7 )
+        errExit( "Unchecked Register lost its value on reset" );
 
     debug( "All Register tests passed" );
 
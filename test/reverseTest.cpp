@@ -0,0 +1,236 @@
+// tests for ReverseDebugger: going backwards has to end up exactly where running forwards from the
+//     start would have
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../debugger/ReverseDebugger.h"
+#include "../cpu/CPU.h"
+#include "../cpu/Video.h"
+#include "../emulator/debug.h"
+#include "../assembler/Instruction.h"
+#include "../cpu/Opcodes.h"
+#include "demoProgram.h"
+#include <vector>
+#include <memory>
+#include <string>
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+using namespace std;
+
+// the start of an instruction
+struct Fetch {
+    uint64_t cycle;
+    int32_t pc;
+};
+
+// stores the count down to the same address every time round, so only one page is ever written
+static vector<int32_t> loopProgram( int32_t iterations ) {
+    vector<Instruction> program;
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, iterations ) );
+    program.push_back( Instruction( Opcode::add, 1, 0, 2 ) );                       // r2 = iterations
+    // loop (word 2):
+    program.push_back( Instruction( Opcode::subImmediate, (uint8_t) 2, (int32_t) 1 ) );
+    program.push_back( Instruction( Opcode::add, 1, 0, 2 ) );                       // r2--
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 4000 ) );
+    program.push_back( Instruction( Opcode::store, (uint8_t) 1, (uint8_t) 2 ) );
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 11 * 4 ) );
+    program.push_back( Instruction( Opcode::add, 2, 0, 10 ) );                      // flags from r2
+    program.push_back( Instruction( Opcode::branchIfZero, 1 ) );
+    program.push_back( Instruction( Opcode::addImmediate, (uint8_t) 0, (int32_t) 2 * 4 ) );
+    program.push_back( Instruction( Opcode::jumpToReg, 1 ) );
+    program.push_back( Instruction( Opcode::halt ) );
+
+    return assemble( program );
+}
+
+// every instruction started by a run of machineCode from the start to halt, and how long it took
+template <typename Checking>
+vector<Fetch> trace( const vector<int32_t> &machineCode, uint64_t &cycles ) {
+    BasicCPU<Checking> reference( machineCode );
+    NullVideo video;
+    reference.setVideoOutput( video );
+    vector<Fetch> fetches;
+
+    do {
+        if ( reference.getControlUnitState() == ControlUnitStateEnum::Fetch ) {
+            Fetch fetch = { reference.getCycleCount(), reference.getProgramCounter() };
+            fetches.push_back( fetch );
+        }
+    } while ( !reference.clockTick() );
+
+    cycles = reference.getCycleCount();
+    return fetches;
+}
+
+template <unsigned int numBytes>
+bool sameRam( const RAMState<numBytes> &a, const RAMState<numBytes> &b ) {
+    return (memcmp( a.cells, b.cells, numBytes ) == 0) && (memcmp( a.defined, b.defined, sizeof(a.defined) ) == 0);
+}
+
+template <typename Type>
+bool sameRegister( const RegisterState<Type> &a, const RegisterState<Type> &b ) {
+    if ( a.Q.defined != b.Q.defined )
+        return false;
+
+    return !a.Q.defined || (a.Q.value == b.Q.value);
+}
+
+// check DUT is the same as a CPU which has run machineCode from the start for as many cycles
+template <typename Checking>
+void checkState( BasicCPU<Checking> &DUT, const vector<int32_t> &machineCode, const string &name ) {
+    BasicCPU<Checking> reference( machineCode );
+    NullVideo video;
+    reference.setVideoOutput( video );
+
+    while ( (reference.getCycleCount() < DUT.getCycleCount()) && !reference.clockTick() );
+
+    unique_ptr<CPUState> expected( new CPUState );
+    unique_ptr<CPUState> actual( new CPUState );
+    reference.snapshot( *expected );
+    DUT.snapshot( *actual );
+
+    const CPUCoreState &a = actual->core;
+    const CPUCoreState &b = expected->core;
+    bool same = (a.cycleCount == b.cycleCount) && sameRegister( a.programCounter, b.programCounter ) &&
+        sameRegister( a.controlUnitState, b.controlUnitState ) && sameRegister( a.halted, b.halted ) &&
+        sameRegister( a.zero, b.zero ) && sameRegister( a.positive, b.positive ) &&
+        sameRam( actual->ram.mainMemory, expected->ram.mainMemory ) &&
+        sameRam( actual->ram.videoMemory, expected->ram.videoMemory );
+
+    for ( unsigned int i = 0; i < 32; i++ )
+        same = same && sameRegister( a.registers.registers[i], b.registers.registers[i] );
+
+    if ( !same )
+        errExit( name + ": not the same as running forwards to cycle " + to_string( DUT.getCycleCount() ) );
+}
+
+// the tests below run the demo program many times over, so the signal debug messages are thrown away
+//      (see reverseTests). This lets the results through
+static void passed( const string &test ) {
+    ScopedDebugStream loud( &cerr );
+    debug( test + " passed" );
+}
+
+template <typename Checking>
+void reverseTests( void ) {
+    ScopedDebugStream quiet( NULL );
+
+    vector<int32_t> demo = demoProgram( true );
+    uint64_t cycles;
+    vector<Fetch> fetches = trace<Checking>( demo, cycles );
+
+    // small enough that the oldest snapshots have to be merged
+    const size_t maxBytes = 32 * 1024;
+
+    BasicCPU<Checking> DUT( demo );
+    NullVideo video;
+    DUT.setVideoOutput( video );
+    BasicReverseDebugger<Checking> debugger( DUT, 1000, maxBytes );
+
+    while ( !debugger.run( 10000 ) );
+    uint64_t frames = video.getFrames();
+
+    ReverseStats stats = debugger.getStats();
+    if ( stats.bytes > maxBytes + 3 * sizeof(CPUState) )
+        errExit( "snapshots use more than maxBytes" );
+    if ( (stats.merged == 0) || (stats.oldestCycle == 0) )
+        errExit( "the oldest snapshots were not merged" );
+    passed( "memory limit test" );
+
+    // back one instruction at a time, starting with the halt
+    unsigned int index = fetches.size();
+    for ( unsigned int i = 0; i < 200; i++ ) {
+        index--;
+        if ( !debugger.reverseStep() )
+            errExit( "reverseStep failed" );
+
+        if ( (DUT.getCycleCount() != fetches[index].cycle) || (DUT.getProgramCounter() != fetches[index].pc) )
+            errExit( "reverseStep went to cycle " + to_string( DUT.getCycleCount() ) + " instead of " +
+                    to_string( fetches[index].cycle ) );
+    }
+    checkState( DUT, demo, "reverseStep" );
+    passed( "reverseStep test" );
+
+    // back to the last time an instruction from a while ago ran
+    int32_t breakpoint = fetches[ index - 3000 ].pc;
+    unsigned int expected = index;
+    while ( fetches[ --expected ].pc != breakpoint );
+
+    if ( !debugger.reverseContinue( breakpoint ) || (DUT.getCycleCount() != fetches[expected].cycle) )
+        errExit( "reverseContinue went to " + to_string( DUT.getCycleCount() ) + " instead of " + to_string( fetches[expected].cycle ) );
+    checkState( DUT, demo, "reverseContinue" );
+    index = expected;
+
+    // an address where there is no instruction is never reached
+    if ( debugger.reverseContinue( 2 ) || (DUT.getCycleCount() != fetches[index].cycle) )
+        errExit( "reverseContinue to a breakpoint which is never reached" );
+    passed( "reverseContinue test" );
+
+    // as far back as we can go
+    stats = debugger.getStats();
+    if ( debugger.reverseStepCycles( DUT.getCycleCount() - stats.oldestCycle + 1 ) ||
+            (DUT.getCycleCount() != fetches[index].cycle) )
+        errExit( "reverseStepCycles went back further than the oldest snapshot" );
+
+    if ( !debugger.reverseStepCycles( DUT.getCycleCount() - stats.oldestCycle - 7 ) ||
+            (DUT.getCycleCount() != stats.oldestCycle + 7) )
+        errExit( "reverseStepCycles" );
+    checkState( DUT, demo, "reverseStepCycles" );
+    passed( "reverseStepCycles test" );
+
+    if ( video.getFrames() != frames )
+        errExit( "frames were shown while going backwards" );
+
+    // forwards to the end again
+    while ( !debugger.run( 10000 ) );
+    if ( DUT.getCycleCount() != cycles )
+        errExit( "running forwards again took a different number of cycles" );
+    checkState( DUT, demo, "running forwards again" );
+
+    if ( !debugger.reverseStep() || (DUT.getCycleCount() != fetches.back().cycle) )
+        errExit( "reverseStep after running forwards again" );
+    passed( "forwards again test" );
+
+    // only the page with the count in it is written by loopProgram
+    vector<int32_t> loop = loopProgram( 300 );
+    BasicCPU<Checking> loopCPU( loop );
+    BasicReverseDebugger<Checking> loopDebugger( loopCPU, 100, 1024 * 1024 );
+
+    while ( !loopDebugger.run( 10000 ) );
+    stats = loopDebugger.getStats();
+    if ( (stats.snapshotsTaken < 50) || (stats.pagesSaved != stats.snapshotsTaken) )
+        errExit( "dirty page test: " + to_string( stats.pagesSaved ) + " pages saved in " +
+                to_string( stats.snapshotsTaken ) + " snapshots" );
+
+    if ( !loopDebugger.reverseStepCycles( 5000 ) )
+        errExit( "dirty page test: reverseStepCycles" );
+    checkState( loopCPU, loop, "dirty page test" );
+    passed( "dirty page test" );
+}
+
+int main( void ) {
+    debug( "Beginning reverse debugger tests" );
+    debug( "" );
+
+    reverseTests<Checked>();
+    debug( "All tests passed for CPU" );
+    debug( "" );
+
+    reverseTests<Unchecked>();
+    debug( "All tests passed for CPU with Unchecked signals" );
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,573 @@
+// tests for TerminalVideo, AsyncVideo, PacedVideo, FrameRecorder and SharedVideo
+// what TerminalVideo writes is played back on a pretend terminal, which should end up showing the frames
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../cpu/Video.h"
+#include "../cpu/AsyncVideo.h"
+#include "../cpu/PacedVideo.h"
+#include "../cpu/FrameRecording.h"
+#include "../cpu/SharedVideo.h"
+#include "../emulator/debug.h"
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+// understands the escape sequences TerminalVideo writes and nothing else
+class PretendTerminal {
+    private:
+        unsigned int x;
+        unsigned int y;
+
+    public:
+        char cells[ videoHeight + 1 ][ videoWidth ];
+
+        PretendTerminal( void ) : x( 0 ), y( 0 ) {
+            memset( cells, '?', sizeof(cells) );
+        }
+
+        void play( const string &output ) {
+            for ( unsigned int i = 0; i < output.size(); i++ ) {
+                if ( output[i] != '\x1b' ) {
+                    if ( (output[i] < ' ') || (y > videoHeight) || (x >= videoWidth) )
+                        errExit( "video test: a character off the screen or a control character" );
+
+                    cells[y][x++] = output[i];
+                    continue;
+                }
+
+                // ESC [ H, ESC [ 2 J or ESC [ row ; column H
+                size_t end = output.find_first_of( "HJ", i );
+                string sequence = output.substr( i + 2, end - i - 2 );
+                i = end;
+
+                if ( output[end] == 'J' ) {
+                    memset( cells, ' ', sizeof(cells) );
+                } else if ( sequence.empty() ) {
+                    x = 0;
+                    y = 0;
+                } else {
+                    y = atoi( sequence.c_str() ) - 1;
+                    x = atoi( sequence.c_str() + sequence.find( ';' ) + 1 ) - 1;
+                }
+            }
+        }
+
+        bool shows( const int8_t* frame ) {
+            for ( unsigned int row = 0; row < videoHeight; row++ ) {
+                for ( unsigned int column = 0; column < terminalColumns; column++ ) {
+                    char c = frame[ row * videoWidth + column ];
+                    if ( (c < ' ') || (c == 0x7F) )
+                        c = ' ';
+
+                    if ( cells[row][column] != c )
+                        return false;
+                }
+            }
+
+            return true;
+        }
+};
+
+// what has been written to fd since last time
+static string readNew( int fd ) {
+    string output;
+    char chunk[ 4096 ];
+    ssize_t got;
+
+    while ( (got = read( fd, chunk, sizeof(chunk) )) > 0 )
+        output.append( chunk, got );
+
+    return output;
+}
+
+// a terminal which takes a long time to draw anything. Each frame is numbered in its first four bytes
+class SlowVideo : public VideoOutput {
+    public:
+        vector<uint32_t> seen;
+
+        void showFrame( const int8_t* frame ) {
+            uint32_t number;
+            memcpy( &number, frame, sizeof(number) );
+            seen.push_back( number );
+
+            this_thread::sleep_for( chrono::milliseconds( 1 ) );
+        }
+};
+
+static void asyncTests( void ) {
+    const uint32_t frames = 2000;
+
+    SlowVideo slow;
+    chrono::duration<double> showing( 0 );
+    uint64_t shown;
+    uint64_t dropped;
+    {
+        AsyncVideo async( slow );
+        vector<int8_t> frame( videoBytes, '#' );
+
+        for ( uint32_t i = 0; i < frames; i++ ) {
+            memcpy( frame.data(), &i, sizeof(i) );
+
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            async.showFrame( frame.data() );
+            showing += chrono::steady_clock::now() - start;
+
+            // give the render thread time to show some of them
+            if ( i % 100 == 0 )
+                this_thread::sleep_for( chrono::milliseconds( 2 ) );
+        }
+
+        async.flush();
+        if ( async.getFramesShown() + async.getFramesDropped() != frames )
+            errExit( "async video test: flush returned too early" );
+
+        // then one more, which there is room for. The destructor waits for it to be shown
+        uint32_t last = frames;
+        memcpy( frame.data(), &last, sizeof(last) );
+        async.showFrame( frame.data() );
+        shown = async.getFramesShown();
+        dropped = async.getFramesDropped();
+    }
+
+    if ( (shown + dropped != frames) || (shown + 1 != slow.seen.size()) )
+        errExit( "async video test: frames went missing" );
+
+    if ( dropped == 0 )
+        errExit( "async video test: a slow terminal did not make any frames get dropped" );
+
+    for ( unsigned int i = 1; i < slow.seen.size(); i++ ) {
+        if ( slow.seen[i] <= slow.seen[i-1] )
+            errExit( "async video test: frames shown out of order" );
+    }
+
+    if ( slow.seen.back() != frames )
+        errExit( "async video test: the last frame was not shown before the render thread stopped" );
+
+    // 2000 frames would take the slow terminal at least 2 seconds
+    if ( showing.count() > 0.5 )
+        errExit( "async video test: showFrame waited for the terminal" );
+
+    debug( "async video test passed: " + to_string( shown ) + " frames shown, " + to_string( dropped ) + " dropped" );
+}
+
+// the frame numbers shown, without waiting
+class NumberedVideo : public VideoOutput {
+    public:
+        vector<uint32_t> seen;
+
+        void showFrame( const int8_t* frame ) {
+            uint32_t number;
+            memcpy( &number, frame, sizeof(number) );
+            seen.push_back( number );
+        }
+};
+
+// takes a long time to show frame 1
+class StallingVideo : public VideoOutput {
+    public:
+        vector<uint32_t> seen;
+
+        void showFrame( const int8_t* frame ) {
+            uint32_t number;
+            memcpy( &number, frame, sizeof(number) );
+            if ( number == 1 )
+                this_thread::sleep_for( chrono::milliseconds( 200 ) );
+
+            seen.push_back( number );
+        }
+};
+
+static void pacingTests( void ) {
+    vector<int8_t> frame( videoBytes, '#' );
+
+    // far faster than 100 frames a second: the first is shown and then only the last
+    NumberedVideo fast;
+    PacingStats stats;
+    {
+        PacedVideo paced( fast, 100 );
+        for ( uint32_t i = 0; i < 1000; i++ ) {
+            memcpy( frame.data(), &i, sizeof(i) );
+            paced.showFrame( frame.data() );
+        }
+
+        paced.flush();
+        stats = paced.getStats();
+    }
+
+    if ( (stats.presented + stats.skipped != 1000) || (stats.presented != fast.seen.size()) ||
+            (fast.seen.front() != 0) || (fast.seen.back() != 999) || (stats.stallSeconds != 0) )
+        errExit( "pacing test: frames were not skipped properly" );
+
+    // ten frames a second would be 100 seconds for all of them
+    if ( stats.presented > 20 )
+        errExit( "pacing test: too many frames presented" );
+    debug( "frame skip test passed: " + to_string( stats.presented ) + " presented" );
+
+    // a frame which came early is shown once it is due, without another frame or flush
+    NumberedVideo idle;
+    {
+        PacedVideo paced( idle, 100 );
+        for ( uint32_t i = 0; i < 2; i++ ) {
+            memcpy( frame.data(), &i, sizeof(i) );
+            paced.showFrame( frame.data() );
+        }
+
+        this_thread::sleep_for( chrono::milliseconds( 50 ) );
+        stats = paced.getStats();
+
+        // getStats takes the lock which the frame was shown with, so idle can be looked at
+        if ( (stats.presented != 2) || (idle.seen.size() != 2) || (idle.seen.back() != 1) )
+            errExit( "pacing test: an early frame was not shown when it was due" );
+    }
+    debug( "due frame test passed" );
+
+    // frame 1 is kept and then shown by the timer thread, which is still in output when frame 2 comes
+    StallingVideo stalling;
+    chrono::duration<double> showing( 0 );
+    {
+        PacedVideo paced( stalling, 100 );
+        for ( uint32_t i = 0; i < 3; i++ ) {
+            if ( i == 2 )
+                this_thread::sleep_for( chrono::milliseconds( 50 ) );
+
+            memcpy( frame.data(), &i, sizeof(i) );
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            paced.showFrame( frame.data() );
+            if ( i == 2 )
+                showing = chrono::steady_clock::now() - start;
+        }
+    }
+
+    if ( (stalling.seen.size() != 3) || (stalling.seen[1] != 1) || (stalling.seen[2] != 2) )
+        errExit( "pacing test: frames went missing while output was slow" );
+
+    if ( showing.count() > 0.1 )
+        errExit( "pacing test: showFrame waited for the timer thread's frame to be shown" );
+    debug( "slow output pacing test passed" );
+
+    // slower than the frame rate: nothing is skipped
+    NumberedVideo slow;
+    {
+        PacedVideo paced( slow, 1000 );
+        for ( uint32_t i = 0; i < 5; i++ ) {
+            memcpy( frame.data(), &i, sizeof(i) );
+            paced.showFrame( frame.data() );
+            this_thread::sleep_for( chrono::milliseconds( 3 ) );
+        }
+        stats = paced.getStats();
+    }
+
+    if ( (stats.presented != 5) || (stats.skipped != 0) )
+        errExit( "pacing test: frames were skipped when there was time for them" );
+    debug( "slow program pacing test passed" );
+
+    // waiting: every frame is presented but it takes at least 9 periods
+    NumberedVideo waited;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    {
+        PacedVideo paced( waited, 200, true );
+        for ( uint32_t i = 0; i < 10; i++ ) {
+            memcpy( frame.data(), &i, sizeof(i) );
+            paced.showFrame( frame.data() );
+        }
+        stats = paced.getStats();
+    }
+    double seconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+
+    if ( (stats.presented != 10) || (stats.skipped != 0) || (waited.seen.size() != 10) )
+        errExit( "pacing test: frames were skipped while waiting" );
+
+    if ( (seconds < 0.045) || (stats.stallSeconds < 0.04) )
+        errExit( "pacing test: did not wait for the frames to be due" );
+    debug( "frame wait test passed" );
+}
+
+static void recordingTests( void ) {
+    char path[] = "/tmp/videoTestXXXXXX";
+    int fd = mkstemp( path );
+    if ( fd < 0 )
+        errExit( "recording test: could not make a temporary file" );
+    close( fd );
+
+    // enough frames to fill several buffers, each with a few changes like the demo program makes
+    const unsigned int numFrames = 2000;
+    vector< vector<int8_t> > frames;
+    vector<int8_t> frame( videoBytes, 0 );
+    srand( 2 );
+    for ( unsigned int i = 0; i < numFrames; i++ ) {
+        unsigned int changes = rand() % 40;
+        for ( unsigned int j = 0; j < changes; j++ )
+            frame[ rand() % videoBytes ] = rand() % 128;
+
+        // sometimes the whole frame changes
+        if ( i % 500 == 0 )
+            memset( frame.data(), rand() % 128, videoBytes );
+
+        frames.push_back( frame );
+    }
+
+    uint64_t recordedBytes;
+    {
+        FrameRecorder recorder( path );
+        for ( unsigned int i = 0; i < numFrames; i++ )
+            recorder.showFrame( frames[i].data() );
+        recorder.close();
+
+        if ( recorder.getFrames() != numFrames )
+            errExit( "recording test: frames were not counted" );
+        recordedBytes = recorder.getBytes();
+    }
+
+    FrameReader reader( path );
+    const int8_t* played;
+    uint64_t nanoseconds;
+    uint64_t lastNanoseconds = 0;
+    for ( unsigned int i = 0; i < numFrames; i++ ) {
+        if ( !reader.next( played, nanoseconds ) )
+            errExit( "recording test: the recording ended after " + to_string( i ) + " frames" );
+
+        if ( memcmp( played, frames[i].data(), videoBytes ) != 0 )
+            errExit( "recording test: frame " + to_string( i ) + " was not played back the same" );
+
+        if ( nanoseconds < lastNanoseconds )
+            errExit( "recording test: the times went backwards" );
+        lastNanoseconds = nanoseconds;
+    }
+
+    if ( reader.next( played, nanoseconds ) )
+        errExit( "recording test: there were more frames than were recorded" );
+    debug( "recording round trip test passed" );
+
+    // the deltas are much smaller than the whole frames would have been
+    if ( recordedBytes * 10 > uint64_t(numFrames) * videoBytes )
+        errExit( "recording test: the recording is too big: " + to_string( recordedBytes ) + " bytes" );
+    debug( "recording size test passed: " + to_string( recordedBytes ) + " bytes for " + to_string( numFrames )
+            + " frames" );
+
+    unlink( path );
+}
+
+static void sharedTests( void ) {
+    string name = "/cpuEmulatorVideoTest" + to_string( getpid() );
+    vector<int8_t> frame( videoBytes, 'a' );
+    vector<int8_t> read( videoBytes, 0 );
+    int64_t shown;
+
+    {
+        SharedVideo video( name );
+        if ( !SharedVideoReader::isReady( name ) )
+            errExit( "shared video test: the segment was not made" );
+
+        SharedVideoReader reader( name );
+        if ( (reader.getFrames() != 0) || (reader.copyFrame( read.data(), shown ) != 0) || reader.isClosed() )
+            errExit( "shared video test: there was a frame before any were shown" );
+
+        // a frame from somewhere else is copied in
+        int64_t before = monotonicNanoseconds();
+        video.showFrame( frame.data() );
+        if ( (reader.copyFrame( read.data(), shown ) != 1) || (read != frame) || (shown < before)
+                || (shown > monotonicNanoseconds()) )
+            errExit( "shared video test: the first frame was not shared" );
+
+        // printBuffer writes straight into the segment. Readers can tell it is not finished yet
+        int8_t* destination = video.beginFrame();
+        memset( destination, 'b', videoBytes );
+        if ( (reader.get().sequence.load() & 1) == 0 )
+            errExit( "shared video test: a frame being written was not marked" );
+        video.showFrame( destination );
+
+        frame.assign( videoBytes, 'b' );
+        if ( (reader.copyFrame( read.data(), shown ) != 2) || (read != frame) || (video.getFrames() != 2) )
+            errExit( "shared video test: a frame written in place was not shared" );
+        debug( "shared video frame test passed" );
+
+        // every frame is all one character, so a frame read while it was being written would show up
+        atomic<bool> done( false );
+        uint64_t torn = 0;
+        atomic<uint64_t> seen( 0 );
+        thread watcher( [&]() {
+            vector<int8_t> copy( videoBytes );
+            int64_t when;
+            while ( !done.load() ) {
+                if ( reader.copyFrame( copy.data(), when ) == 0 )
+                    continue;
+
+                for ( unsigned int i = 1; i < videoBytes; i++ ) {
+                    if ( copy[i] != copy[0] ) {
+                        torn++;
+                        break;
+                    }
+                }
+                seen++;
+            }
+        } );
+
+        // until the watcher has had a good look, giving it a turn now and then in case there is only one core
+        for ( unsigned int i = 0; (seen.load() < 1000) && (i < 10000000); i++ ) {
+            int8_t* next = video.beginFrame();
+            memset( next, 'A' + i % 26, videoBytes );
+            video.showFrame( next );
+
+            if ( i % 64 == 0 )
+                this_thread::yield();
+        }
+        done.store( true );
+        watcher.join();
+
+        if ( torn != 0 )
+            errExit( "shared video test: " + to_string( torn ) + " frames were read while they were being written" );
+        debug( "shared video sequence lock test passed: " + to_string( seen.load() ) + " frames read" );
+
+        // the reader keeps its mapping after the writer has gone
+        {
+            SharedVideo* gone = new SharedVideo( name + "b" );
+            SharedVideoReader late( name + "b" );
+            gone->showFrame( frame.data() );
+            delete gone;
+
+            if ( !late.isClosed() || (late.copyFrame( read.data(), shown ) != 1) || (read != frame) )
+                errExit( "shared video test: the last frame was lost when the writer closed" );
+            if ( SharedVideoReader::isReady( name + "b" ) )
+                errExit( "shared video test: the segment was not removed" );
+        }
+    }
+
+    debug( "shared video close test passed" );
+
+    // a writer which never finishes its frame: the reader gives up on it instead of waiting for ever
+    {
+        SharedVideo stuck( name + "c" );
+        SharedVideoReader reader( name + "c" );
+        stuck.showFrame( frame.data() );
+        stuck.beginFrame();
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        if ( reader.copyFrame( read.data(), shown ) != 0 )
+            errExit( "shared video test: a frame which was never finished was read" );
+        if ( chrono::steady_clock::now() - start > chrono::seconds( 2 ) )
+            errExit( "shared video test: took too long to give up on an unfinished frame" );
+    }
+
+    // a writer which dies part way through a frame, without closing the segment
+    pid_t child = fork();
+    if ( child < 0 )
+        errExit( "shared video test: could not fork" );
+    if ( child == 0 ) {
+        SharedVideo* dying = new SharedVideo( name + "d" );
+        dying->beginFrame();
+        _exit( EXIT_SUCCESS ); // no destructor, so the segment is not closed or removed
+    }
+    waitpid( child, NULL, 0 );
+
+    {
+        SharedVideoReader reader( name + "d" );
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        if ( reader.isClosed() || reader.isWriterAlive() || (reader.copyFrame( read.data(), shown ) != 0) )
+            errExit( "shared video test: a writer which died was not noticed" );
+        if ( chrono::steady_clock::now() - start > chrono::milliseconds( SharedVideoReader::maxWriteMilliseconds ) )
+            errExit( "shared video test: waited for a writer which had died" );
+    }
+    shm_unlink( (name + "d").c_str() );
+
+    debug( "shared video dead writer test passed" );
+}
+
+int main( void ) {
+    debug( "Beginning video tests" );
+
+    // a frame is much smaller than a pipe can hold, so everything can be read back after each one
+    int fds[2];
+    if ( pipe( fds ) != 0 )
+        errExit( "video test: could not make a pipe" );
+    int readFd = fds[0];
+    fcntl( readFd, F_SETFL, O_NONBLOCK );
+
+    TerminalVideo video( fds[1] );
+    PretendTerminal terminal;
+
+    vector<int8_t> frame( videoBytes, '#' );
+    video.showFrame( frame.data() );
+    terminal.play( readNew( readFd ) );
+    if ( !terminal.shows( frame.data() ) )
+        errExit( "video test: the first frame was not drawn" );
+    debug( "first frame test passed" );
+
+    // the same again writes nothing
+    uint64_t before = video.getBytesWritten();
+    video.showFrame( frame.data() );
+    if ( (video.getBytesWritten() != before) || !readNew( readFd ).empty() )
+        errExit( "video test: an unchanged frame was written" );
+    debug( "unchanged frame test passed" );
+
+    // one cell is a cursor move and one character, then the cursor is put back under the frame
+    frame[ 3 * videoWidth + 10 ] = 'A';
+    video.showFrame( frame.data() );
+    string output = readNew( readFd );
+    if ( output != "\x1b[4;11HA\x1b[65;1H" )
+        errExit( "video test: one changed cell was written as " + output.substr( 1 ) );
+    terminal.play( output );
+    debug( "single cell test passed" );
+
+    // the columns which are not shown are not written
+    frame[ 5 * videoWidth + 62 ] = 'B';
+    video.showFrame( frame.data() );
+    if ( !readNew( readFd ).empty() )
+        errExit( "video test: a column which is not shown was written" );
+    debug( "hidden column test passed" );
+
+    // lots of random changes, including control characters, end up on the screen
+    srand( 1 );
+    for ( unsigned int i = 0; i < 50; i++ ) {
+        unsigned int changes = rand() % 200;
+        for ( unsigned int j = 0; j < changes; j++ )
+            frame[ rand() % videoBytes ] = rand() % 128;
+
+        video.showFrame( frame.data() );
+        terminal.play( readNew( readFd ) );
+        if ( !terminal.shows( frame.data() ) )
+            errExit( "video test: the screen does not match frame " + to_string( i ) );
+    }
+    debug( "random frames test passed" );
+
+    // redraw starts again on a cleared screen
+    video.redraw();
+    video.showFrame( frame.data() );
+    PretendTerminal fresh;
+    fresh.play( readNew( readFd ) );
+    if ( !fresh.shows( frame.data() ) )
+        errExit( "video test: redraw did not draw the whole frame" );
+    debug( "redraw test passed" );
+
+    close( fds[0] );
+    close( fds[1] );
+
+    asyncTests();
+    pacingTests();
+    recordingTests();
+    sharedTests();
+
+    debug( "All video tests passed" );
+    return EXIT_SUCCESS;
+}
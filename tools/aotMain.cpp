@@ -0,0 +1,36 @@
+// main() for a program translated by aotTranslate
+// AOT_PROGRAM is defined by the Makefile as the name given to aotTranslate
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../cpu/AotCPU.h"
+#include "../emulator/debug.h"
+#include <stdlib.h>
+#include <string>
+
+#ifndef AOT_PROGRAM
+#error "AOT_PROGRAM must be the name of the translated program"
+#endif
+
+extern const AotProgram AOT_PROGRAM;
+
+int main( void ) {
+    AotCPU cpu( AOT_PROGRAM );
+    cpu.run();
+
+    AotStats stats = cpu.getStats();
+    debug( "halted after " + std::to_string( cpu.getCycleCount() ) + " cycles. "
+            + std::to_string( stats.interpretedInstructions ) + " instructions were interpreted" );
+
+    return EXIT_SUCCESS;
+}
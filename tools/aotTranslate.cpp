@@ -0,0 +1,482 @@
+// translates a program image to a C++ file which can be run by AotCPU
+// usage: aotTranslate image.img output.cpp name
+//     the output defines "const AotProgram name"
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../assembler/ProgramImage.h"
+#include "../cpu/FastCPU.h"
+#include "../cpu/MemoryMap.h"
+#include "../cpu/Opcodes.h"
+#include "../cpu/Microcode.h"
+#include "../emulator/debug.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <fstream>
+#include <sstream>
+#include <endian.h>
+
+using namespace std;
+
+// what we know about a register at an instruction
+struct Value {
+    bool known;
+    int32_t value;
+};
+
+// the registers when an instruction starts. Only the constants are worked out, which is enough
+//      to find where most jumps go because programs build addresses with addImmediate
+struct RegisterState {
+    bool reached;
+    Value registers[32];
+};
+
+struct Decoded {
+    Opcode op;
+    unsigned int A;
+    unsigned int B;
+    unsigned int dest;
+    int32_t immediate;
+};
+
+static Decoded decode( int32_t storedWord ) {
+    uint32_t word = be32toh( storedWord );
+
+    Decoded ret;
+    ret.op = static_cast<Opcode>( word & 0x1F );
+    ret.A = (word >> 5) & 0x1F;
+    ret.B = (word >> 10) & 0x1F;
+    ret.dest = (word >> 15) & 0x1F;
+    ret.immediate = static_cast<int32_t>(word) >> 10; // sign extended
+    return ret;
+}
+
+static bool validOpcode( Opcode op ) {
+    return microcodeFor( op ).valid;
+}
+
+static bool fallsThrough( Opcode op ) {
+    return validOpcode( op ) && (op != Opcode::jumpToReg) && (op != Opcode::halt);
+}
+
+static bool isJump( Opcode op ) {
+    return (op == Opcode::jumpToReg) || (op == Opcode::branchIfZero) || (op == Opcode::branchIfPositive);
+}
+
+class Translator {
+    private:
+        const vector<int32_t> &image;
+        vector<Decoded> instructions;
+        vector<RegisterState> states; // one for each word of the image
+        set<int32_t> entries; // addresses the generated switch has a case for
+
+        bool translated( int32_t addr ) {
+            return (addr >= 0) && ((addr % sizeof(int32_t)) == 0)
+                && (static_cast<uint32_t>(addr) / sizeof(int32_t) < image.size());
+        }
+
+        // merge in to the state at addr. Returns true if it changed
+        bool merge( int32_t addr, const RegisterState &in ) {
+            RegisterState &state = states[ addr / sizeof(int32_t) ];
+
+            if ( !state.reached ) {
+                state = in;
+                return true;
+            }
+
+            bool changed = false;
+            for ( unsigned int i = 0; i < 32; i++ ) {
+                if ( state.registers[i].known
+                        && (!in.registers[i].known || (in.registers[i].value != state.registers[i].value)) ) {
+                    state.registers[i].known = false;
+                    changed = true;
+                }
+            }
+
+            return changed;
+        }
+
+        static Value constant( int32_t value ) {
+            Value ret = { true, value };
+            return ret;
+        }
+
+        static Value unknown( void ) {
+            Value ret = { false, 0 };
+            return ret;
+        }
+
+        // the registers after inst has run
+        static RegisterState transfer( const Decoded &inst, const RegisterState &in ) {
+            RegisterState out = in;
+            const Value &A = in.registers[ inst.A ];
+            const Value &B = in.registers[ inst.B ];
+            bool bothKnown = A.known && B.known;
+            uint32_t a = A.value;
+            uint32_t b = B.value;
+
+            switch ( inst.op ) {
+                case ( Opcode::addImmediate ):
+                    out.registers[1] = A.known ? constant( a + static_cast<uint32_t>(inst.immediate) ) : unknown();
+                    break;
+
+                case ( Opcode::subImmediate ):
+                    out.registers[1] = A.known ? constant( a - static_cast<uint32_t>(inst.immediate) ) : unknown();
+                    break;
+
+                case ( Opcode::add ):
+                    out.registers[ inst.dest ] = bothKnown ? constant( a + b ) : unknown();
+                    break;
+
+                case ( Opcode::sub ):
+                    out.registers[ inst.dest ] = bothKnown ? constant( a - b ) : unknown();
+                    break;
+
+                case ( Opcode::nand ):
+                    out.registers[ inst.dest ] = bothKnown ? constant( ~(a & b) ) : unknown();
+                    break;
+
+                case ( Opcode::lshift ):
+                    out.registers[ inst.dest ] = bothKnown ? constant( a << (b & 31) ) : unknown();
+                    break;
+
+                case ( Opcode::load ):
+                    out.registers[ inst.dest ] = unknown();
+                    break;
+
+                default:
+                    break;
+            }
+
+            out.registers[0] = constant( 0 );
+            return out;
+        }
+
+        // constant propagation over the instructions reachable from address 0. Jumps to a constant
+        //      address add that address to the control flow graph
+        void findReachable( void ) {
+            RegisterState start;
+            start.reached = true;
+            for ( unsigned int i = 0; i < 32; i++ )
+                start.registers[i] = unknown();
+            start.registers[0] = constant( 0 );
+
+            RegisterState notReached;
+            notReached.reached = false;
+            states.assign( image.size(), notReached );
+
+            vector<int32_t> worklist;
+            if ( translated( 0 ) ) {
+                merge( 0, start );
+                worklist.push_back( 0 );
+                entries.insert( 0 );
+            }
+
+            while ( !worklist.empty() ) {
+                int32_t addr = worklist.back();
+                worklist.pop_back();
+
+                const Decoded &inst = instructions[ addr / sizeof(int32_t) ];
+                RegisterState out = transfer( inst, states[ addr / sizeof(int32_t) ] );
+
+                vector<int32_t> successors;
+                if ( fallsThrough( inst.op ) )
+                    successors.push_back( addr + sizeof(int32_t) );
+
+                if ( isJump( inst.op ) && out.registers[ inst.A ].known ) {
+                    int32_t target = out.registers[ inst.A ].value;
+                    successors.push_back( target );
+                    if ( translated( target ) )
+                        entries.insert( target );
+                }
+
+                for ( unsigned int i = 0; i < successors.size(); i++ ) {
+                    if ( translated( successors[i] ) && merge( successors[i], out ) )
+                        worklist.push_back( successors[i] );
+                }
+            }
+        }
+
+        string label( int32_t addr ) {
+            return "L_" + to_string( addr );
+        }
+
+        string reg( unsigned int r ) {
+            return "r[" + to_string( r ) + "]";
+        }
+
+        // jump to the address in register A. If the analysis found a constant then it is checked
+        //      (AotCPU can come back in with any register values) and used to go straight there
+        void emitJump( ostream &out, const string &indent, const Decoded &inst, const RegisterState &state ) {
+            const Value &target = state.registers[ inst.A ];
+
+            if ( target.known && translated( target.value ) ) {
+                out << indent << "if ( (" << reg( inst.A ) << " == " << target.value << ") && (cycles < limit) )\n";
+                out << indent << "    goto " << label( target.value ) << ";\n";
+            }
+
+            out << indent << "pc = " << reg( inst.A ) << ";\n";
+            out << indent << "goto dispatch;\n";
+        }
+
+        // the result of an ALU instruction is in word
+        void emitALUResult( ostream &out, unsigned int dest ) {
+            out << "            zero = (word == 0);\n";
+            out << "            positive = (word >= 0);\n";
+            out << "            flagsSet = true;\n";
+            if ( dest != 0 )
+                out << "            " << reg( dest ) << " = word;\n";
+        }
+
+        void emitInstruction( ostream &out, int32_t addr ) {
+            const Decoded &inst = instructions[ addr / sizeof(int32_t) ];
+            const RegisterState &state = states[ addr / sizeof(int32_t) ];
+            string cycles = "            cycles += " + to_string( FastCPU::cyclesFor( inst.op ) ) + ";\n";
+            string A = "(uint32_t) " + reg( inst.A );
+            string B = "(uint32_t) " + reg( inst.B );
+            string pcHere = "pc = " + to_string( addr ) + "; ";
+            string next = to_string( addr + sizeof(int32_t) );
+
+            switch ( inst.op ) {
+                case ( Opcode::nop ):
+                    break;
+
+                case ( Opcode::addImmediate ):
+                case ( Opcode::subImmediate ):
+                    out << "            word = (int32_t) (" << A << (inst.op == Opcode::addImmediate ? " + " : " - ")
+                        << "(uint32_t) " << inst.immediate << ");\n";
+                    emitALUResult( out, 1 );
+                    break;
+
+                case ( Opcode::add ):
+                    out << "            word = (int32_t) (" << A << " + " << B << ");\n";
+                    emitALUResult( out, inst.dest );
+                    break;
+
+                case ( Opcode::sub ):
+                    out << "            word = (int32_t) (" << A << " - " << B << ");\n";
+                    emitALUResult( out, inst.dest );
+                    break;
+
+                case ( Opcode::nand ):
+                    out << "            word = (int32_t) ~(" << A << " & " << B << ");\n";
+                    emitALUResult( out, inst.dest );
+                    break;
+
+                case ( Opcode::lshift ):
+                    out << "            word = (int32_t) (" << A << " << (" << B << " & 31));\n";
+                    emitALUResult( out, inst.dest );
+                    break;
+
+                case ( Opcode::load ):
+                    out << "            address = " << reg( inst.A ) << ";\n";
+                    out << "            if ( !aotValidAddress( address ) ) { " << pcHere << "goto interpret; }\n";
+                    if ( inst.dest != 0 ) {
+                        out << "            memcpy( &word, m + address, sizeof(word) );\n";
+                        out << "            " << reg( inst.dest ) << " = (int32_t) be32toh( word );\n";
+                    }
+                    break;
+
+                case ( Opcode::store ):
+                    out << "            address = " << reg( inst.A ) << ";\n";
+                    out << "            if ( !aotValidAddress( address ) ) { " << pcHere << "goto interpret; }\n";
+                    out << "            memcpy( m + address, &" << reg( inst.B ) << ", sizeof(int32_t) );\n";
+                    out << cycles;
+                    out << "            if ( aotWritesCode( codeWords, imageWords, address ) ) "
+                        << "{ pc = " << next << "; exit = AotExit::codeWritten; goto done; }\n";
+                    return;
+
+                case ( Opcode::jumpToReg ):
+                    out << cycles;
+                    emitJump( out, "            ", inst, state );
+                    return;
+
+                case ( Opcode::branchIfZero ):
+                case ( Opcode::branchIfPositive ):
+                    out << "            if ( !flagsSet ) { " << pcHere << "goto interpret; }\n";
+                    out << cycles;
+                    out << "            if ( " << (inst.op == Opcode::branchIfZero ? "zero" : "positive") << " ) {\n";
+                    emitJump( out, "                ", inst, state );
+                    out << "            }\n";
+                    return;
+
+                case ( Opcode::printBuffer ):
+                    out << "            c.video->showFrame( m + mainMemoryBytes );\n";
+                    break;
+
+                case ( Opcode::halt ):
+                    out << cycles;
+                    out << "            " << pcHere << "exit = AotExit::halted; goto done;\n";
+                    return;
+
+                default:
+                    // FastCPU will report the invalid opcode
+                    out << "            " << pcHere << "goto interpret;\n";
+                    return;
+            }
+
+            out << cycles;
+        }
+
+    public:
+        Translator( const vector<int32_t> &Image ) : image( Image ) {
+            for ( unsigned int i = 0; i < image.size(); i++ )
+                instructions.push_back( decode( image[i] ) );
+
+            findReachable();
+        }
+
+        void write( ostream &out, const string &imagePath, const string &name ) {
+            out << "// translated from " << imagePath << " by aotTranslate. Do not edit\n\n";
+            out << "#include \"../cpu/AotCPU.h\"\n";
+            out << "#include \"../cpu/MemoryMap.h\"\n";
+            out << "#include \"../cpu/Video.h\"\n";
+            out << "#include <stdint.h>\n";
+            out << "#include <string.h>\n";
+            out << "#include <endian.h>\n\n";
+
+            out << "// not every label is the target of a goto and the cases are meant to fall through\n";
+            out << "#pragma GCC diagnostic ignored \"-Wunused-label\"\n";
+            out << "#pragma GCC diagnostic ignored \"-Wimplicit-fallthrough\"\n\n";
+
+            out << "static const unsigned int imageWords = " << image.size() << ";\n\n";
+
+            out << "static const int32_t image[] = {";
+            for ( unsigned int i = 0; i < image.size(); i++ )
+                out << ((i % 8) == 0 ? "\n    " : " ") << image[i] << ",";
+            out << "\n    0 // so that an empty image still compiles\n};\n\n";
+
+            out << "static const uint8_t codeWords[] = {";
+            for ( unsigned int i = 0; i < image.size(); i++ )
+                out << ((i % 32) == 0 ? "\n    " : " ") << (states[i].reached ? 1 : 0) << ",";
+            out << "\n    0\n};\n\n";
+
+            out << "static const int32_t entries[] = {";
+            for ( set<int32_t>::iterator it = entries.begin(); it != entries.end(); it++ )
+                out << " " << *it << ",";
+            out << " 0 };\n\n";
+
+            out << "static AotExit run( AotContext &c ) {\n";
+            out << "    // a local copy of the registers so the compiler knows stores to memory can't change them\n";
+            out << "    int32_t r[32];\n";
+            out << "    memcpy( r, c.registers, sizeof(r) );\n";
+            out << "    int8_t* m = c.memory;\n";
+            out << "    int32_t pc = c.programCounter;\n";
+            out << "    bool zero = c.zero;\n";
+            out << "    bool positive = c.positive;\n";
+            out << "    bool flagsSet = c.flagsSet;\n";
+            out << "    uint64_t cycles = c.cycleCount;\n";
+            out << "    const uint64_t limit = c.cycleLimit;\n";
+            out << "    AotExit exit;\n";
+            out << "    uint32_t address;\n";
+            out << "    int32_t word;\n";
+            out << "    (void) address;\n";
+            out << "    (void) word;\n\n";
+
+            out << "dispatch:\n";
+            out << "    if ( cycles >= limit ) {\n";
+            out << "        exit = AotExit::cycleLimit;\n";
+            out << "        goto done;\n";
+            out << "    }\n\n";
+
+            out << "    switch ( pc ) {\n";
+
+            // every reachable instruction in address order. Straight line code just falls through
+            bool fellThrough = false;
+            int32_t fallThroughTo = 0;
+            for ( unsigned int i = 0; i < image.size(); i++ ) {
+                if ( !states[i].reached )
+                    continue;
+
+                int32_t addr = i * sizeof(int32_t);
+                if ( fellThrough && (fallThroughTo != addr) )
+                    out << "            pc = " << fallThroughTo << ";\n            goto dispatch;\n";
+
+                out << "\n";
+                if ( entries.count( addr ) ) {
+                    out << "        case " << addr << ":\n";
+                    out << "        " << label( addr ) << ":\n";
+                }
+                out << "            // " << addr << "\n";
+
+                emitInstruction( out, addr );
+
+                fellThrough = fallsThrough( instructions[i].op );
+                fallThroughTo = addr + sizeof(int32_t);
+            }
+
+            // off the end of the image
+            if ( fellThrough )
+                out << "            pc = " << fallThroughTo << ";\n            goto dispatch;\n";
+
+            out << "\n        default:\n";
+            out << "            goto interpret;\n";
+            out << "    }\n\n";
+
+            out << "interpret:\n";
+            out << "    exit = AotExit::interpret;\n\n";
+
+            out << "done:\n";
+            out << "    memcpy( c.registers, r, sizeof(r) );\n";
+            out << "    c.programCounter = pc;\n";
+            out << "    c.zero = zero;\n";
+            out << "    c.positive = positive;\n";
+            out << "    c.flagsSet = flagsSet;\n";
+            out << "    c.cycleCount = cycles;\n";
+            out << "    return exit;\n";
+            out << "}\n\n";
+
+            out << "extern const AotProgram " << name << ";\n";
+            out << "const AotProgram " << name << " = { run, image, imageWords, codeWords, entries, "
+                << entries.size() << " };\n";
+        }
+
+        unsigned int numReachable( void ) {
+            unsigned int ret = 0;
+            for ( unsigned int i = 0; i < states.size(); i++ )
+                ret += states[i].reached ? 1 : 0;
+            return ret;
+        }
+
+        unsigned int numEntries( void ) {
+            return entries.size();
+        }
+};
+
+int main( int argc, char** argv ) {
+    if ( argc != 4 )
+        errExit( "usage: aotTranslate image.img output.cpp name" );
+
+    vector<int32_t> image = readProgramImage( argv[1] );
+    if ( image.size() > mainMemoryBytes / sizeof(int32_t) )
+        errExit( "The program image does not fit in main memory" );
+
+    Translator translator( image );
+
+    ostringstream code;
+    translator.write( code, argv[1], argv[3] );
+
+    ofstream file( argv[2] );
+    file << code.str();
+    file.close();
+    if ( !file )
+        errExit( string( "Could not write " ) + argv[2] );
+
+    debug( "translated " + to_string( translator.numReachable() ) + " of " + to_string( image.size() )
+            + " words with " + to_string( translator.numEntries() ) + " entry points" );
+
+    return EXIT_SUCCESS;
+}
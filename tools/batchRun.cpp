@@ -0,0 +1,108 @@
+// runs every program image in a manifest and prints what each one did
+// usage: batchRun [-j threads] [-e cpu|cpu-unchecked|fast] [-c maxCycles] manifest
+//     -j  number of threads (default: one for each core)
+//     -e  cpu (the cycle accurate CPU, the default) or fast (FastCPU)
+//     -c  stop jobs which have not halted after this many cycles (default 100000000)
+// exits with EXIT_FAILURE if any job failed
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../batch/BatchRunner.h"
+#include "../emulator/debug.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static void usage( void ) {
+    errExit( "usage: batchRun [-j threads] [-e cpu|fast] [-c maxCycles] manifest" );
+}
+
+// the argument after argv[i]
+static string argument( int argc, char** argv, int &i ) {
+    if ( i + 1 >= argc )
+        usage();
+
+    return argv[ ++i ];
+}
+
+int main( int argc, char** argv ) {
+    BatchOptions options;
+    options.threads = 0;
+    options.engine = BatchEngine::cpu;
+    options.maxCycles = 100000000;
+
+    string manifest;
+    for ( int i = 1; i < argc; i++ ) {
+        string arg = argv[i];
+
+        if ( arg == "-j" ) {
+            options.threads = strtoul( argument( argc, argv, i ).c_str(), NULL, 10 );
+        } else if ( arg == "-e" ) {
+            string engine = argument( argc, argv, i );
+            if ( engine == "cpu" )
+                options.engine = BatchEngine::cpu;
+            else if ( engine == "cpu-unchecked" )
+                options.engine = BatchEngine::cpuUnchecked;
+            else if ( engine == "fast" )
+                options.engine = BatchEngine::fast;
+            else
+                usage();
+        } else if ( arg == "-c" ) {
+            options.maxCycles = strtoull( argument( argc, argv, i ).c_str(), NULL, 10 );
+        } else if ( manifest.empty() ) {
+            manifest = arg;
+        } else {
+            usage();
+        }
+    }
+
+    if ( manifest.empty() )
+        usage();
+
+    vector<BatchJob> jobs = readManifest( manifest );
+
+    BatchStats stats;
+    vector<BatchResult> results = runBatch( jobs, options, stats );
+
+    // one line for each job, in the order of the manifest
+    unsigned int failed = 0;
+    for ( unsigned int i = 0; i < results.size(); i++ ) {
+        const BatchResult &r = results[i];
+
+        if ( !r.ok ) {
+            failed++;
+            if ( r.faultPC >= 0 )
+                printf( "%s error %s pc=%d cycle=%llu: %s\n", jobs[i].name.c_str(), errorKindName( r.errorKind ),
+                        r.faultPC, (unsigned long long) r.cycles, r.error.c_str() );
+            else
+                printf( "%s error %s\n", jobs[i].name.c_str(), r.error.c_str() );
+            continue;
+        }
+
+        printf( "%s %s cycles=%llu frames=%llu ram=%016llx video=%016llx\n", jobs[i].name.c_str(),
+                r.halted ? "halted" : "stopped", (unsigned long long) r.cycles, (unsigned long long) r.frames,
+                (unsigned long long) r.ramDigest, (unsigned long long) r.frameHash );
+    }
+
+    if ( options.engine == BatchEngine::fast )
+        fprintf( stderr, "the fast engine does not check for reading registers or memory which were never written\n" );
+    fprintf( stderr, "%u jobs (%u failed) on %u threads in %.3fs = %.1f jobs/sec, %llu stolen\n",
+            (unsigned int) jobs.size(), failed, stats.threads, stats.seconds, jobs.size() / stats.seconds,
+            (unsigned long long) stats.steals );
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
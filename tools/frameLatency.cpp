@@ -0,0 +1,123 @@
+// watches the frames put in shared memory by SharedVideo (for example by cpuDemo --shared name) and
+//      reports how long after each frame was shown it was seen here
+// usage: frameLatency [-n frames] [-t seconds] name
+// it waits up to -t seconds (default 10) for the segment to appear, then runs until the writer closes it,
+//      dies or -n frames have been seen
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../cpu/SharedVideo.h"
+#include "../emulator/debug.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+using namespace std;
+
+static void usage( void ) {
+    errExit( "usage: frameLatency [-n frames] [-t seconds] name" );
+}
+
+// the argument after argv[i]
+static string argument( int argc, char** argv, int &i ) {
+    if ( i + 1 >= argc )
+        usage();
+
+    return argv[ ++i ];
+}
+
+int main( int argc, char** argv ) {
+    uint64_t maxFrames = UINT64_MAX;
+    double timeout = 10;
+    string name;
+
+    for ( int i = 1; i < argc; i++ ) {
+        string arg = argv[i];
+
+        if ( arg == "-n" )
+            maxFrames = strtoull( argument( argc, argv, i ).c_str(), NULL, 10 );
+        else if ( arg == "-t" )
+            timeout = atof( argument( argc, argv, i ).c_str() );
+        else if ( name.empty() )
+            name = arg;
+        else
+            usage();
+    }
+
+    if ( name.empty() )
+        usage();
+
+    chrono::steady_clock::time_point giveUp = chrono::steady_clock::now() +
+            chrono::duration_cast<chrono::steady_clock::duration>( chrono::duration<double>( timeout ) );
+    while ( !SharedVideoReader::isReady( name ) ) {
+        if ( chrono::steady_clock::now() > giveUp )
+            errExit( "gave up waiting for " + name );
+        this_thread::sleep_for( chrono::milliseconds( 1 ) );
+    }
+
+    SharedVideoReader reader( name );
+
+    vector<int64_t> latencies;
+    uint64_t last = 0;
+    uint64_t missed = 0;
+    uint64_t hash = 0;
+
+    while ( latencies.size() < maxFrames ) {
+        // closed is looked at first so that a frame finished just before it is still seen
+        bool closed = reader.isClosed() || !reader.isWriterAlive();
+
+        if ( reader.getFrames() != last ) {
+            int64_t shown;
+            uint64_t number = reader.hashFrame( hash, shown );
+            int64_t seen = monotonicNanoseconds();
+
+            // a writer which is still alive was only held up, so the frame is read again
+            if ( number == 0 ) {
+                if ( reader.isWriterAlive() )
+                    continue;
+
+                fprintf( stderr, "the writer stopped part way through a frame\n" );
+                break;
+            }
+
+            latencies.push_back( seen - shown );
+            missed += number - last - 1;
+            last = number;
+        } else if ( closed ) {
+            break;
+        } else {
+            this_thread::yield();
+        }
+    }
+
+    if ( !reader.isClosed() && !reader.isWriterAlive() )
+        fprintf( stderr, "%s was not closed: the writer has died\n", name.c_str() );
+
+    if ( latencies.empty() )
+        errExit( "no frames were shown in " + name );
+
+    sort( latencies.begin(), latencies.end() );
+    size_t count = latencies.size();
+    printf( "%llu frames seen, %llu missed (shown again before they were seen)\n",
+            (unsigned long long) count, (unsigned long long) missed );
+    printf( "latency: min %.1fus, median %.1fus, 99th percentile %.1fus, max %.1fus\n", latencies.front() / 1e3,
+            latencies[ count / 2 ] / 1e3, latencies[ count * 99 / 100 ] / 1e3, latencies.back() / 1e3 );
+    printf( "last frame %llu has hash %016llx\n", (unsigned long long) last, (unsigned long long) hash );
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,367 @@
+// writes the cycle accurate CPU out as compiled code, in the style of Verilator
+// the behaviour of each state comes from the microcode ROM (cpu/Microcode.h)
+// usage: levelize output.cpp
+//     the output defines levelizedTicks (see cpu/LevelizedCPU.h): one straight line function for each
+//     control unit state and opcode, which only writes the registers that state drives
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../cpu/ControlUnitState.h"
+#include "../cpu/Opcodes.h"
+#include "../cpu/Microcode.h"
+#include "../emulator/debug.h"
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+// a value worked out by the combinational logic during the cycle
+struct Net {
+    string type;
+    string name;
+    string value; // C++ using the registers in s as they were at the start of the cycle
+};
+
+// a register which is written at the clock edge
+struct Assignment {
+    string target;
+    string net;
+    string condition; // written only if this is true. Empty for always
+};
+
+// what the control unit does in one state for one opcode, worked out from the microcode ROM in the
+//      same way as the functions in cpu/CPU.cpp. It is levelized: every net only uses registers
+//      and nets before it, and nothing is written until all of them are worked out
+struct Behaviour {
+    string error;             // the combination is an error in CPU (and nothing else is used)
+    string errorKind;         // the ErrorKind it is reported as
+    vector<string> checks;    // errors found by the combinational logic (bad addresses etc.)
+    vector<Net> nets;
+    vector<Assignment> assignments;
+    vector<string> effects;   // RAM writes and printBuffer
+    ControlUnitStateEnum next;
+};
+
+static const char* stateNames[] = { "Fetch", "Decode", "Execute", "Write" };
+const unsigned int numStates = 4;
+const unsigned int numOpcodes = 32;
+
+static const char* opcodeName( unsigned int op ) {
+    return microcode[op].valid ? microcode[op].name : NULL;
+}
+
+static void net( Behaviour &b, const string &type, const string &name, const string &value ) {
+    Net n = { type, name, value };
+    b.nets.push_back( n );
+}
+
+static void assign( Behaviour &b, const string &target, const string &net, const string &condition = "" ) {
+    Assignment a = { target, net, condition };
+    b.assignments.push_back( a );
+}
+
+// the ALU: result, zero and positive from A and B
+// the arithmetic is done unsigned so that overflow wraps around like it does in the ALU
+static void alu( Behaviour &b, AluOps op, const string &A, const string &B ) {
+    string result;
+    switch ( op ) {
+        case ( AluOps::add ):
+            result = "static_cast<int32_t>( static_cast<uint32_t>(" + A + ") + static_cast<uint32_t>(" + B + ") )";
+            break;
+
+        case ( AluOps::sub ):
+            result = "static_cast<int32_t>( static_cast<uint32_t>(" + A + ") - static_cast<uint32_t>(" + B + ") )";
+            break;
+
+        case ( AluOps::nand ):
+            result = "~( " + A + " & " + B + " )";
+            break;
+
+        case ( AluOps::lshift ):
+            // masked like the x86 shift instruction used by the ALU
+            result = "static_cast<int32_t>( static_cast<uint32_t>(" + A + ") << (" + B + " & 31) )";
+            break;
+
+        default:
+            errExit( "levelize: the microcode uses an ALU operation we do not know" );
+    }
+
+    net( b, "int32_t", "result", result );
+    net( b, "bool", "zero", "result == 0" );
+    net( b, "bool", "positive", "result >= 0" ); // 0 is positive, see cpu/alu.cpp
+    assign( b, "s.aluResult", "result" );
+    assign( b, "s.zero", "zero" );
+    assign( b, "s.positive", "positive" );
+    assign( b, "s.flagsSet", "true" );
+}
+
+// CPU::fetch. The opcode does not matter
+static Behaviour fetch( void ) {
+    Behaviour b;
+    b.checks.push_back( "levelizedCheckAddress( s.programCounter );" );
+    net( b, "int32_t", "word", "levelizedRead( s, s.programCounter )" );
+    assign( b, "s.ramOut", "word" );
+    assign( b, "s.currentOpcode", "static_cast<Opcode>( word & 0x1F )" );
+    b.next = ControlUnitStateEnum::Decode;
+    return b;
+}
+
+// CPU::decode. The register file reads happen at the clock edge so they see this cycle's registers
+static Behaviour decode( const MicroInstruction &micro ) {
+    Behaviour b;
+    b.next = ControlUnitStateEnum::Execute;
+
+    if ( !micro.valid ) {
+        b.error = "In cpu/decode, invalid opcode";
+        b.errorKind = "invalidOpcode";
+        return b;
+    }
+
+    if ( micro.readA ) {
+        net( b, "int32_t", "out1", "s.registers[ (s.ramOut >> 5) & 0x1F ]" );
+        assign( b, "s.out1", "out1" );
+    }
+
+    if ( micro.readB ) {
+        net( b, "int32_t", "out2", "s.registers[ (s.ramOut >> 10) & 0x1F ]" );
+        assign( b, "s.out2", "out2" );
+    }
+
+    if ( micro.latchResult ) {
+        net( b, "uint8_t", "resultArg", "static_cast<uint8_t>( (s.ramOut >> 15) & 0x1F )" );
+        assign( b, "s.resultArg", "resultArg" );
+    }
+
+    if ( micro.latchImmediate ) {
+        net( b, "int32_t", "immediate", "s.ramOut >> 10" ); // sign extended
+        assign( b, "s.immediate", "immediate" );
+    }
+
+    // calculate what the next value of the program counter probably will be
+    net( b, "int32_t", "PCplus4", "static_cast<int32_t>( static_cast<uint32_t>(s.programCounter) + 4 )" );
+    assign( b, "s.PCplus4", "PCplus4" );
+    return b;
+}
+
+// CPU::execute
+static Behaviour execute( const MicroInstruction &micro ) {
+    Behaviour b;
+    b.next = micro.afterExecute;
+
+    if ( !micro.valid ) {
+        b.error = "In cpu/execute, invalid opcode";
+        b.errorKind = "invalidOpcode";
+        return b;
+    }
+
+    if ( micro.useAlu )
+        alu( b, micro.aluOp, "s.out1", (micro.aluB == AluBSource::immediate) ? "s.immediate" : "s.out2" );
+
+    switch ( micro.memory ) {
+        case ( MemoryOp::read ):
+            b.checks.push_back( "levelizedCheckAddress( s.out1 );" );
+            net( b, "int32_t", "word", "levelizedRead( s, s.out1 )" );
+            assign( b, "s.ramOut", "word" );
+            break;
+
+        case ( MemoryOp::write ):
+            b.checks.push_back( "levelizedCheckAddress( s.out1 );" );
+            b.effects.push_back( "levelizedWrite( s, s.out1, s.out2 );" );
+            break;
+
+        case ( MemoryOp::none ):
+            break;
+    }
+
+    switch ( micro.pc ) {
+        case ( PCSource::PCplus4 ):
+            assign( b, "s.programCounter", "s.PCplus4" );
+            break;
+
+        case ( PCSource::out1 ):
+            assign( b, "s.programCounter", "s.out1" );
+            break;
+
+        case ( PCSource::ifZero ):
+            b.checks.push_back( "if ( !s.flagsSet ) errExit( ErrorKind::undefinedValue, \"LevelizedCPU: branchIfZero before the zero flag was set\" );" );
+            net( b, "int32_t", "target", "s.zero ? s.out1 : s.PCplus4" ); // ifZeroMux
+            assign( b, "s.programCounter", "target" );
+            break;
+
+        case ( PCSource::ifPositive ):
+            b.checks.push_back( "if ( !s.flagsSet ) errExit( ErrorKind::undefinedValue, \"LevelizedCPU: branchIfPositive before the positive flag was set\" );" );
+            net( b, "int32_t", "target", "s.positive ? s.out1 : s.PCplus4" ); // ifPositiveMux
+            assign( b, "s.programCounter", "target" );
+            break;
+
+        case ( PCSource::none ):
+            break;
+    }
+
+    switch ( micro.system ) {
+        case ( SystemOp::printBuffer ):
+            b.effects.push_back( "s.video->showFrame( s.memory + mainMemoryBytes );" );
+            break;
+
+        case ( SystemOp::halt ):
+            assign( b, "s.halted", "true" );
+            break;
+
+        case ( SystemOp::none ):
+            break;
+    }
+
+    return b;
+}
+
+// CPU::write. Writes to r0 are ignored by the register file
+static Behaviour write( const MicroInstruction &micro ) {
+    Behaviour b;
+    b.next = ControlUnitStateEnum::Fetch;
+
+    switch ( micro.writeback ) {
+        case ( Writeback::aluToR1 ):
+            assign( b, "s.registers[1]", "s.aluResult" );
+            break;
+
+        case ( Writeback::aluToResult ):
+            assign( b, "s.registers[ s.resultArg ]", "s.aluResult", "s.resultArg != 0" );
+            break;
+
+        case ( Writeback::ramToResult ):
+            assign( b, "s.registers[ s.resultArg ]", "s.ramOut", "s.resultArg != 0" );
+            break;
+
+        case ( Writeback::none ):
+            b.error = micro.valid ? "we should have skipped write for that opcode" : "cpu/write invalid opcode";
+            b.errorKind = micro.valid ? "general" : "invalidOpcode";
+            break;
+    }
+
+    return b;
+}
+
+static Behaviour behaviour( unsigned int state, unsigned int op ) {
+    switch ( static_cast<ControlUnitStateEnum>(state) ) {
+        case ( ControlUnitStateEnum::Fetch ):
+            return fetch();
+        case ( ControlUnitStateEnum::Decode ):
+            return decode( microcode[op] );
+        case ( ControlUnitStateEnum::Execute ):
+            return execute( microcode[op] );
+        default:
+            return write( microcode[op] );
+    }
+}
+
+// write the straight line tick function for b
+static void writeTick( ostream &out, const string &name, const Behaviour &b ) {
+    out << "static void " << name << "( LevelizedState &s ) {\n";
+
+    if ( !b.error.empty() ) {
+        out << "    (void) s;\n";
+        out << "    errExit( ErrorKind::" << b.errorKind << ", \"" << b.error << "\" );\n";
+        out << "}\n\n";
+        return;
+    }
+
+    // level 1: combinational logic. Only the registers as they were at the start of the cycle are read
+    for ( unsigned int i = 0; i < b.checks.size(); i++ )
+        out << "    " << b.checks[i] << "\n";
+
+    for ( unsigned int i = 0; i < b.nets.size(); i++ )
+        out << "    const " << b.nets[i].type << " " << b.nets[i].name << " = " << b.nets[i].value << ";\n";
+
+    // level 2: the clock edge. Only the registers this state drives are written
+    for ( unsigned int i = 0; i < b.effects.size(); i++ )
+        out << "    " << b.effects[i] << "\n";
+
+    for ( unsigned int i = 0; i < b.assignments.size(); i++ ) {
+        const Assignment &a = b.assignments[i];
+        out << "    ";
+        if ( !a.condition.empty() )
+            out << "if ( " << a.condition << " ) ";
+        out << a.target << " = " << a.net << ";\n";
+    }
+
+    out << "    s.controlUnitState = ControlUnitStateEnum::" << stateNames[ static_cast<unsigned int>(b.next) ] << ";\n";
+    out << "}\n\n";
+}
+
+int main( int argc, char** argv ) {
+    if ( argc != 2 )
+        errExit( "usage: levelize output.cpp" );
+
+    ostringstream code;
+    code << "// written by tools/levelize from the microcode ROM in cpu/Microcode.h. Do not edit\n\n";
+    code << "#include \"../cpu/LevelizedCPU.h\"\n";
+    code << "#include \"../cpu/Video.h\"\n\n";
+
+    // the function used for each (state, opcode). Pairs which would generate the same code share a function
+    string table[ numStates ][ numOpcodes ];
+    map<string, string> functions; // body -> name
+    unsigned int numFunctions = 0;
+
+    for ( unsigned int state = 0; state < numStates; state++ ) {
+        for ( unsigned int op = 0; op < numOpcodes; op++ ) {
+            Behaviour b = behaviour( state, op );
+
+            string name = string( "tick" ) + stateNames[state];
+            if ( static_cast<ControlUnitStateEnum>(state) != ControlUnitStateEnum::Fetch )
+                name += string( "_" ) + (opcodeName( op ) ? opcodeName( op ) : "invalid");
+
+            ostringstream body;
+            writeTick( body, "NAME", b );
+
+            map<string, string>::iterator existing = functions.find( body.str() );
+            if ( existing != functions.end() ) {
+                table[state][op] = existing->second;
+                continue;
+            }
+
+            functions[ body.str() ] = name;
+            table[state][op] = name;
+            numFunctions++;
+
+            code << "// " << stateNames[state];
+            if ( static_cast<ControlUnitStateEnum>(state) != ControlUnitStateEnum::Fetch )
+                code << " " << (opcodeName( op ) ? opcodeName( op ) : "(invalid opcode)");
+            code << "\n";
+            writeTick( code, name, b );
+        }
+    }
+
+    code << "const LevelizedTick levelizedTicks[ levelizedStates ][ levelizedOpcodes ] = {\n";
+    for ( unsigned int state = 0; state < numStates; state++ ) {
+        code << "    { // " << stateNames[state] << "\n";
+        for ( unsigned int op = 0; op < numOpcodes; op++ )
+            code << "        " << table[state][op] << ( (op + 1 < numOpcodes) ? ",\n" : "\n" );
+        code << ( (state + 1 < numStates) ? "    },\n" : "    }\n" );
+    }
+    code << "};\n";
+
+    ofstream file( argv[1] );
+    file << code.str();
+    file.close();
+    if ( !file )
+        errExit( string( "Could not write " ) + argv[1] );
+
+    debug( "wrote " + to_string( numFunctions ) + " tick functions for "
+            + to_string( numStates * numOpcodes ) + " (state, opcode) pairs" );
+
+    return EXIT_SUCCESS;
+}
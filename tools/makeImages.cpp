@@ -0,0 +1,48 @@
+// writes the built in programs as program images for aotTranslate
+// usage: makeImages name output.img
+//     name is one of demo, demoNoFrames, selfModifying or computedJump
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../assembler/ProgramImage.h"
+#include "../emulator/debug.h"
+#include "../test/demoProgram.h"
+#include "../test/aotPrograms.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+int main( int argc, char** argv ) {
+    if ( argc != 3 )
+        errExit( "usage: makeImages name output.img" );
+
+    string name = argv[1];
+    vector<int32_t> machineCode;
+
+    if ( name == "demo" )
+        machineCode = demoProgram( true );
+    else if ( name == "demoNoFrames" )
+        machineCode = demoProgram( false );
+    else if ( name == "selfModifying" )
+        machineCode = selfModifyingProgram();
+    else if ( name == "computedJump" )
+        machineCode = computedJumpProgram();
+    else
+        errExit( "makeImages does not know a program called " + name );
+
+    writeProgramImage( argv[2], machineCode );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+// plays a recording made by FrameRecorder (for example with cpuDemo --record) on the terminal
+// usage: playFrames [-s speed] recording
+// speed 2 plays twice as fast as the frames were recorded. Speed 0 plays them as fast as possible
+
+/*  This file is part of cpuEmulator.
+    cpuEmulator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    cpuEmulator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with cpuEmulator.  If not, see http://www.gnu.org/licenses/.*/
+
+#include "../cpu/FrameRecording.h"
+#include "../cpu/Video.h"
+#include "../emulator/debug.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+#include <chrono>
+#include <thread>
+
+using namespace std;
+
+static void usage( void ) {
+    errExit( "usage: playFrames [-s speed] recording" );
+}
+
+int main( int argc, char** argv ) {
+    double speed = 1;
+    string path;
+
+    for ( int i = 1; i < argc; i++ ) {
+        string arg = argv[i];
+
+        if ( arg == "-s" ) {
+            if ( i + 1 >= argc )
+                usage();
+            speed = atof( argv[ ++i ] );
+            if ( speed < 0 )
+                usage();
+        } else if ( path.empty() ) {
+            path = arg;
+        } else {
+            usage();
+        }
+    }
+
+    if ( path.empty() )
+        usage();
+
+    FrameReader reader( path );
+    VideoOutput &terminal = terminalVideo();
+
+    const int8_t* frame;
+    uint64_t nanoseconds;
+    uint64_t frames = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    while ( reader.next( frame, nanoseconds ) ) {
+        // sleep until the frame is due, counted from when the playback started
+        if ( speed > 0 ) {
+            chrono::nanoseconds due( static_cast<int64_t>( nanoseconds / speed ) );
+            this_thread::sleep_until( start + due );
+        }
+
+        terminal.showFrame( frame );
+        frames++;
+    }
+
+    debug( to_string( frames ) + " frames played from " + path );
+    return EXIT_SUCCESS;
+}